@@ -0,0 +1,90 @@
+// Arithmetic expansion as a loop body sees it: each expression evaluated
+// over and over against live variables. The first column compiles the text
+// on every evaluation, as a $((...)) built from other expansions must; the
+// second runs the program arith_prepare caches for a fixed text. Arena
+// memory is rewound after every evaluation in both.
+//   BENCH_ROUNDS  evaluations per expression (default 1000000)
+#define _GNU_SOURCE
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "allocators/arena.h"
+#include "executor/arith.h"
+#include "executor/executor.h"
+
+#define DEFAULT_ROUNDS 1000000
+
+static const char *const CASES[] = {
+    "i + 1",
+    "i = i + 1",
+    "s += i * 3 % 7",
+    "(i << 2) ^ s",
+    "(1 << 10) * 60 * 60 + i % 24",
+    "i < 100 && s > 0 ? i * 2 : -1",
+};
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void) {
+  const char *env_rounds = getenv("BENCH_ROUNDS");
+  long        rounds     = env_rounds ? strtol(env_rounds, NULL, 10) : 0;
+  if (rounds <= 0) rounds = DEFAULT_ROUNDS;
+
+  arena_t arena;
+  arena_init(&arena, 1 << 16);
+  executor_t ex;
+  executor_init(&ex, &arena);
+
+  printf("%-32s %10s %10s %8s\n", "expression", "text ns", "cached ns",
+         "speedup");
+  int64_t sum = 0;
+  for (size_t c = 0; c < sizeof CASES / sizeof *CASES; c++) {
+    exec_setvar(&ex, "i", "0");
+    exec_setvar(&ex, "s", "0");
+    arena_mark_t base = arena_mark(&arena);
+    arena_mark_t mark = base;
+    double       t0   = now_ns();
+    for (long r = 0; r < rounds; r++) {
+      int64_t value;
+      if (!arith_eval(&ex, CASES[c], &value)) return EXIT_FAILURE;
+      sum += value;
+      arena_rewind(&arena, mark);
+    }
+    double text = (now_ns() - t0) / rounds;
+
+    exec_setvar(&ex, "i", "0");
+    exec_setvar(&ex, "s", "0");
+    const char      *error;
+    arith_program_t *program = arith_compile(&arena, CASES[c], &error);
+    if (!program) return EXIT_FAILURE;
+    mark = arena_mark(&arena);
+    t0   = now_ns();
+    for (long r = 0; r < rounds; r++) {
+      int64_t value;
+      if (!arith_run(&ex, program, &value)) return EXIT_FAILURE;
+      sum -= value;
+      arena_rewind(&arena, mark);
+    }
+    double cached = (now_ns() - t0) / rounds;
+    arena_rewind(&arena, base);
+
+    printf("%-32s %10.1f %10.1f %7.1fx\n", CASES[c], text, cached,
+           text / cached);
+  }
+
+  // Both passes start from the same variables, so their results cancel.
+  if (sum != 0) {
+    fprintf(stderr, "results differ: %" PRId64 "\n", sum);
+    return EXIT_FAILURE;
+  }
+  executor_free(&ex);
+  arena_free(&arena);
+  return EXIT_SUCCESS;
+}
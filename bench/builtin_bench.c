@@ -0,0 +1,71 @@
+// Cost of a `test`/`echo` command run as an in-process builtin versus the same
+// command spawned from /usr/bin, through the full parse + execute path.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocators/arena.h"
+#include "executor/executor.h"
+#include "interpreter/ast.h"
+#include "interpreter/parser.h"
+#include "interpreter/scanner.h"
+
+#define DEFAULT_RUNS 5000
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Returns the mean microseconds per command.
+static double run(const char *command, int n) {
+  arena_t arena;
+  arena_init(&arena, 4096);
+  ast_t ast;
+  ast_init(&ast, &arena);
+  executor_t ex;
+  executor_init(&ex, &arena);
+
+  arena_mark_t mark = arena_mark(&arena);
+  double       t0   = now_us();
+  for (int i = 0; i < n; i++) {
+    ast_reset(&ast);
+    scanner_t scanner;
+    scanner_init(&scanner, command, strlen(command));
+    parser_t parser;
+    parser_init(&parser, &scanner, &ast);
+    exec_run(&ex, &ast, parser_parse(&parser));
+    arena_rewind(&arena, mark);
+  }
+  double elapsed = now_us() - t0;
+
+  executor_free(&ex);
+  ast_free(&ast);
+  arena_free(&arena);
+  return elapsed / n;
+}
+
+int main(void) {
+  static const char *const pairs[][2] = {
+      {"test 1 -lt 2", "/usr/bin/test 1 -lt 2"},
+      {"[ -d /tmp ]", "/usr/bin/[ -d /tmp ]"},
+      {"echo hello >/dev/null", "/bin/echo hello >/dev/null"},
+      {"printf %s-%d x 1 >/dev/null", "/usr/bin/printf %s-%d x 1 >/dev/null"},
+  };
+
+  const char *env_n = getenv("BENCH_RUNS");
+  int         n     = env_n ? atoi(env_n) : DEFAULT_RUNS;
+
+  printf("%d runs each\n", n);
+  for (size_t i = 0; i < sizeof pairs / sizeof *pairs; i++) {
+    double builtin  = run(pairs[i][0], n * 20);
+    double external = run(pairs[i][1], n);
+    printf("%-30s %8.2f us   external %8.1f us   %6.0fx\n", pairs[i][0],
+           builtin, external, external / builtin);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+// End-to-end wall time of scripted workloads under tiny, dash and bash. Every
+// scenario is a generated script run as `<shell> <script>`, measured with
+// wait4 and getrusage. A shell that exits non-zero is listed as failed for
+// that scenario instead of being timed.
+//   TINY            shell under test (default build/tiny)
+//   BENCH_E2E_REPS  runs per scenario and shell (default 5)
+//   BENCH_PIPE_MB   bytes pushed through the pipeline scenario (default 1024)
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_REPS    5
+#define DEFAULT_PIPE_MB 1024
+#define MAX_REPS        64
+
+#define FORKS      2000
+#define HEREDOCS   2000
+#define BACKGROUND 200
+#define READ_LINES 20000
+#define QUOTES     2000
+#define BAD_BREAKS 2000
+#define SUBSHELLS  2000
+
+extern char **environ;
+
+typedef struct {
+  double wall_ms;
+  long   rss_kb;
+} sample_t;
+
+static char dir[] = "/tmp/tiny-e2e-XXXXXX";
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static double tv_ms(struct timeval tv) {
+  return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static FILE *open_script(const char *name, char *path, size_t size) {
+  snprintf(path, size, "%s/%s.sh", dir, name);
+  return fopen(path, "w");
+}
+
+static void write_fork_loop(FILE *f) {
+  for (int i = 0; i < FORKS; i++) fputs("/bin/true\n", f);
+}
+
+static void write_pipeline(FILE *f) {
+  const char *env_mb = getenv("BENCH_PIPE_MB");
+  long        mb     = env_mb ? atol(env_mb) : DEFAULT_PIPE_MB;
+  fprintf(f, "head -c %ld /dev/zero | cat | cat | cat | cat | cat | cat | "
+             "wc -c\n",
+          mb << 20);
+}
+
+static void write_heredocs(FILE *f) {
+  for (int i = 0; i < HEREDOCS; i++) {
+    fprintf(f, "cat <<EOF\nline one of document %d\nline two\nline three\nEOF\n",
+            i);
+  }
+}
+
+static void write_background(FILE *f) {
+  for (int i = 0; i < BACKGROUND; i++) fputs("/bin/true &\n", f);
+  fputs("wait\n", f);
+}
+
+static void write_read_loop(FILE *f) {
+  char input[4096];
+  snprintf(input, sizeof input, "%s/lines.txt", dir);
+  FILE *in = fopen(input, "w");
+  if (!in) return;
+  for (int i = 0; i < READ_LINES; i++) fprintf(in, "%d field two\n", i);
+  fclose(in);
+  fprintf(f, "while read n rest; do :; done <%s\n", input);
+}
+
+// Quotes nested in "${x-...}" and \" in backquotes inside "..." are removed;
+// a shell that keeps them exits 1.
+static void write_nested_quotes(FILE *f) {
+  fprintf(f, "x=; i=0\n"
+             "while [ $i -lt %d ]; do\n"
+             "  a=\"${x:-\"quoted default\"}\"\n"
+             "  b=\"`echo \\\"hi\\\"`\"\n"
+             "  i=$((i + 1))\n"
+             "done\n"
+             "[ \"$a\" = \"quoted default\" ] && [ \"$b\" = hi ] || exit 1\n",
+          QUOTES);
+}
+
+// `break 0` is an error, but it still ends the loop, which is bounded so that
+// a shell that carries on exits 1 instead of spinning. dash exits on the
+// error itself and is listed as failed.
+static void write_bad_break(FILE *f) {
+  for (int i = 0; i < BAD_BREAKS; i++) {
+    fputs("i=0\n"
+          "while [ $i -lt 100 ]; do i=$((i + 1)); break 0; done\n"
+          "[ $i -eq 1 ] || exit 1\n",
+          f);
+  }
+}
+
+// A subshell or $(...) whose $((...)) expands to an assignment must still
+// fork, or the assignment lands in the shell itself and the script exits 1.
+static void write_arith_subshell(FILE *f) {
+  fprintf(f, "e='x=5'; n=0\n"
+             "while [ $n -lt %d ]; do\n"
+             "  n=$((n + 1)); x=1\n"
+             "  ( : $(($e)) ); a=$(echo $(($e)))\n"
+             "  [ $x = 1 ] || exit 1\n"
+             "done\n",
+          SUBSHELLS);
+}
+
+static const struct {
+  const char *name;
+  void (*write)(FILE *f);
+} SCENARIOS[] = {
+    {"fork_loop", write_fork_loop},   {"pipeline_8", write_pipeline},
+    {"heredocs", write_heredocs},     {"background", write_background},
+    {"while_read", write_read_loop},  {"nested_quotes", write_nested_quotes},
+    {"bad_break", write_bad_break},   {"arith_subshell", write_arith_subshell},
+};
+
+// Runs the script once. Returns 0 if the shell failed to start or exited
+// non-zero.
+static int run_once(const char *shell, const char *script, sample_t *out) {
+  char *argv[] = {(char *)shell, (char *)script, NULL};
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+  posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+  double t0 = now_ms();
+  pid_t  pid;
+  int    err = posix_spawn(&pid, shell, &actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (err) return 0;
+
+  int           status;
+  struct rusage ru;
+  if (wait4(pid, &status, 0, &ru) < 0) return 0;
+
+  out->wall_ms = now_ms() - t0;
+  out->rss_kb  = ru.ru_maxrss;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Peak RSS is the shell's own, from wait4. CPU time and context switches come
+// from RUSAGE_CHILDREN deltas so they include the commands the shell ran.
+static void report(const char *shell, const char *script, int reps) {
+  double wall[MAX_REPS], cpu[MAX_REPS], csw[MAX_REPS];
+  long   rss = 0;
+
+  for (int r = 0; r < reps; r++) {
+    struct rusage before, after;
+    sample_t      s;
+    getrusage(RUSAGE_CHILDREN, &before);
+    if (!run_once(shell, script, &s)) {
+      printf("  %-12s failed\n", shell);
+      return;
+    }
+    getrusage(RUSAGE_CHILDREN, &after);
+
+    wall[r] = s.wall_ms;
+    cpu[r]  = tv_ms(after.ru_utime) - tv_ms(before.ru_utime) +
+             tv_ms(after.ru_stime) - tv_ms(before.ru_stime);
+    csw[r] = (after.ru_nvcsw - before.ru_nvcsw) +
+             (after.ru_nivcsw - before.ru_nivcsw);
+    if (s.rss_kb > rss) rss = s.rss_kb;
+  }
+
+  qsort(wall, reps, sizeof(double), cmp_double);
+  qsort(cpu, reps, sizeof(double), cmp_double);
+  qsort(csw, reps, sizeof(double), cmp_double);
+  printf("  %-12s %9.1f %9.1f %9.1f %8ld %9.0f\n", shell, wall[reps / 2],
+         wall[(reps * 99) / 100], cpu[reps / 2], rss, csw[reps / 2]);
+}
+
+int main(void) {
+  const char *tiny     = getenv("TINY");
+  const char *env_reps = getenv("BENCH_E2E_REPS");
+  int         reps     = env_reps ? atoi(env_reps) : DEFAULT_REPS;
+  if (reps < 1) reps = 1;
+  if (reps > MAX_REPS) reps = MAX_REPS;
+
+  const char *shells[] = {tiny ? tiny : "build/tiny", "/bin/dash", "/bin/bash"};
+  if (!mkdtemp(dir)) return EXIT_FAILURE;
+
+  printf("%d runs each; wall/cpu in ms (cpu includes children), rss in kB\n",
+         reps);
+  printf("  %-12s %9s %9s %9s %8s %9s\n", "shell", "p50 wall", "p99 wall",
+         "p50 cpu", "max rss", "p50 csw");
+
+  char path[4096];
+  for (size_t i = 0; i < sizeof SCENARIOS / sizeof *SCENARIOS; i++) {
+    FILE *f = open_script(SCENARIOS[i].name, path, sizeof path);
+    if (!f) return EXIT_FAILURE;
+    SCENARIOS[i].write(f);
+    fclose(f);
+
+    printf("%s\n", SCENARIOS[i].name);
+    for (size_t s = 0; s < sizeof shells / sizeof *shells; s++) {
+      if (access(shells[s], X_OK) != 0) continue;
+      report(shells[s], path, reps);
+    }
+    unlink(path);
+  }
+
+  char input[4096];
+  snprintf(input, sizeof input, "%s/lines.txt", dir);
+  unlink(input);
+  rmdir(dir);
+  return EXIT_SUCCESS;
+}
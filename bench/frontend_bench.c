@@ -0,0 +1,200 @@
+// Scanner and parser throughput over generated corpora, one shape of input
+// per corpus. Prints a single JSON document so results can be diffed between
+// releases.
+//   BENCH_CORPUS_MB  size of each corpus (default 8)
+//   BENCH_REPS       timed repetitions, best one reported (default 5)
+//   BENCH_DUMP_DIR   if set, each corpus is also written there as <name>.sh
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocators/arena.h"
+#include "interpreter/ast.h"
+#include "interpreter/charclass.h"
+#include "interpreter/parser.h"
+#include "interpreter/scanner.h"
+
+#define DEFAULT_CORPUS_MB 8
+#define DEFAULT_REPS      5
+#define NESTING_DEPTH     64
+
+typedef struct {
+  char  *data;
+  size_t length;
+  size_t capacity;
+} corpus_t;
+
+typedef void (*generator_fn)(corpus_t *c, unsigned i);
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void emit(corpus_t *c, const char *fmt, ...) {
+  va_list ap;
+  for (;;) {
+    va_start(ap, fmt);
+    int n = vsnprintf(c->data + c->length, c->capacity - c->length, fmt, ap);
+    va_end(ap);
+    if ((size_t)n < c->capacity - c->length) {
+      c->length += n;
+      return;
+    }
+    c->capacity = c->capacity * 2 + n;
+    c->data     = realloc(c->data, c->capacity);
+    if (!c->data) exit(EXIT_FAILURE);
+  }
+}
+
+// Each generator appends one complete command for iteration `i`.
+
+static void gen_pipelines(corpus_t *c, unsigned i) {
+  emit(c, "cat input%u.txt", i);
+  for (unsigned s = 0; s < 8 + i % 24; s++) emit(c, " | filter%u -x %u", s, i);
+  emit(c, "\n");
+}
+
+static void gen_nesting(corpus_t *c, unsigned i) {
+  unsigned depth = 1 + i % NESTING_DEPTH;
+  for (unsigned d = 0; d < depth; d++) emit(c, "( ");
+  emit(c, "leaf %u", i);
+  for (unsigned d = 0; d < depth; d++) emit(c, " )");
+  emit(c, "\n");
+}
+
+static void gen_redirections(corpus_t *c, unsigned i) {
+  emit(c, "cmd%u <in%u >out%u 2>err%u 3<>rw%u >>log%u 4<&0 5>&1 >|f%u\n", i, i,
+       i, i, i, i, i);
+}
+
+static void gen_and_or(corpus_t *c, unsigned i) {
+  emit(c, "test -f f%u", i);
+  for (unsigned k = 0; k < 4 + i % 16; k++) {
+    emit(c, k % 2 ? " || fallback%u" : " && step%u arg", k);
+  }
+  emit(c, "\n");
+}
+
+static void gen_assignments(corpus_t *c, unsigned i) {
+  for (unsigned k = 0; k < 16 + i % 48; k++) {
+    emit(c, "VAR_%u_%u=value%u ", i % 97, k, k * i);
+  }
+  emit(c, "run%u\n", i);
+}
+
+static void gen_mixed(corpus_t *c, unsigned i) {
+  switch (i % 5) {
+    case 0: gen_pipelines(c, i); break;
+    case 1: gen_nesting(c, i % 8); break;
+    case 2: gen_redirections(c, i); break;
+    case 3: gen_and_or(c, i); break;
+    case 4: gen_assignments(c, i % 4); break;
+  }
+}
+
+static const struct {
+  const char  *name;
+  generator_fn gen;
+} CORPORA[] = {
+    {"pipelines", gen_pipelines},     {"nesting", gen_nesting},
+    {"redirections", gen_redirections}, {"and_or", gen_and_or},
+    {"assignments", gen_assignments}, {"mixed", gen_mixed},
+};
+
+static void dump(const char *dir, const char *name, const corpus_t *c) {
+  char path[4096];
+  snprintf(path, sizeof path, "%s/%s.sh", dir, name);
+  FILE *f = fopen(path, "w");
+  if (!f) return;
+  fwrite(c->data, 1, c->length, f);
+  fclose(f);
+}
+
+int main(void) {
+  const char *env_mb   = getenv("BENCH_CORPUS_MB");
+  const char *env_reps = getenv("BENCH_REPS");
+  const char *dump_dir = getenv("BENCH_DUMP_DIR");
+  size_t      target   = (env_mb ? atoi(env_mb) : DEFAULT_CORPUS_MB) << 20;
+  int         reps     = env_reps ? atoi(env_reps) : DEFAULT_REPS;
+
+  cc_init();
+  printf("{\n  \"bench\": \"frontend\",\n  \"simd\": \"%s\",\n", cc_ops.name);
+  printf("  \"corpus_bytes\": %zu,\n  \"corpora\": [\n", target);
+
+  size_t count = sizeof CORPORA / sizeof *CORPORA;
+  for (size_t k = 0; k < count; k++) {
+    corpus_t c = {malloc(1 << 16), 0, 1 << 16};
+    if (!c.data) return EXIT_FAILURE;
+    for (unsigned i = 0; c.length < target; i++) CORPORA[k].gen(&c, i);
+    if (dump_dir) dump(dump_dir, CORPORA[k].name, &c);
+
+    // Tokens only.
+    size_t tokens  = 0;
+    double scan_ns = 1e300;
+    for (int r = 0; r < reps; r++) {
+      scanner_t s;
+      token_t   tok;
+      size_t    n  = 0;
+      double    t0 = now_ns();
+      scanner_init(&s, c.data, c.length);
+      while (next_token(&s, &tok)) n++;
+      double t = now_ns() - t0;
+      if (t < scan_ns) scan_ns = t;
+      tokens = n;
+    }
+
+    // Whole parse. One arena chunk big enough for everything, so its offset
+    // is exactly the number of arena bytes the parse used.
+    arena_t arena;
+    arena_init(&arena, c.length * 8);
+    ast_t ast;
+    ast_init(&ast, &arena);
+
+    double parse_ns = 1e300;
+    size_t nodes = 0, arena_bytes = 0;
+    int    failed = 0;
+    for (int r = 0; r < reps; r++) {
+      arena_reset(&arena);
+      ast_reset(&ast);
+      scanner_t s;
+      parser_t  p;
+      double    t0 = now_ns();
+      scanner_init(&s, c.data, c.length);
+      parser_init(&p, &s, &ast);
+      parser_parse(&p);
+      double t = now_ns() - t0;
+      if (t < parse_ns) parse_ns = t;
+      failed      = p.had_error;
+      nodes       = ast.nodes.length;
+      arena_bytes = arena.offset;
+    }
+
+    double mb = c.length / 1e6;
+    printf("    {\n");
+    printf("      \"name\": \"%s\",\n", CORPORA[k].name);
+    printf("      \"bytes\": %zu,\n", c.length);
+    printf("      \"tokens\": %zu,\n", tokens);
+    printf("      \"ast_nodes\": %zu,\n", nodes);
+    printf("      \"parse_ok\": %s,\n", failed ? "false" : "true");
+    printf("      \"scan_tokens_per_s\": %.0f,\n", tokens / (scan_ns / 1e9));
+    printf("      \"scan_mb_per_s\": %.1f,\n", mb / (scan_ns / 1e9));
+    printf("      \"parse_mb_per_s\": %.1f,\n", mb / (parse_ns / 1e9));
+    printf("      \"parse_ns_per_node\": %.2f,\n", nodes ? parse_ns / nodes : 0);
+    printf("      \"arena_bytes_per_input_byte\": %.3f\n",
+           (double)arena_bytes / c.length);
+    printf("    }%s\n", k + 1 < count ? "," : "");
+
+    ast_free(&ast);
+    arena_free(&arena);
+    free(c.data);
+  }
+
+  printf("  ]\n}\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+// Pathname expansion over one large directory: the shell's glob engine
+// against glibc glob(3), both sorting their results. The last row expands
+// two patterns for one command, as `cp *.c *.h dir/` does, where the
+// engine lists the directory once and glob(3) reads it twice.
+//   BENCH_ENTRIES  files in the directory (default 100000)
+//   BENCH_ROUNDS   timed expansions per row, best kept (default 5)
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <glob.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "allocators/arena.h"
+#include "collections/vector.h"
+#include "executor/glob.h"
+
+#define DEFAULT_ENTRIES 100000
+#define DEFAULT_ROUNDS  5
+
+static const char *const CASES[][2] = {
+    {"*", NULL},
+    {"*.c", NULL},
+    {"f01234?.*", NULL},
+    {"*[05].h", NULL},
+    {"*.c", "*.h"},
+};
+
+static char dir[] = "/tmp/tiny-glob-XXXXXX";
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void cleanup(long entries) {
+  char name[32];
+  for (long i = 0; i < entries; i++) {
+    snprintf(name, sizeof name, "f%06ld.%c", i, i % 2 ? 'h' : 'c');
+    unlink(name);
+  }
+  chdir("/");
+  rmdir(dir);
+}
+
+int main(void) {
+  const char *env_entries = getenv("BENCH_ENTRIES");
+  const char *env_rounds  = getenv("BENCH_ROUNDS");
+  long entries = env_entries ? strtol(env_entries, NULL, 10) : DEFAULT_ENTRIES;
+  int  rounds  = env_rounds ? atoi(env_rounds) : DEFAULT_ROUNDS;
+  if (entries <= 0) entries = DEFAULT_ENTRIES;
+  if (rounds <= 0) rounds = DEFAULT_ROUNDS;
+
+  if (!mkdtemp(dir) || chdir(dir) != 0) return EXIT_FAILURE;
+  char name[32];
+  for (long i = 0; i < entries; i++) {
+    snprintf(name, sizeof name, "f%06ld.%c", i, i % 2 ? 'h' : 'c');
+    int fd = open(name, O_CREAT | O_WRONLY | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      cleanup(i);
+      return EXIT_FAILURE;
+    }
+    close(fd);
+  }
+
+  arena_t arena;
+  arena_init(&arena, 1 << 16);
+
+  printf("%ld entries; best of %d\n", entries, rounds);
+  printf("%-14s %8s %8s %10s %10s %8s\n", "pattern", "matches", "listed",
+         "tiny ms", "glob ms", "speedup");
+  for (size_t c = 0; c < sizeof CASES / sizeof *CASES; c++) {
+    const char *const *patterns = CASES[c];
+    int                count    = patterns[1] ? 2 : 1;
+
+    double   tiny_best = 0, glob_best = 0;
+    size_t   found     = 0;
+    unsigned listed    = 0;
+    bool     same      = true;
+    for (int r = 0; r < rounds; r++) {
+      arena_mark_t mark = arena_mark(&arena);
+      double       t0   = now_ns();
+      glob_cache_t cache;
+      glob_cache_init(&cache, &arena, NULL);
+      vector_t matches;
+      vector_init(&matches, sizeof(char *), &arena);
+      for (int p = 0; p < count; p++) {
+        if (glob_expand(&cache, patterns[p], &matches) < 0) return EXIT_FAILURE;
+      }
+      double t = now_ns() - t0;
+      if (r == 0 || t < tiny_best) tiny_best = t;
+      listed = cache.reads;
+
+      t0 = now_ns();
+      glob_t g;
+      glob(patterns[0], 0, NULL, &g);
+      if (count > 1) glob(patterns[1], GLOB_APPEND, NULL, &g);
+      t = now_ns() - t0;
+      if (r == 0 || t < glob_best) glob_best = t;
+
+      // Same paths in the same order.
+      found = matches.length;
+      same  = found == g.gl_pathc;
+      for (size_t i = 0; same && i < found; i++) {
+        same = strcmp(VECTOR_AT(&matches, char *, i), g.gl_pathv[i]) == 0;
+      }
+      globfree(&g);
+      arena_rewind(&arena, mark);
+    }
+    if (!same) {
+      fprintf(stderr, "%s: results differ from glob(3)\n", patterns[0]);
+      cleanup(entries);
+      return EXIT_FAILURE;
+    }
+
+    char label[32];
+    snprintf(label, sizeof label, "%s%s%s", patterns[0], count > 1 ? " " : "",
+             count > 1 ? patterns[1] : "");
+    printf("%-14s %8zu %8u %10.2f %10.2f %7.1fx\n", label, found, listed,
+           tiny_best / 1e6, glob_best / 1e6, glob_best / tiny_best);
+  }
+
+  cleanup(entries);
+  arena_free(&arena);
+  return EXIT_SUCCESS;
+}
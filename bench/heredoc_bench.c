@@ -0,0 +1,134 @@
+// Throughput of multi-megabyte here-documents under tiny, dash and bash: a
+// script whose only command is `cat <<EOF` (or `<<-EOF` with every line
+// tab-indented) over a body of each size, run as `<shell> <script>`. The
+// reported rate covers reading the script, collecting the body and serving
+// it to cat. Block writes count what the shell and cat sent to disk, which
+// is where a shell that spools here-documents to temp files pays.
+//   TINY        shell under test (default build/tiny)
+//   BENCH_REPS  runs per size and shell, median reported (default 5)
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_REPS 5
+#define MAX_REPS     64
+#define LINE_BYTES   64
+
+static const int SIZES_MB[] = {1, 16, 64};
+
+extern char **environ;
+
+static char dir[] = "/tmp/tiny-heredoc-XXXXXX";
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// One here-document of `mb` MiB of body text (tabs included).
+static bool write_script(const char *path, int mb, bool strip) {
+  FILE *f = fopen(path, "w");
+  if (!f) return false;
+
+  char line[LINE_BYTES + 1];
+  int  text = strip ? 1 : 0;
+  if (strip) line[0] = '\t';
+  memset(line + text, 'x', LINE_BYTES - 1 - text);
+  line[LINE_BYTES - 1] = '\n';
+  line[LINE_BYTES]     = '\0';
+
+  fprintf(f, "cat %sEOF\n", strip ? "<<-" : "<<");
+  for (long i = 0; i < ((long)mb << 20) / LINE_BYTES; i++) fputs(line, f);
+  fprintf(f, "%sEOF\n", strip ? "\t" : "");
+  return fclose(f) == 0;
+}
+
+// Wall ms of one run, or -1 if the shell failed; `blocks` gets the block
+// writes of the shell and everything it ran.
+static double run(const char *shell, const char *script, long *blocks) {
+  char *argv[] = {(char *)shell, (char *)script, NULL};
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+
+  struct rusage before, after;
+  getrusage(RUSAGE_CHILDREN, &before);
+  double t0 = now_ms();
+  pid_t  pid;
+  int    err = posix_spawn(&pid, shell, &actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (err) return -1;
+
+  int status;
+  if (waitpid(pid, &status, 0) < 0) return -1;
+  double wall = now_ms() - t0;
+  getrusage(RUSAGE_CHILDREN, &after);
+
+  *blocks = after.ru_oublock - before.ru_oublock;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? wall : -1;
+}
+
+static void report(const char *shell, const char *script, int mb, int reps) {
+  double wall[MAX_REPS];
+  long   blocks = 0;
+  for (int r = 0; r < reps; r++) {
+    long b;
+    wall[r] = run(shell, script, &b);
+    if (wall[r] < 0) {
+      printf("  %-12s failed\n", shell);
+      return;
+    }
+    if (b > blocks) blocks = b;
+  }
+  qsort(wall, reps, sizeof(double), cmp_double);
+  printf("  %-12s %9.1f %9.0f %9ld\n", shell, wall[reps / 2],
+         mb / (wall[reps / 2] / 1e3), blocks);
+}
+
+int main(void) {
+  const char *tiny     = getenv("TINY");
+  const char *env_reps = getenv("BENCH_REPS");
+  int         reps     = env_reps ? atoi(env_reps) : DEFAULT_REPS;
+  if (reps < 1) reps = 1;
+  if (reps > MAX_REPS) reps = MAX_REPS;
+
+  const char *shells[] = {tiny ? tiny : "build/tiny", "/bin/dash", "/bin/bash"};
+  if (!mkdtemp(dir)) return EXIT_FAILURE;
+
+  printf("%d runs each; p50 wall in ms, MB/s of body, max block writes\n",
+         reps);
+  printf("  %-12s %9s %9s %9s\n", "shell", "p50 wall", "MB/s", "oublock");
+
+  char path[4096];
+  snprintf(path, sizeof path, "%s/heredoc.sh", dir);
+  for (size_t i = 0; i < sizeof SIZES_MB / sizeof *SIZES_MB; i++) {
+    for (int strip = 0; strip <= 1; strip++) {
+      if (!write_script(path, SIZES_MB[i], strip)) return EXIT_FAILURE;
+      printf("%d MiB, %s\n", SIZES_MB[i], strip ? "<<-" : "<<");
+      for (size_t s = 0; s < sizeof shells / sizeof *shells; s++) {
+        if (access(shells[s], X_OK) != 0) continue;
+        report(shells[s], path, SIZES_MB[i], reps);
+      }
+    }
+  }
+
+  unlink(path);
+  rmdir(dir);
+  return EXIT_SUCCESS;
+}
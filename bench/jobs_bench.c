@@ -0,0 +1,211 @@
+// Reaping many background jobs. Forks N children that block on a pipe and,
+// once it is closed, exit spread evenly over SPREAD_MS, like a batch of
+// `sleep &` jobs. Times how long the reaper takes to notice the last exit and
+// how much CPU it burns meanwhile, for the pidfd/epoll reaper, its signalfd
+// fallback, and a SIGCHLD-then-scan-every-job loop for comparison. The
+// "exited" rows hand the reaper children that are already gone, as `true &`
+// often is by the time it is added; a reaper that misses them fails the run.
+//   BENCH_JOBS  children per run (default 10000)
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "executor/jobs.h"
+
+#define DEFAULT_JOBS 10000
+#define SPREAD_MS    500
+#define GIVE_UP_MS   2000 // an "exited" run with no progress for this long
+
+typedef struct {
+  double drain_ms; // release to last exit noticed
+  double cpu_ms;   // the reaper's own user+system time while draining
+  size_t wakeups;  // times the reaper was woken
+} result_t;
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static double cpu_ms(void) {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec * 1e3 + ru.ru_utime.tv_usec / 1e3 +
+         ru.ru_stime.tv_sec * 1e3 + ru.ru_stime.tv_usec / 1e3;
+}
+
+// Forks `n` children; child i exits i * SPREAD_MS / n ms after `gate`
+// reaches EOF.
+static size_t spawn_blocked(pid_t *pids, size_t n, int gate[2]) {
+  size_t started = 0;
+  for (; started < n; started++) {
+    pid_t pid = fork();
+    if (pid < 0) break;
+    if (pid == 0) {
+      char c;
+      close(gate[1]);
+      while (read(gate[0], &c, 1) > 0) {
+      }
+      long            ns = (long)(started * SPREAD_MS * 1000000.0 / n);
+      struct timespec ts = {ns / 1000000000, ns % 1000000000};
+      nanosleep(&ts, NULL);
+      _exit(0);
+    }
+    pids[started] = pid;
+  }
+  close(gate[0]);
+  return started;
+}
+
+static size_t run_jobs(const char *mode, size_t n, result_t *r) {
+  setenv("TINY_JOBS", mode, 1);
+  jobs_t jobs;
+  jobs_init(&jobs);
+
+  pid_t *pids = malloc(n * sizeof(pid_t));
+  int    gate[2];
+  if (!pids || pipe(gate) != 0) exit(EXIT_FAILURE);
+
+  // jobs_add may block SIGCHLD, which children inherit harmlessly.
+  n = spawn_blocked(pids, n, gate);
+  for (size_t i = 0; i < n; i++) jobs_add(&jobs, pids[i], strdup("child"));
+
+  double t0 = now_ms(), c0 = cpu_ms();
+  close(gate[1]);
+
+  for (r->wakeups = 0; jobs.running; r->wakeups++) jobs_poll(&jobs, -1);
+  r->drain_ms = now_ms() - t0;
+  r->cpu_ms   = cpu_ms() - c0;
+
+  jobs_free(&jobs);
+  free(pids);
+  unsetenv("TINY_JOBS");
+  return n;
+}
+
+// Children that exit straight away and are only added once they have: their
+// SIGCHLDs are long gone. Returns 0 if the reaper stops noticing exits.
+static size_t run_exited(const char *mode, size_t n, result_t *r) {
+  setenv("TINY_JOBS", mode, 1);
+  jobs_t jobs;
+  jobs_init(&jobs);
+
+  pid_t *pids = malloc(n * sizeof(pid_t));
+  if (!pids) exit(EXIT_FAILURE);
+  size_t started = 0;
+  for (; started < n; started++) {
+    pid_t pid = fork();
+    if (pid < 0) break;
+    if (pid == 0) _exit(0);
+    pids[started] = pid;
+  }
+  for (size_t i = 0; i < started; i++) {
+    siginfo_t info;
+    waitid(P_PID, pids[i], &info, WEXITED | WNOWAIT);
+  }
+
+  double t0 = now_ms(), c0 = cpu_ms();
+  for (size_t i = 0; i < started; i++) {
+    jobs_add(&jobs, pids[i], strdup("child"));
+  }
+  bool stuck = false;
+  for (r->wakeups = 0; jobs.running && !stuck; r->wakeups++) {
+    stuck = !jobs_poll(&jobs, GIVE_UP_MS);
+  }
+  r->drain_ms = now_ms() - t0;
+  r->cpu_ms   = cpu_ms() - c0;
+
+  jobs_free(&jobs);
+  for (size_t i = 0; i < started; i++) waitpid(pids[i], NULL, WNOHANG);
+  free(pids);
+  unsetenv("TINY_JOBS");
+  return stuck ? 0 : started;
+}
+
+// What a shell without per-job events does: on each SIGCHLD, ask every
+// outstanding job whether it has exited.
+static size_t run_scan(size_t n, result_t *r) {
+  sigset_t chld, saved;
+  sigemptyset(&chld);
+  sigaddset(&chld, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &chld, &saved);
+
+  pid_t *pids = malloc(n * sizeof(pid_t));
+  int    gate[2];
+  if (!pids || pipe(gate) != 0) exit(EXIT_FAILURE);
+  n = spawn_blocked(pids, n, gate);
+
+  double t0 = now_ms(), c0 = cpu_ms();
+  close(gate[1]);
+
+  size_t live = n;
+  for (r->wakeups = 0; live; r->wakeups++) {
+    sigwaitinfo(&chld, NULL);
+    for (size_t i = 0; i < live;) {
+      if (waitpid(pids[i], NULL, WNOHANG) == pids[i]) pids[i] = pids[--live];
+      else i++;
+    }
+  }
+  r->drain_ms = now_ms() - t0;
+  r->cpu_ms   = cpu_ms() - c0;
+
+  sigprocmask(SIG_SETMASK, &saved, NULL);
+  free(pids);
+  return n;
+}
+
+static void report(const char *name, size_t n, const result_t *r,
+                   double spread_ms) {
+  printf("  %-14s %6zu %9.1f %9.1f %9.1f %8zu\n", name, n, r->drain_ms,
+         r->drain_ms - spread_ms, r->cpu_ms, r->wakeups);
+}
+
+int main(void) {
+  const char *env_jobs = getenv("BENCH_JOBS");
+  size_t      n        = env_jobs ? strtoul(env_jobs, NULL, 10) : DEFAULT_JOBS;
+  if (n == 0) n = 1;
+
+  // One pidfd per job: let the table grow as far as the hard limit allows.
+  struct rlimit lim;
+  if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+  }
+
+  printf("ms from releasing the children; the last exits after %d ms\n",
+         SPREAD_MS);
+  printf("  %-14s %6s %9s %9s %9s %8s\n", "reaper", "jobs", "drain", "late",
+         "cpu", "wakeups");
+
+  result_t r;
+  size_t   started;
+  started = run_jobs("pidfd", n, &r);
+  report("pidfd+epoll", started, &r, SPREAD_MS);
+  started = run_jobs("signalfd", n, &r);
+  report("signalfd", started, &r, SPREAD_MS);
+  started = run_scan(n, &r);
+  report("waitpid scan", started, &r, SPREAD_MS);
+
+  static const char *const EXITED[][2] = {{"pidfd", "exited pidfd"},
+                                           {"signalfd", "exited sigfd"}};
+  bool missed = false;
+  for (size_t m = 0; m < 2; m++) {
+    started = run_exited(EXITED[m][0], n, &r);
+    if (started) {
+      report(EXITED[m][1], started, &r, 0);
+    } else {
+      printf("  %-14s missed exits\n", EXITED[m][1]);
+      missed = true;
+    }
+  }
+  return missed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+// Loops: a while loop parsed once and run from its AST, against the same
+// body parsed from its text on every pass, as a shell that kept loops as
+// text would. Peak RSS is read after each row; the loop rows leave it flat
+// however many passes they make, since every pass rewinds the arena.
+//   BENCH_PASSES  passes in the largest row (default 1000000)
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "allocators/arena.h"
+#include "executor/executor.h"
+#include "interpreter/ast.h"
+#include "interpreter/parser.h"
+#include "interpreter/scanner.h"
+
+#define DEFAULT_PASSES 1000000
+
+#define BODY                                                                   \
+  "i=$((i+1)); v=\"$i-$x\"; case $v in *7-*) n=$((n+1));; esac"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long peak_rss_kb(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// Parses `text` into `ast` and runs it; false on a syntax error.
+static bool run_text(executor_t *ex, ast_t *ast, const char *text) {
+  scanner_t scanner;
+  scanner_init(&scanner, text, strlen(text));
+  parser_t parser;
+  parser_init(&parser, &scanner, ast);
+  ast_ref_t root = parser_parse(&parser);
+  if (parser.had_error) return false;
+  exec_run(ex, ast, root);
+  return true;
+}
+
+int main(void) {
+  const char *env_passes = getenv("BENCH_PASSES");
+  long        passes     = env_passes ? strtol(env_passes, NULL, 10) : 0;
+  if (passes <= 0) passes = DEFAULT_PASSES;
+
+  arena_t arena;
+  arena_init(&arena, 1 << 16);
+  executor_t ex;
+  executor_init(&ex, &arena);
+  exec_setvar(&ex, "x", "some value");
+  arena_mark_t base = arena_mark(&arena);
+
+  printf("%-8s %10s %12s %12s %10s\n", "mode", "passes", "ns/pass",
+         "peak RSS KB", "n");
+  ast_t ast;
+  ast_init(&ast, &arena);
+  for (long count = passes / 100; count <= passes; count *= 10) {
+    char text[256];
+    snprintf(text, sizeof text,
+             "i=0; n=0; while [ $i -lt %ld ]; do " BODY "; done", count);
+    double t0 = now_ns();
+    if (!run_text(&ex, &ast, text)) return EXIT_FAILURE;
+    double elapsed = now_ns() - t0;
+    printf("%-8s %10ld %12.0f %12ld %10s\n", "loop", count, elapsed / count,
+           peak_rss_kb(), exec_getvar(&ex, "n"));
+    ast_reset(&ast);
+    arena_rewind(&arena, base);
+  }
+
+  // The text row stops at a hundredth of the passes; it is there for the
+  // time per pass.
+  long rows = passes / 100 ? passes / 100 : 1;
+  exec_setvar(&ex, "i", "0");
+  exec_setvar(&ex, "n", "0");
+  double t0 = now_ns();
+  for (long r = 0; r < rows; r++) {
+    if (!run_text(&ex, &ast, BODY)) return EXIT_FAILURE;
+    ast_reset(&ast);
+    arena_rewind(&arena, base);
+  }
+  double elapsed = now_ns() - t0;
+  printf("%-8s %10ld %12.0f %12ld %10s\n", "text", rows, elapsed / rows,
+         peak_rss_kb(), exec_getvar(&ex, "n"));
+
+  ast_free(&ast);
+  executor_free(&ex);
+  arena_free(&arena);
+  return EXIT_SUCCESS;
+}
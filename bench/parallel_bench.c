@@ -0,0 +1,140 @@
+// Fan-out of CPU-bound work: JOBS_PER_CPU x CPUs checksums of one cached file,
+// started as plain `cmd &` jobs (every one at once), with `set -o jobs-max`,
+// and through `parallel`. Oversubscription shows up as extra context
+// switches and a longer tail rather than higher throughput.
+//   TINY        shell under test (default build/tiny)
+//   BENCH_REPS  runs per variant, median reported (default 5)
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <sched.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_REPS 5
+#define MAX_REPS     64
+#define JOBS_PER_CPU 4
+#define INPUT_MB     16
+
+extern char **environ;
+
+static char dir[] = "/tmp/tiny-parallel-XXXXXX";
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static int cpus(void) {
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof set, &set) == 0) return CPU_COUNT(&set);
+  return 1;
+}
+
+// Runs `tiny -c cmd` once; returns wall ms, or -1 if it failed.
+static double run(const char *tiny, const char *cmd, double *csw) {
+  char *argv[] = {(char *)tiny, "-c", (char *)cmd, NULL};
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+
+  struct rusage before, after;
+  getrusage(RUSAGE_CHILDREN, &before);
+  double t0 = now_ms();
+  pid_t  pid;
+  int    err = posix_spawn(&pid, tiny, &actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (err) return -1;
+
+  int status;
+  if (waitpid(pid, &status, 0) < 0) return -1;
+  double wall = now_ms() - t0;
+  getrusage(RUSAGE_CHILDREN, &after);
+
+  *csw = (after.ru_nvcsw - before.ru_nvcsw) +
+         (after.ru_nivcsw - before.ru_nivcsw);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? wall : -1;
+}
+
+static void report(const char *tiny, const char *name, const char *cmd,
+                   int reps) {
+  double wall[MAX_REPS], csw[MAX_REPS];
+  for (int r = 0; r < reps; r++) {
+    wall[r] = run(tiny, cmd, &csw[r]);
+    if (wall[r] < 0) {
+      printf("  %-12s failed\n", name);
+      return;
+    }
+  }
+  qsort(wall, reps, sizeof(double), cmp_double);
+  qsort(csw, reps, sizeof(double), cmp_double);
+  printf("  %-12s %9.1f %9.1f %9.0f\n", name, wall[reps / 2], wall[reps - 1],
+         csw[reps / 2]);
+}
+
+int main(void) {
+  const char *tiny     = getenv("TINY");
+  const char *env_reps = getenv("BENCH_REPS");
+  int         reps     = env_reps ? atoi(env_reps) : DEFAULT_REPS;
+  if (!tiny) tiny = "build/tiny";
+  if (reps < 1) reps = 1;
+  if (reps > MAX_REPS) reps = MAX_REPS;
+  if (!mkdtemp(dir)) return EXIT_FAILURE;
+
+  char input[4096];
+  snprintf(input, sizeof input, "%s/input", dir);
+  FILE *f = fopen(input, "w");
+  if (!f) return EXIT_FAILURE;
+  for (unsigned i = 0; i < (INPUT_MB << 20) / sizeof i; i++) {
+    unsigned x = i * 2654435761u;
+    fwrite(&x, sizeof x, 1, f);
+  }
+  fclose(f);
+
+  int    n      = cpus();
+  int    jobs   = n * JOBS_PER_CPU;
+  size_t size   = (size_t)jobs * (strlen(input) + 32) + 256;
+  char  *plain  = malloc(size);
+  char  *capped = malloc(size);
+  char  *pool   = malloc(size);
+  if (!plain || !capped || !pool) return EXIT_FAILURE;
+
+  int p = 0, c = 0, q = 0;
+  c += snprintf(capped + c, size - c, "set -o jobs-max=%d; ", n);
+  q += snprintf(pool + q, size - q, "parallel -j %d md5sum :::", n);
+  for (int j = 0; j < jobs; j++) {
+    p += snprintf(plain + p, size - p, "md5sum %s & ", input);
+    c += snprintf(capped + c, size - c, "md5sum %s & ", input);
+    q += snprintf(pool + q, size - q, " %s", input);
+  }
+  snprintf(plain + p, size - p, "wait");
+  snprintf(capped + c, size - c, "wait");
+
+  printf("%d jobs of %d MiB on %d CPUs, %d runs; wall in ms\n", jobs,
+         INPUT_MB, n, reps);
+  printf("  %-12s %9s %9s %9s\n", "variant", "p50 wall", "max wall",
+         "p50 csw");
+  report(tiny, "all at once", plain, reps);
+  report(tiny, "jobs-max", capped, reps);
+  report(tiny, "parallel", pool, reps);
+
+  free(plain);
+  free(capped);
+  free(pool);
+  unlink(input);
+  rmdir(dir);
+  return EXIT_SUCCESS;
+}
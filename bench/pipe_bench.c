@@ -0,0 +1,193 @@
+// Bulk data through four-stage pipelines: throughput, system calls per GiB
+// (every process in the pipeline, counted under ptrace) and context
+// switches, with default pipes and with `set -o pipe-size`. A second pair
+// feeds the pipeline from builtins, one large printf and a stream of small
+// echo commands, to show how many writes their output costs.
+//   TINY             shell under test (default build/tiny)
+//   BENCH_PIPE_MB    bytes through the external pipeline (default 1024)
+//   BENCH_PIPE_SIZE  pipe size for the tuned runs (default 1 MiB)
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_PIPE_MB   1024
+#define DEFAULT_PIPE_SIZE (1 << 20)
+#define PRINTF_ARG        (64 << 10) // bytes per printf argument
+#define PRINTF_MB         64
+#define ECHO_LINES        200000
+
+extern char **environ;
+
+static char dir[] = "/tmp/tiny-pipe-XXXXXX";
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static pid_t spawn_quiet(char **argv) {
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+  pid_t pid;
+  int   err = posix_spawn(&pid, argv[0], &actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  return err ? -1 : pid;
+}
+
+// Wall time in ms, or -1 if the shell failed; `csw` gets the context
+// switches of the shell and everything it ran.
+static double time_run(char **argv, double *csw) {
+  struct rusage before, after;
+  getrusage(RUSAGE_CHILDREN, &before);
+
+  double t0  = now_ms();
+  pid_t  pid = spawn_quiet(argv);
+  int    status;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0) return -1;
+  double wall = now_ms() - t0;
+
+  getrusage(RUSAGE_CHILDREN, &after);
+  *csw = (after.ru_nvcsw - before.ru_nvcsw) +
+         (after.ru_nivcsw - before.ru_nivcsw);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? wall : -1;
+}
+
+// System calls made by the shell and every process it starts. Returns -1
+// where ptrace is not permitted.
+static long count_syscalls(char **argv) {
+  pid_t pid = fork();
+  if (pid < 0) return -1;
+  if (pid == 0) {
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0) dup2(null, 1);
+    if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0) _exit(126);
+    raise(SIGSTOP);
+    execv(argv[0], argv);
+    _exit(127);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  if (!WIFSTOPPED(status)) return -1;
+  long options = PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL |
+                 PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK |
+                 PTRACE_O_TRACECLONE;
+  ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)options);
+  if (ptrace(PTRACE_SYSCALL, pid, NULL, NULL) != 0) return -1;
+
+  long  stops = 0, exits = 0;
+  pid_t who;
+  while ((who = waitpid(-1, &status, __WALL)) > 0) {
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+      exits++;
+      continue;
+    }
+    int sig = 0;
+    if (WSTOPSIG(status) == (SIGTRAP | 0x80)) stops++;
+    else if (status >> 16 == 0 && WSTOPSIG(status) != SIGSTOP &&
+             WSTOPSIG(status) != SIGTRAP) {
+      sig = WSTOPSIG(status);
+    }
+    ptrace(PTRACE_SYSCALL, who, NULL, (void *)(long)sig);
+  }
+  // Entry and exit stops pair up, except for each process's final exit.
+  return (stops + exits) / 2;
+}
+
+static void report(const char *label, const char *tiny, const char *script,
+                   double mb) {
+  char  *argv[] = {(char *)tiny, (char *)script, NULL};
+  double csw;
+  double wall = time_run(argv, &csw);
+  if (wall < 0) {
+    printf("  %-22s failed\n", label);
+    return;
+  }
+  long   calls = count_syscalls(argv);
+  double gb    = mb / 1024;
+  printf("  %-22s %9.0f %9.1f %12.0f %12.0f\n", label, mb / (wall / 1e3),
+         wall, calls < 0 ? -1.0 : calls / gb, csw / gb);
+}
+
+// Writes `set -o pipe-size` (if given), then `head`, `body` `repeat` times,
+// and `tail` as one script.
+static const char *write_script(const char *name, const char *pipe_size,
+                                const char *head, const char *body,
+                                size_t repeat, const char *tail) {
+  static char path[4096];
+  snprintf(path, sizeof path, "%s/%s.sh", dir, name);
+  FILE *f = fopen(path, "w");
+  if (!f) exit(EXIT_FAILURE);
+  if (pipe_size) fprintf(f, "set -o pipe-size=%s\n", pipe_size);
+  fputs(head, f);
+  for (size_t i = 0; i < repeat; i++) fputs(body, f);
+  fputs(tail, f);
+  fclose(f);
+  return path;
+}
+
+int main(void) {
+  const char *tiny    = getenv("TINY");
+  const char *env_mb  = getenv("BENCH_PIPE_MB");
+  const char *env_psz = getenv("BENCH_PIPE_SIZE");
+  long        mb      = env_mb ? atol(env_mb) : DEFAULT_PIPE_MB;
+  char        tuned[32];
+  snprintf(tuned, sizeof tuned, "%ld",
+           env_psz ? atol(env_psz) : (long)DEFAULT_PIPE_SIZE);
+  if (!tiny) tiny = "build/tiny";
+  if (!mkdtemp(dir)) return EXIT_FAILURE;
+
+  printf("throughput in MB/s, wall in ms; per GiB moved\n");
+  printf("  %-22s %9s %9s %12s %12s\n", "pipeline", "MB/s", "wall",
+         "syscalls", "csw");
+
+  char external[256];
+  snprintf(external, sizeof external,
+           "dd if=/dev/zero bs=1M count=%ld status=none | cat | cat | cat\n",
+           mb);
+  report("external, default", tiny,
+         write_script("ext", NULL, external, "", 0, ""), mb);
+  report("external, pipe-size", tiny,
+         write_script("ext_tuned", tuned, external, "", 0, ""), mb);
+
+  // One printf writing PRINTF_MB in PRINTF_ARG-sized arguments.
+  char *arg = malloc(PRINTF_ARG + 2);
+  if (!arg) return EXIT_FAILURE;
+  arg[0] = ' ';
+  memset(arg + 1, 'x', PRINTF_ARG);
+  arg[PRINTF_ARG + 1] = '\0';
+  report("builtin printf", tiny,
+         write_script("printf", tuned, "printf %s", arg,
+                      ((size_t)PRINTF_MB << 20) / PRINTF_ARG,
+                      " | cat | cat | cat\n"),
+         PRINTF_MB);
+  free(arg);
+
+  // Many small echo commands in one pipeline stage.
+  const char *line = "echo a line of text of about the length people echo\n";
+  report("builtin echo x200k", tiny,
+         write_script("echo", tuned, "(\n", line, ECHO_LINES,
+                      ") | cat | cat | cat\n"),
+         ECHO_LINES * (strlen(line) - 5) / 1048576.0);
+
+  const char *names[] = {"ext", "ext_tuned", "printf", "echo"};
+  char        path[4096];
+  for (size_t i = 0; i < sizeof names / sizeof *names; i++) {
+    snprintf(path, sizeof path, "%s/%s.sh", dir, names[i]);
+    unlink(path);
+  }
+  rmdir(dir);
+  return EXIT_SUCCESS;
+}
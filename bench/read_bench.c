@@ -0,0 +1,132 @@
+// The `while read line` loop over a 1M-line file: syscalls and wall time per
+// line for the `read` builtin, against what it did before, one read(2) per
+// byte. The file is read once from disk and once through a pipe, where
+// lines are found by peeking with tee(2).
+//   BENCH_LINES  lines in the file (default 1000000)
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "allocators/arena.h"
+#include "collections/vector.h"
+#include "executor/builtins.h"
+#include "executor/executor.h"
+
+#define DEFAULT_LINES 1000000
+
+static char path[] = "/tmp/tiny-read-XXXXXX";
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// What `read` used to do for each line.
+static bool byte_read(int fd, vector_t *line, unsigned long *syscalls) {
+  for (;;) {
+    char c;
+    (*syscalls)++;
+    if (read(fd, &c, 1) != 1) return false;
+    if (c == '\n') return true;
+    VECTOR_PUSH(line, char, c);
+  }
+}
+
+// Feeds the file to stdin through a pipe from a child.
+static pid_t pipe_stdin(void) {
+  int fds[2];
+  if (pipe(fds) != 0) return -1;
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    int  in = open(path, O_RDONLY);
+    char buf[65536];
+    for (ssize_t n; (n = read(in, buf, sizeof buf)) > 0;) {
+      if (write(fds[1], buf, n) != n) break;
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+  dup2(fds[0], 0);
+  close(fds[0]);
+  return pid;
+}
+
+static void row(const char *name, long lines, unsigned long syscalls,
+                double ns) {
+  printf("  %-22s %10.2f %10.1f %10.0f\n", name, (double)syscalls / lines,
+         ns / lines, ns / 1e6);
+}
+
+int main(void) {
+  const char *env_lines = getenv("BENCH_LINES");
+  long        lines = env_lines ? strtol(env_lines, NULL, 10) : DEFAULT_LINES;
+
+  int fd = mkstemp(path);
+  if (fd < 0) return EXIT_FAILURE;
+  FILE *f = fdopen(fd, "w");
+  for (long i = 0; i < lines; i++) {
+    fprintf(f, "line %ld of the file, with a few fields\n", i);
+  }
+  fclose(f);
+
+  arena_t arena;
+  arena_init(&arena, 1 << 16);
+  executor_t ex;
+  executor_init(&ex, &arena);
+
+  const builtin_t *read_builtin = builtin_lookup("read");
+  char            *argv[]       = {"read", "line", NULL};
+
+  printf("%ld lines; per line: syscalls, ns; total ms\n", lines);
+
+  // Before: one byte per read(2), straight off the file.
+  int in = open(path, O_RDONLY);
+  dup2(in, 0);
+  close(in);
+  unsigned long syscalls = 0;
+  double        t0       = now_ns();
+  for (long i = 0; i < lines; i++) {
+    arena_mark_t mark = arena_mark(&arena);
+    vector_t     line;
+    vector_init(&line, 1, &arena);
+    if (!byte_read(0, &line, &syscalls)) return EXIT_FAILURE;
+    arena_rewind(&arena, mark);
+  }
+  row("byte reads, file", lines, syscalls, now_ns() - t0);
+
+  for (int piped = 0; piped < 2; piped++) {
+    pid_t pid = -1;
+    if (piped) {
+      pid = pipe_stdin();
+    } else {
+      in = open(path, O_RDONLY);
+      dup2(in, 0);
+      close(in);
+    }
+
+    unsigned long start = ex.input.syscalls;
+    t0                  = now_ns();
+    for (long i = 0; i < lines; i++) {
+      arena_mark_t mark = arena_mark(&arena);
+      if (read_builtin->fn(&ex, 2, argv) != 0) return EXIT_FAILURE;
+      arena_rewind(&arena, mark);
+    }
+    row(piped ? "read builtin, pipe" : "read builtin, file", lines,
+        ex.input.syscalls - start, now_ns() - t0);
+    if (pid > 0) waitpid(pid, NULL, 0);
+  }
+
+  unlink(path);
+  executor_free(&ex);
+  arena_free(&arena);
+  return EXIT_SUCCESS;
+}
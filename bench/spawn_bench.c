@@ -0,0 +1,109 @@
+// Per-command latency of the executor's posix_spawn path versus a plain
+// fork+execve, measured with an idle heap and again with a large touched heap.
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "allocators/arena.h"
+#include "executor/executor.h"
+#include "interpreter/ast.h"
+#include "interpreter/parser.h"
+#include "interpreter/scanner.h"
+
+#define DEFAULT_SPAWNS  10000
+#define DEFAULT_HEAP_MB 512
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void report(const char *label, double *samples, int n) {
+  qsort(samples, n, sizeof(double), cmp_double);
+  printf("%-28s p50 %7.1f us  p90 %7.1f us  p99 %7.1f us  max %8.1f us\n",
+         label, samples[n / 2], samples[n * 90 / 100], samples[n * 99 / 100],
+         samples[n - 1]);
+}
+
+static void run_spawn(const char *label, int n, double *samples) {
+  static const char command[] = "/bin/true";
+
+  arena_t arena;
+  arena_init(&arena, 4096);
+  ast_t ast;
+  ast_init(&ast, &arena);
+  executor_t ex;
+  executor_init(&ex, &arena);
+
+  scanner_t scanner;
+  scanner_init(&scanner, command, strlen(command));
+  parser_t parser;
+  parser_init(&parser, &scanner, &ast);
+  ast_ref_t root = parser_parse(&parser);
+
+  arena_mark_t mark = arena_mark(&arena);
+  for (int i = 0; i < n; i++) {
+    double t0 = now_us();
+    exec_run(&ex, &ast, root);
+    samples[i] = now_us() - t0;
+    arena_rewind(&arena, mark);
+  }
+  report(label, samples, n);
+
+  ast_free(&ast);
+  arena_free(&arena);
+}
+
+static void run_fork(const char *label, int n, double *samples) {
+  char *argv[] = {"/bin/true", NULL};
+  for (int i = 0; i < n; i++) {
+    double t0  = now_us();
+    pid_t  pid = fork();
+    if (pid == 0) {
+      execv(argv[0], argv);
+      _exit(127);
+    }
+    waitpid(pid, NULL, 0);
+    samples[i] = now_us() - t0;
+  }
+  report(label, samples, n);
+}
+
+int main(void) {
+  const char *env_n    = getenv("BENCH_SPAWNS");
+  const char *env_heap = getenv("BENCH_HEAP_MB");
+  int         n        = env_n ? atoi(env_n) : DEFAULT_SPAWNS;
+  size_t      heap_mb  = env_heap ? (size_t)atoi(env_heap) : DEFAULT_HEAP_MB;
+
+  double *samples = malloc(n * sizeof(double));
+  if (!samples) return EXIT_FAILURE;
+
+  printf("%d spawns of /bin/true\n", n);
+  run_spawn("spawn, idle heap", n, samples);
+  run_fork("fork+exec, idle heap", n, samples);
+
+  char *heap = malloc(heap_mb << 20);
+  if (!heap) return EXIT_FAILURE;
+  memset(heap, 1, heap_mb << 20);
+
+  char label[64];
+  snprintf(label, sizeof label, "spawn, %zu MiB heap", heap_mb);
+  run_spawn(label, n, samples);
+  snprintf(label, sizeof label, "fork+exec, %zu MiB heap", heap_mb);
+  run_fork(label, n, samples);
+
+  free(heap);
+  free(samples);
+  return EXIT_SUCCESS;
+}
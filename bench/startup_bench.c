@@ -0,0 +1,111 @@
+// Startup cost of `tiny -c true`: wall time per invocation and the number of
+// system calls one invocation makes, next to the same numbers for dash.
+//   TINY      shell under test (default build/tiny)
+//   BENCH_REF reference shell (default /bin/dash)
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_RUNS 2000
+
+extern char **environ;
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Median wall time of `n` runs in microseconds, or -1 if the shell fails.
+static double time_runs(char **argv, int n, double *samples) {
+  for (int i = 0; i < n; i++) {
+    double t0 = now_us();
+    pid_t  pid;
+    int    status;
+    if (posix_spawn(&pid, argv[0], NULL, NULL, argv, environ) != 0) return -1;
+    waitpid(pid, &status, 0);
+    samples[i] = now_us() - t0;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+  }
+  qsort(samples, n, sizeof(double), cmp_double);
+  return samples[n / 2];
+}
+
+// Counts syscall-entry stops under ptrace, including the initial execve.
+// Returns -1 where ptrace is not permitted (containers, Yama).
+static long count_syscalls(char **argv) {
+  pid_t pid = fork();
+  if (pid < 0) return -1;
+  if (pid == 0) {
+    if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0) _exit(126);
+    raise(SIGSTOP);
+    execv(argv[0], argv);
+    _exit(127);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  if (!WIFSTOPPED(status)) return -1;
+  ptrace(PTRACE_SETOPTIONS, pid, NULL,
+         (void *)(long)(PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL));
+
+  long stops = 0;
+  int  sig   = 0;
+  for (;;) {
+    if (ptrace(PTRACE_SYSCALL, pid, NULL, (void *)(long)sig) != 0) return -1;
+    waitpid(pid, &status, 0);
+    if (WIFEXITED(status) || WIFSIGNALED(status)) break;
+    sig = 0;
+    if (WSTOPSIG(status) == (SIGTRAP | 0x80)) stops++;
+    else if (WSTOPSIG(status) != SIGTRAP) sig = WSTOPSIG(status);
+  }
+  // Every call stops on entry and exit except the final exit_group.
+  return (stops + 1) / 2;
+}
+
+static void report(const char *label, char **argv, int n, double *samples) {
+  double median   = time_runs(argv, n, samples);
+  long   syscalls = count_syscalls(argv);
+  if (median < 0) {
+    printf("%-24s failed to run %s\n", label, argv[0]);
+    return;
+  }
+  if (syscalls < 0) {
+    printf("%-24s %8.1f us   syscalls n/a\n", label, median);
+  } else {
+    printf("%-24s %8.1f us   %4ld syscalls\n", label, median, syscalls);
+  }
+}
+
+int main(void) {
+  const char *env_n = getenv("BENCH_RUNS");
+  const char *tiny  = getenv("TINY");
+  const char *ref   = getenv("BENCH_REF");
+  int         n     = env_n ? atoi(env_n) : DEFAULT_RUNS;
+
+  char *tiny_argv[] = {(char *)(tiny ? tiny : "build/tiny"), "-c", "true",
+                       NULL};
+  char *ref_argv[]  = {(char *)(ref ? ref : "/bin/dash"), "-c", "true", NULL};
+
+  double *samples = malloc(n * sizeof(double));
+  if (!samples) return EXIT_FAILURE;
+
+  printf("%d runs of `-c true`, median wall time\n", n);
+  report("tiny", tiny_argv, n, samples);
+  report(ref_argv[0], ref_argv, n, samples);
+
+  free(samples);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+// Script size versus time to the first command and peak memory. Each script
+// is one `exit 0` line (for the first) or a run of `:` commands, generated at
+// several sizes and run from a mapped file and from a pipe.
+//   TINY  shell under test (default build/tiny)
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LINE "  : some padding words to make a typical generated line\n"
+
+extern char **environ;
+
+static const size_t SIZES_MB[] = {1, 16, 128};
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Writes `first` followed by filler lines up to `size` bytes.
+static int make_script(const char *path, const char *first, size_t size) {
+  FILE *f = fopen(path, "w");
+  if (!f) return 0;
+  fputs(first, f);
+  for (size_t n = strlen(first); n < size; n += sizeof LINE - 1) fputs(LINE, f);
+  return fclose(f) == 0;
+}
+
+// Runs tiny on `path`, either by name (mapped) or by feeding it through a
+// pipe to /dev/stdin. Returns wall microseconds; `*rss_kb` gets peak RSS.
+static double run(const char *tiny, const char *path, int piped, long *rss_kb) {
+  char *argv[] = {(char *)tiny, (char *)(piped ? "/dev/stdin" : path), NULL};
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  int fds[2] = {-1, -1};
+  if (piped) {
+    if (pipe(fds) != 0) return -1;
+    posix_spawn_file_actions_adddup2(&actions, fds[0], 0);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+  }
+
+  double t0 = now_us();
+  pid_t  pid;
+  int    err = posix_spawn(&pid, tiny, &actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (err) return -1;
+
+  if (piped) {
+    close(fds[0]);
+    int     in = open(path, O_RDONLY);
+    char    buf[1 << 16];
+    ssize_t n;
+    while (in >= 0 && (n = read(in, buf, sizeof buf)) > 0) {
+      if (write(fds[1], buf, n) != n) break; // tiny exited early
+    }
+    if (in >= 0) close(in);
+    close(fds[1]);
+  }
+
+  int           status;
+  struct rusage ru;
+  wait4(pid, &status, 0, &ru);
+  *rss_kb = ru.ru_maxrss;
+  return now_us() - t0;
+}
+
+int main(void) {
+  const char *tiny = getenv("TINY");
+  if (!tiny) tiny = "build/tiny";
+
+  char path[] = "/tmp/tiny-stream-XXXXXX";
+  int  fd     = mkstemp(path);
+  if (fd < 0) return EXIT_FAILURE;
+  close(fd);
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("%-8s %-6s %16s %16s\n", "size", "input", "first command", "full run");
+  for (size_t i = 0; i < sizeof SIZES_MB / sizeof *SIZES_MB; i++) {
+    size_t size = SIZES_MB[i] << 20;
+    for (int piped = 0; piped <= 1; piped++) {
+      long rss_first, rss_full;
+      make_script(path, "exit 0\n", size);
+      double first = run(tiny, path, piped, &rss_first);
+      make_script(path, ":\n", size);
+      double full = run(tiny, path, piped, &rss_full);
+
+      printf("%4zu MiB %-6s %8.0f us %5ld kB %8.0f ms %5ld kB\n", SIZES_MB[i],
+             piped ? "pipe" : "file", first, rss_first, full / 1e3, rss_full);
+    }
+  }
+
+  unlink(path);
+  return EXIT_SUCCESS;
+}
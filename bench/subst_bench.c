@@ -0,0 +1,88 @@
+// Command substitution: forks and wall time per 10k $(...) expansions. The
+// subshell rows force the old behaviour, a forked copy of the shell for every
+// substitution, around the same builtin bodies that now run in-process.
+//   BENCH_SUBST  substitutions per row (default 10000)
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocators/arena.h"
+#include "executor/executor.h"
+#include "executor/expand.h"
+#include "interpreter/ast.h"
+#include "interpreter/parser.h"
+#include "interpreter/scanner.h"
+
+#define DEFAULT_SUBST 10000
+
+static const char *const CASES[] = {
+    "echo \"$(printf '%s-%s' a b)\"",
+    "echo \"$( (printf '%s-%s' a b) )\"",
+    "echo \"$(pwd)\"",
+    "echo \"$( (pwd) )\"",
+    "echo \"$(echo \"$x\")\"",
+    "echo \"$( (echo \"$x\") )\"",
+    "echo \"$(/bin/echo \"$x\")\"",
+};
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void) {
+  const char *env_subst = getenv("BENCH_SUBST");
+  int         rounds    = env_subst ? atoi(env_subst) : DEFAULT_SUBST;
+  if (rounds <= 0) rounds = DEFAULT_SUBST;
+
+  arena_t parse_arena, exec_arena;
+  arena_init(&parse_arena, 1 << 16);
+  arena_init(&exec_arena, 1 << 16);
+
+  executor_t ex;
+  executor_init(&ex, &exec_arena);
+  exec_setvar(&ex, "x", "some value");
+
+  printf("%-36s %12s %10s\n", "command", "forks/10k", "us/subst");
+  for (size_t c = 0; c < sizeof CASES / sizeof *CASES; c++) {
+    ast_t ast;
+    ast_init(&ast, &parse_arena);
+
+    scanner_t scanner;
+    scanner_init(&scanner, CASES[c], strlen(CASES[c]));
+    parser_t parser;
+    parser_init(&parser, &scanner, &ast);
+    ast_ref_t root = parser_parse(&parser);
+    if (parser.had_error) return EXIT_FAILURE;
+
+    const ast_node_t *node  = ast_node(&ast, root);
+    const ast_word_t *words = ast_args(&ast, node->u.simple.args);
+    uint32_t          count = node->u.simple.args.count;
+    ex.ast                  = &ast;
+
+    arena_mark_t mark  = arena_mark(&exec_arena);
+    unsigned     forks = ex.forks;
+    double       t0    = now_ns();
+    for (int i = 0; i < rounds; i++) {
+      char **argv;
+      int    argc;
+      if (!expand_words(&ex, words, count, &argv, &argc)) return EXIT_FAILURE;
+      arena_rewind(&exec_arena, mark);
+    }
+    double elapsed = now_ns() - t0;
+    printf("%-36s %12.0f %10.2f\n", CASES[c],
+           (ex.forks - forks) * 10000.0 / rounds, elapsed / rounds / 1e3);
+
+    ast_free(&ast);
+    arena_reset(&parse_arena);
+  }
+
+  executor_free(&ex);
+  arena_free(&parse_arena);
+  arena_free(&exec_arena);
+  return EXIT_SUCCESS;
+}
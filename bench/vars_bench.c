@@ -0,0 +1,111 @@
+// Cost of the variable store with a large environment: assignments and
+// lookups, and the per-command price of handing an envp to exec, cached and
+// with one prefix assignment layered over it. The "copy" rows do what the
+// shell did before: copy the whole environment for every command that has
+// prefix assignments, and strcmp each entry against each assignment.
+//   BENCH_VARS  exported variables in the environment (default 5000)
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocators/arena.h"
+#include "executor/vars.h"
+
+#define DEFAULT_VARS 5000
+#define OPS          1000000
+#define EXECS        100000
+
+extern char **environ;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The envp a copying shell builds for `FOO=1 cmd`.
+static char **copy_envp(arena_t *arena, char *entry) {
+  size_t n = 0;
+  while (environ[n]) n++;
+  char **envp = arena_alloc(arena, (n + 2) * sizeof(char *));
+  size_t out  = 0;
+  for (char **e = environ; *e; e++) {
+    if (strncmp(*e, entry, strchr(entry, '=') - entry + 1) != 0) {
+      envp[out++] = *e;
+    }
+  }
+  envp[out++] = entry;
+  envp[out]   = NULL;
+  return envp;
+}
+
+int main(void) {
+  const char *env_vars = getenv("BENCH_VARS");
+  size_t      n        = env_vars ? strtoul(env_vars, NULL, 10) : DEFAULT_VARS;
+
+  char name[32], value[32];
+  for (size_t i = 0; i < n; i++) {
+    snprintf(name, sizeof name, "BENCH_VAR_%zu", i);
+    snprintf(value, sizeof value, "value-%zu", i);
+    setenv(name, value, 1);
+  }
+
+  vars_t  vars;
+  arena_t arena;
+  arena_init(&arena, 1 << 16);
+  double t0 = now_ns();
+  vars_init(&vars);
+  double init = now_ns() - t0;
+
+  printf("%zu exported variables; ns per operation\n", vars.count);
+  printf("  %-28s %9.0f\n", "import environ (total us)", init / 1e3);
+
+  t0 = now_ns();
+  for (size_t i = 0; i < OPS; i++) {
+    snprintf(value, sizeof value, "%zu", i);
+    vars_set(&vars, "counter", value);
+  }
+  printf("  %-28s %9.1f\n", "assign counter", (now_ns() - t0) / OPS);
+
+  t0 = now_ns();
+  size_t found = 0;
+  for (size_t i = 0; i < OPS; i++) {
+    snprintf(name, sizeof name, "BENCH_VAR_%zu", i % n);
+    found += vars_get(&vars, name) != NULL;
+  }
+  printf("  %-28s %9.1f\n", "lookup (incl. snprintf)", (now_ns() - t0) / OPS);
+
+  vars_environ(&vars);
+  t0 = now_ns();
+  for (size_t i = 0; i < EXECS; i++) {
+    snprintf(value, sizeof value, "%zu", i);
+    vars_set(&vars, "BENCH_VAR_0", value);
+    found += vars_environ(&vars) != NULL;
+  }
+  printf("  %-28s %9.1f\n", "envp, exported var changed",
+         (now_ns() - t0) / EXECS);
+
+  char *entry = "FOO=1";
+  t0          = now_ns();
+  for (size_t i = 0; i < EXECS; i++) {
+    found += vars_overlay(&vars, &entry, 1, &arena) != NULL;
+    vars_drop_overlay(&vars);
+    arena_reset(&arena);
+  }
+  printf("  %-28s %9.1f\n", "envp, FOO=1 overlay", (now_ns() - t0) / EXECS);
+
+  t0 = now_ns();
+  for (size_t i = 0; i < EXECS; i++) {
+    found += copy_envp(&arena, entry) != NULL;
+    arena_reset(&arena);
+  }
+  printf("  %-28s %9.1f\n", "envp, FOO=1 copy", (now_ns() - t0) / EXECS);
+
+  if (found == 0) printf("(nothing found)\n");
+  vars_free(&vars);
+  arena_free(&arena);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+// Arena bytes consumed building argv for each parsed simple command, comparing
+// the original copy-on-grow vector with the small-buffer/in-place vector_t.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocators/arena.h"
+#include "collections/vector.h"
+#include "interpreter/ast.h"
+#include "interpreter/parser.h"
+#include "interpreter/scanner.h"
+
+#define COMMANDS 200000
+
+// The pre-SBO vector: every doubling takes a fresh arena block and copies.
+typedef struct {
+  void    *data;
+  size_t   elem_size;
+  size_t   capacity;
+  size_t   length;
+  arena_t *arena;
+} legacy_vector_t;
+
+static int legacy_push(legacy_vector_t *vec, const void *elem) {
+  if (vec->length == vec->capacity) {
+    size_t capacity = vec->capacity ? vec->capacity * 2 : 4;
+    void  *data     = arena_alloc(vec->arena, capacity * vec->elem_size);
+    if (!data) return 0;
+    if (vec->length) memcpy(data, vec->data, vec->length * vec->elem_size);
+    vec->data     = data;
+    vec->capacity = capacity;
+  }
+  memcpy((char *)vec->data + vec->length * vec->elem_size, elem, vec->elem_size);
+  vec->length++;
+  return 1;
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Mostly short commands with a long tail, like interactive and script usage.
+static int random_argc(void) {
+  int r = rand() % 100;
+  if (r < 30) return 1;
+  if (r < 60) return 2;
+  if (r < 80) return 3;
+  if (r < 92) return 4 + rand() % 3;
+  return 7 + rand() % 10;
+}
+
+int main(void) {
+  srand(1);
+
+  arena_t parse_arena, legacy_arena, sbo_arena;
+  arena_init(&parse_arena, 1 << 16);
+  arena_init(&legacy_arena, 1 << 20);
+  arena_init(&sbo_arena, 1 << 20);
+
+  ast_t ast;
+  ast_init(&ast, &parse_arena);
+
+  size_t legacy_bytes = 0, sbo_bytes = 0, words = 0;
+  double legacy_ns = 0, sbo_ns = 0;
+  char   line[512];
+
+  for (int i = 0; i < COMMANDS; i++) {
+    int len = snprintf(line, sizeof line, "cmd%d", i);
+    for (int argc = random_argc(); argc > 1; argc--) {
+      len += snprintf(line + len, sizeof line - len, " arg%d", argc);
+    }
+
+    arena_reset(&parse_arena);
+    ast_reset(&ast);
+
+    scanner_t scanner;
+    scanner_init(&scanner, line, len);
+
+    parser_t parser;
+    parser_init(&parser, &scanner, &ast);
+
+    ast_ref_t root = parser_parse(&parser);
+    if (parser.had_error) return EXIT_FAILURE;
+
+    ast_node_t *node = ast_node(&ast, root);
+    ast_word_t *args = ast_args(&ast, node->u.simple.args);
+    size_t      argc = node->u.simple.args.count;
+    char       *null = NULL;
+    words += argc;
+
+    // The +1 mirrors the NULL terminator every argv needs.
+    arena_reset(&legacy_arena);
+    double          t0     = now_ns();
+    legacy_vector_t legacy = {NULL, sizeof(char *), 0, 0, &legacy_arena};
+    for (size_t j = 0; j < argc; j++) legacy_push(&legacy, &args[j].text);
+    legacy_push(&legacy, &null);
+    legacy_ns += now_ns() - t0;
+    legacy_bytes += legacy_arena.offset;
+
+    arena_reset(&sbo_arena);
+    t0 = now_ns();
+    vector_t argv;
+    vector_init(&argv, sizeof(char *), &sbo_arena);
+    for (size_t j = 0; j < argc; j++) VECTOR_PUSH(&argv, char *, args[j].text);
+    VECTOR_PUSH(&argv, char *, NULL);
+    sbo_ns += now_ns() - t0;
+    sbo_bytes += sbo_arena.offset;
+  }
+
+  printf("commands:               %d (%.2f words avg)\n", COMMANDS,
+         (double)words / COMMANDS);
+  printf("legacy arena bytes/cmd: %.2f (%.1f ns/cmd)\n",
+         (double)legacy_bytes / COMMANDS, legacy_ns / COMMANDS);
+  printf("vector arena bytes/cmd: %.2f (%.1f ns/cmd)\n",
+         (double)sbo_bytes / COMMANDS, sbo_ns / COMMANDS);
+
+  ast_free(&ast);
+  arena_free(&parse_arena);
+  arena_free(&legacy_arena);
+  arena_free(&sbo_arena);
+  return EXIT_SUCCESS;
+}
@@ -3,16 +3,63 @@
 
 #include <stddef.h>
 
+#define ARENA_ALIGN     8
+#define ARENA_MAX_CHUNK (1u << 20) // geometric growth stops doubling here
+
+typedef struct arena_chunk_t arena_chunk_t;
+
+// Chunked bump allocator. `buf`/`capacity`/`offset` describe the newest chunk
+// so the common allocation is a compare and an add; older chunks are only
+// reachable through `chunk->prev` and are released by rewind/reset.
 typedef struct {
-  char  *buf;
-  size_t capacity;
-  size_t offset;
+  char          *buf;
+  size_t         capacity;
+  size_t         offset;
+  arena_chunk_t *chunk;
+  arena_chunk_t *spare; // largest retired chunk, reused before calling malloc
+  size_t         min_chunk;
 } arena_t;
 
+typedef struct {
+  arena_chunk_t *chunk;
+  size_t         offset;
+} arena_mark_t;
+
 int   arena_init(arena_t *a, size_t capacity);
 void  arena_free(arena_t *a);
 void  arena_reset(arena_t *a);
-void *arena_alloc(arena_t *a, size_t n);
+void *arena_alloc_slow(arena_t *a, size_t n);
 char *arena_strndup(arena_t *a, const char *s, size_t n);
 
+static inline void *arena_alloc(arena_t *a, size_t n) {
+  size_t aligned = (n + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+  // `aligned - 1` sends zero-sized requests on an empty arena to the slow path
+  if (aligned - 1 < a->capacity - a->offset) {
+    void *ptr = a->buf + a->offset;
+    a->offset += aligned;
+    return ptr;
+  }
+  return arena_alloc_slow(a, aligned);
+}
+
+static inline arena_mark_t arena_mark(const arena_t *a) {
+  arena_mark_t m = {a->chunk, a->offset};
+  return m;
+}
+
+void arena_rewind(arena_t *a, arena_mark_t mark);
+
+// Grows the most recent allocation `ptr` from `old_n` to `new_n` bytes without
+// moving it. Returns 0 (leaving the arena untouched) when `ptr` is not the
+// last allocation or the current chunk has no room.
+static inline int arena_extend(arena_t *a, void *ptr, size_t old_n,
+                               size_t new_n) {
+  size_t old_aligned = (old_n + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+  size_t new_aligned = (new_n + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+  if ((char *)ptr + old_aligned != a->buf + a->offset) return 0;
+  if (new_aligned - old_aligned > a->capacity - a->offset) return 0;
+  a->offset += new_aligned - old_aligned;
+  return 1;
+}
+
 #endif // ARENA_H
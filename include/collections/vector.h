@@ -6,42 +6,78 @@
 
 #include "allocators/arena.h"
 
+#define VECTOR_INLINE_BYTES 32 // room for 4 pointers before touching the arena
+
+// Growable array. The first few elements live inline in `small`; `data` stays
+// NULL until they spill into the arena, so a vector may be copied by value
+// while it is still small. A spilled buffer that is the arena's most recent
+// allocation is grown in place instead of copied.
 typedef struct {
   void    *data;
   size_t   elem_size;
   size_t   capacity;
   size_t   length;
   arena_t *arena;
+  _Alignas(16) unsigned char small[VECTOR_INLINE_BYTES];
 } vector_t;
 
 static inline void vector_init(vector_t *vec, size_t elem_size, arena_t *arena) {
   vec->data      = NULL;
   vec->elem_size = elem_size;
-  vec->capacity  = 0;
+  vec->capacity  = VECTOR_INLINE_BYTES / elem_size;
   vec->length    = 0;
   vec->arena     = arena;
 }
 
-static inline void vector_reserve(vector_t *vec, size_t capacity) {
+static inline void *vector_data(const vector_t *vec) {
+  return vec->data ? vec->data : (void *)vec->small;
+}
+
+static inline int vector_reserve(vector_t *vec, size_t capacity) {
   if (capacity > vec->capacity) {
-    void *data = arena_alloc(vec->arena, capacity * vec->elem_size);
-    if (vec->length) memcpy(data, vec->data, vec->length * vec->elem_size);
+    size_t old_bytes = vec->capacity * vec->elem_size;
+    size_t new_bytes = capacity * vec->elem_size;
+
+    if (vec->data && arena_extend(vec->arena, vec->data, old_bytes, new_bytes)) {
+      vec->capacity = capacity;
+      return 1;
+    }
+
+    void *data = arena_alloc(vec->arena, new_bytes);
+    if (!data) return 0;
+    if (vec->length) {
+      memcpy(data, vector_data(vec), vec->length * vec->elem_size);
+    }
     vec->data     = data;
     vec->capacity = capacity;
   }
+  return 1;
 }
 
-static inline void vector_push(vector_t *vec, const void *elem) {
-  if (vec->length == vec->capacity) {
-    size_t capacity = vec->capacity ? vec->capacity * 2 : 4;
-    vector_reserve(vec, capacity);
-  }
-  memcpy((char *)vec->data + vec->length * vec->elem_size, elem, vec->elem_size);
+static inline int vector_grow(vector_t *vec) {
+  size_t capacity = vec->capacity ? vec->capacity * 2 : 4;
+  return vector_reserve(vec, capacity);
+}
+
+static inline int vector_push(vector_t *vec, const void *elem) {
+  if (vec->length == vec->capacity && !vector_grow(vec)) return 0;
+  memcpy((char *)vector_data(vec) + vec->length * vec->elem_size, elem,
+         vec->elem_size);
   vec->length++;
+  return 1;
 }
 
 static inline void *vector_get(vector_t *vec, size_t index) {
   if (index >= vec->length) return NULL;
-  return (char *)vec->data + index * vec->elem_size;
+  return (char *)vector_data(vec) + index * vec->elem_size;
 }
+
+// Typed access: `T` must match the `elem_size` the vector was created with.
+// These compile to a plain store/load instead of a `memcpy` of `elem_size`.
+#define VECTOR_PUSH(vec, T, value)                                             \
+  (((vec)->length < (vec)->capacity || vector_grow(vec)) &&                    \
+   (((T *)vector_data(vec))[(vec)->length++] = (value), 1))
+
+#define VECTOR_AT(vec, T, index) (((T *)vector_data(vec))[index])
+
 #endif // VECTOR_H
@@ -0,0 +1,20 @@
+#ifndef ARITH_H
+#define ARITH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "allocators/arena.h"
+#include "executor/executor.h"
+#include "interpreter/ast.h"
+
+typedef struct arith_program arith_program_t;
+
+void             arith_prepare(const ast_t *ast);
+arith_program_t *arith_compile(arena_t *arena, const char *expr,
+                               const char **error);
+bool             arith_run(executor_t *ex, const arith_program_t *program,
+                           int64_t *result);
+bool             arith_eval(executor_t *ex, const char *expr, int64_t *result);
+
+#endif // ARITH_H
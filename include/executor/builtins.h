@@ -0,0 +1,38 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include <stdint.h>
+
+#include "executor/executor.h"
+
+// Changes nothing in the shell but what it writes and its exit status, so it
+// can run in place of a subshell, as in $(printf ...).
+#define BUILTIN_PURE 0x1
+
+typedef int (*builtin_fn)(executor_t *ex, int argc, char **argv);
+
+typedef struct {
+  const char *name;
+  builtin_fn  fn;
+  unsigned    flags; // BUILTIN_*
+} builtin_t;
+
+#define BUILTIN(name, suffix, flags)                                           \
+  int builtin_##suffix(executor_t *ex, int argc, char **argv);
+#include "executor/builtins.def"
+#undef BUILTIN
+
+const builtin_t *builtin_lookup(const char *name);
+int              builtin_flush(executor_t *ex);
+
+// Seeded FNV-1a. Shared with tools/gen_builtins.c, which searches for a seed
+// under which every builtin name lands in its own slot.
+static inline uint32_t builtin_name_hash(uint32_t seed, const char *name) {
+  uint32_t h = 2166136261u ^ seed;
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+    h = (h ^ *p) * 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+#endif // BUILTINS_H
@@ -0,0 +1,11 @@
+#ifndef ELIDE_H
+#define ELIDE_H
+
+#include <stdbool.h>
+
+#include "interpreter/ast.h"
+
+void elide_mark(const ast_t *ast, ast_ref_t root);
+bool elide_pure(const ast_t *ast, ast_ref_t ref);
+
+#endif // ELIDE_H
@@ -0,0 +1,55 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "allocators/arena.h"
+#include "executor/jobs.h"
+#include "executor/lineread.h"
+#include "executor/pathcache.h"
+#include "executor/vars.h"
+#include "interpreter/ast.h"
+
+// State that outlives a single command. `arena` is scratch for argv/envp and
+// redirection plans and may be rewound between commands.
+typedef struct {
+  int          status;       // exit status of the last command ($?)
+  pid_t        last_bg;      // pid of the last background command ($!)
+  pid_t        shell_pid;    // $$, which subshells inherit
+  arena_t     *arena;
+  const ast_t *ast;          // tree being executed
+  pathcache_t  paths;        // remembered command locations
+  vars_t       vars;         // shell variables and the exported environment
+  jobs_t       jobs;         // background commands
+  lineread_t   input;        // what `read` has read ahead of its lines
+  unsigned     jobs_max;     // `set -o jobs-max=N`; 0 leaves `&` unbounded
+  unsigned     pipe_size;    // `set -o pipe-size=N`; 0 keeps the default
+  unsigned     pipe_max;     // /proc/sys/fs/pipe-max-size, read on first use
+  unsigned     substitutions; // command substitutions run so far
+  unsigned     forks;        // children started, by fork() or posix_spawn()
+  unsigned     forks_saved;  // children not started thanks to elide_mark
+  unsigned     loops;        // loops the running command is inside
+  unsigned     breaking;     // loops `break` or `continue` is still leaving
+  uint8_t      ifs[256];     // IFS_SPACE/IFS_DELIM for each byte of $IFS
+  bool         exiting;      // `exit` ran; unwind without running anything else
+  bool         exit_after;   // the process exits once this command is done
+  bool         continuing;   // the last loop left goes round again instead
+  bool         job_control;  // background jobs get their own process group
+  bool         batch_output; // stdout is a pipe stage's; builtins don't flush
+} executor_t;
+
+void        executor_init(executor_t *ex, arena_t *arena);
+void        executor_free(executor_t *ex);
+int         exec_run(executor_t *ex, const ast_t *ast, ast_ref_t root);
+int         exec_inline(executor_t *ex, const ast_t *ast, ast_ref_t root);
+pid_t       exec_start(executor_t *ex, const ast_t *ast, ast_ref_t root,
+                       int out, int spare);
+void        exec_reap(executor_t *ex);
+void        exec_stats(executor_t *ex);
+const char *exec_getvar(executor_t *ex, const char *name);
+int         exec_setvar(executor_t *ex, const char *name, const char *value);
+int         exec_unsetvar(executor_t *ex, const char *name);
+
+#endif // EXECUTOR_H
@@ -0,0 +1,19 @@
+#ifndef EXPAND_H
+#define EXPAND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "executor/executor.h"
+#include "interpreter/ast.h"
+
+#define IFS_SPACE 0x1 // IFS white space: runs of it delimit one field
+#define IFS_DELIM 0x2 // any other IFS byte: each one delimits a field
+
+void  expand_set_ifs(executor_t *ex, const char *ifs);
+bool  expand_words(executor_t *ex, const ast_word_t *words, uint32_t count,
+                   char ***argv, int *argc);
+char *expand_word(executor_t *ex, const ast_word_t *word);
+char *expand_pattern(executor_t *ex, const ast_word_t *word);
+
+#endif // EXPAND_H
@@ -0,0 +1,36 @@
+#ifndef GLOB_H
+#define GLOB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "allocators/arena.h"
+#include "collections/vector.h"
+
+typedef struct {
+  char    *name;
+  uint32_t length;
+  uint8_t  type; // d_type: DT_DIR, DT_LNK, DT_UNKNOWN, ...
+} glob_entry_t;
+
+typedef struct {
+  char         *path; // the directory as the pattern spells it, with its '/'
+  size_t        length;
+  glob_entry_t *entries;
+  size_t        count;
+} glob_dir_t;
+
+// Directory listings read by pathname expansion, kept for one command so
+// that `cp *.c *.h dir/` lists the directory once. Everything lives in the
+// arena, which is what bounds the cache's lifetime.
+typedef struct {
+  arena_t *arena;
+  vector_t dirs;    // glob_dir_t
+  bool     strcoll; // LC_COLLATE is not C: sort with strcoll(3)
+  unsigned reads;   // directories listed, for benchmarks
+} glob_cache_t;
+
+void glob_cache_init(glob_cache_t *cache, arena_t *arena, const char *locale);
+long glob_expand(glob_cache_t *cache, const char *pattern, vector_t *matches);
+
+#endif // GLOB_H
@@ -0,0 +1,71 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+// Finished jobs whose status a non-interactive shell keeps for `wait pid`
+// after dropping the jobs themselves.
+#define JOBS_REMEMBERED 256
+
+typedef enum {
+  JOB_RUNNING,
+  JOB_STOPPED,
+  JOB_DONE,
+} job_state_t;
+
+typedef struct {
+  int         id;         // the n in %n; 0 marks a free slot
+  pid_t       pid;        // also the process group under job control
+  int         pidfd;      // -1 once reaped, or under the SIGCHLD fallback
+  job_state_t state;
+  int         status;     // exit status once JOB_DONE, in $? form
+  char       *command;    // shown by `jobs`; malloc'd and owned by the table
+  uint64_t    started_ns; // CLOCK_MONOTONIC when added
+  uint64_t    elapsed_ns; // run time once JOB_DONE, as seen by the reaper
+} job_t;
+
+typedef struct {
+  pid_t pid;
+  int   status;
+} job_status_t;
+
+// Background jobs, addressed by id (slot index + 1). Exits arrive through one
+// epoll set holding a pidfd per running job, so reaping costs one wakeup per
+// finished job rather than a waitpid scan of every job. Without pidfd_open
+// (or with TINY_JOBS=signalfd) the set holds a signalfd for SIGCHLD instead,
+// which is blocked for the shell and unblocked again in every child.
+typedef struct {
+  job_t       *slots;
+  size_t       capacity;
+  int          top;     // highest id in use; new jobs get top + 1
+  size_t       running; // jobs not yet JOB_DONE
+  size_t       stopped; // of those, the ones JOB_STOPPED
+  int          epfd;    // -1 until the first job starts
+  int          sigfd;   // fallback only
+  bool         use_pidfd;
+  job_status_t retired[JOBS_REMEMBERED]; // ring of jobs_retire's statuses
+  size_t       retired_next;             // where the next one goes
+  size_t       retired_count;
+} jobs_t;
+
+void   jobs_init(jobs_t *jobs);
+void   jobs_free(jobs_t *jobs);
+void   jobs_detach(jobs_t *jobs);
+job_t *jobs_add(jobs_t *jobs, pid_t pid, char *command);
+void   jobs_remove(jobs_t *jobs, job_t *job);
+bool   jobs_poll(jobs_t *jobs, int timeout_ms);
+int    jobs_wait(jobs_t *jobs, job_t *job);
+void   jobs_update(jobs_t *jobs, job_t *job, int wstatus);
+void   jobs_continued(jobs_t *jobs, job_t *job);
+job_t *jobs_wait_any(jobs_t *jobs);
+job_t *jobs_find(jobs_t *jobs, const char *spec);
+void   jobs_print(const jobs_t *jobs, const job_t *job, FILE *out, bool pids);
+void   jobs_notify(jobs_t *jobs, FILE *out);
+void   jobs_retire(jobs_t *jobs);
+bool   jobs_take_status(jobs_t *jobs, pid_t pid, int *status);
+
+#endif // JOBS_H
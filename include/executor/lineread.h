@@ -0,0 +1,32 @@
+#ifndef LINEREAD_H
+#define LINEREAD_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "collections/vector.h"
+
+// Line input for `read`, which must consume exactly one line and leave the
+// rest of the input to whatever runs next. A regular file is read in blocks
+// kept here across calls, and the offset is put back to just past the line;
+// a pipe or socket is peeked at, then only the line is consumed. Anything
+// else is read a byte at a time.
+typedef struct {
+  char           *data;     // heap block: the file from `start`, or a peek
+  size_t          capacity;
+  size_t          length;   // bytes of the file held in `data`
+  off_t           start;    // file offset of data[0]
+  dev_t           dev;      // the file `data` came from, as it was then
+  ino_t           ino;
+  off_t           size;
+  struct timespec mtime;
+  int             peek[2];  // scratch pipe for tee(2), or -1 until needed
+  unsigned long   syscalls; // issued on behalf of `read`, for benchmarks
+} lineread_t;
+
+void lineread_init(lineread_t *lr);
+void lineread_free(lineread_t *lr);
+int  lineread_next(lineread_t *lr, int fd, vector_t *line);
+
+#endif // LINEREAD_H
@@ -0,0 +1,35 @@
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  char    *name; // NULL marks an empty slot
+  char    *path;
+  uint32_t hash;
+  unsigned hits;
+} pathcache_entry_t;
+
+// Remembered command locations (the `hash` builtin). Open addressing with
+// linear probing; entries are heap-allocated because they outlive every
+// command arena. `probes` counts directory candidates examined on misses.
+typedef struct {
+  pathcache_entry_t *slots;
+  size_t             capacity; // power of two, or 0 before first insert
+  size_t             count;
+  unsigned long      hits;
+  unsigned long      misses;
+  unsigned long      probes;
+} pathcache_t;
+
+void        pathcache_init(pathcache_t *pc);
+void        pathcache_free(pathcache_t *pc);
+void        pathcache_clear(pathcache_t *pc);
+const char *pathcache_lookup(pathcache_t *pc, const char *name,
+                             const char *path);
+void        pathcache_forget(pathcache_t *pc, const char *name);
+char       *pathcache_search(pathcache_t *pc, const char *name,
+                             const char *path);
+
+#endif // PATHCACHE_H
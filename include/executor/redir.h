@@ -0,0 +1,41 @@
+#ifndef REDIR_H
+#define REDIR_H
+
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "allocators/arena.h"
+#include "collections/vector.h"
+#include "interpreter/ast.h"
+
+// One step of a redirection plan: make `to` a copy of `from`, or close `to`
+// when `from` is REDIR_CLOSE.
+typedef struct {
+  int from;
+  int to;
+} redir_op_t;
+
+#define REDIR_CLOSE (-1)
+
+// Redirections resolved in the shell before any child exists: files are opened
+// here (close-on-exec, above fd 10) so errors name the file that failed, and
+// what remains is an ordered list of dup2/close steps that can be replayed by
+// posix_spawn file actions, a forked child, or a builtin running in-process.
+typedef struct {
+  vector_t ops;    // redir_op_t, applied in order
+  vector_t opened; // int, fds this plan owns
+} redir_plan_t;
+
+void redir_plan_init(redir_plan_t *plan, arena_t *arena);
+bool redir_plan_add(redir_plan_t *plan, int from, int to);
+bool redir_plan_build(redir_plan_t *plan, const ast_redir_t *redirs,
+                      uint32_t count);
+void redir_plan_release(redir_plan_t *plan);
+bool redir_plan_spawn_actions(const redir_plan_t *plan,
+                              posix_spawn_file_actions_t *actions);
+bool redir_plan_apply(const redir_plan_t *plan);
+bool redir_plan_apply_saving(const redir_plan_t *plan, vector_t *saved);
+void redir_restore(vector_t *saved);
+
+#endif // REDIR_H
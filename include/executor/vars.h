@@ -0,0 +1,72 @@
+#ifndef VARS_H
+#define VARS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "allocators/arena.h"
+
+#define VAR_EXPORT   0x1 // passed to commands in their environment
+#define VAR_READONLY 0x2 // assignment and unset fail
+
+// `entry` holds "name=value", so an exported variable's storage doubles as
+// its environment string. `size` is the room reserved there, or 0 while
+// `entry` still points into the environment the shell inherited.
+typedef struct {
+  const char *name;   // NULL marks an empty slot
+  char       *entry;  // NULL while declared (`export X`) but never set
+  uint32_t    hash;
+  uint32_t    length; // of the name
+  uint32_t    size;
+  int32_t     env;    // index in the cached envp, or -1
+  unsigned    flags;
+} var_t;
+
+// A slot of the cached envp replaced for one exec by vars_overlay.
+typedef struct {
+  size_t index;
+  char  *saved;
+} vars_swap_t;
+
+// Shell variables, in an open-addressing table with linear probing. Names are
+// interned and values stored in the table's own arena, which outlives every
+// command; vars_compact rebuilds it once most of it is dead values.
+//
+// Exported variables reach commands through a cached envp. Only a variable
+// joining or leaving the environment bumps `generation` and forces a rebuild;
+// a new value for an exported variable is patched into its envp slot.
+typedef struct {
+  var_t       *slots;
+  size_t       capacity;   // power of two, or 0 before first insert
+  size_t       count;
+  arena_t      arena;
+  size_t       live;       // arena bytes in use by names and entries
+  size_t       dead;       // arena bytes given up by replaced values
+  char       **envp;       // NULL-terminated, heap-allocated
+  size_t       env_count;
+  size_t       env_capacity;
+  uint64_t     generation; // bumped when the exported set changes
+  uint64_t     built;      // generation `envp` was built for
+  vars_swap_t *swaps;      // overlay in effect, in the caller's arena
+  size_t       swap_count;
+} vars_t;
+
+void        vars_init(vars_t *v);
+void        vars_free(vars_t *v);
+var_t      *vars_find(const vars_t *v, const char *name);
+const char *vars_get(const vars_t *v, const char *name);
+bool        vars_set(vars_t *v, const char *name, const char *value);
+bool        vars_set_flags(vars_t *v, const char *name, unsigned flags);
+bool        vars_unset(vars_t *v, const char *name);
+void        vars_compact(vars_t *v);
+char      **vars_environ(vars_t *v);
+char      **vars_overlay(vars_t *v, char **entries, size_t count,
+                         arena_t *arena);
+void        vars_drop_overlay(vars_t *v);
+
+static inline const char *var_value(const var_t *var) {
+  return var->entry ? var->entry + var->length + 1 : NULL;
+}
+
+#endif // VARS_H
@@ -1,23 +1,77 @@
 #ifndef AST_H
 #define AST_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
-#include "collections/vector.h"
+#include "allocators/arena.h"
 
 typedef enum {
   AST_SIMPLE,     // a bare command (with assignments, argv[], redirs[])
-  AST_PIPELINE,   // cmd1 | cmd2 | ... (vector of AST_SIMPLE or AST_SUBSHELL)
+  AST_PIPELINE,   // cmd1 | cmd2 | ... (range of AST_SIMPLE or AST_SUBSHELL)
   AST_SEQUENCE,   // left ; right
   AST_AND,        // left && right
   AST_OR,         // left || right
   AST_BACKGROUND, // pipeline & (run in background)
-  AST_SUBSHELL    // ( list )
+  AST_SUBSHELL,   // ( list )
+  AST_NOT,        // ! pipeline
+  AST_IF,         // if list; then list; [elif ...] [else list;] fi
+  AST_WHILE,      // while list; do list; done
+  AST_UNTIL,      // until list; do list; done
+  AST_FOR,        // for name [in word...]; do list; done
+  AST_CASE        // case word in pattern) list;; ... esac
 } ast_type_t;
 
+// A run of `count` consecutive items of one of the `ast_t` side arrays.
 typedef struct {
-  char *name;
-  char *value;
+  uint32_t start;
+  uint32_t count;
+} ast_range_t;
+
+typedef enum {
+  PART_LITERAL, // text, already stripped of its quoting
+  PART_PARAM,   // $name or ${name...}
+  PART_COMMAND, // $(text) or `text`
+  PART_ARITH,   // $((word))
+  PART_TILDE    // ~ or ~user at the start of a word
+} ast_part_type_t;
+
+typedef enum {
+  PARAM_VALUE,        // $x ${x}
+  PARAM_LENGTH,       // ${#x}
+  PARAM_DEFAULT,      // ${x-word}
+  PARAM_ASSIGN,       // ${x=word}
+  PARAM_ERROR,        // ${x?word}
+  PARAM_ALTERNATE,    // ${x+word}
+  PARAM_SUFFIX,       // ${x%word}
+  PARAM_LONG_SUFFIX,  // ${x%%word}
+  PARAM_PREFIX,       // ${x#word}
+  PARAM_LONG_PREFIX   // ${x##word}
+} ast_param_op_t;
+
+// One segment of a word. Nested words (the operand of ${x-word}, the
+// expression of $((...))) are ranges of parts stored ahead of their parent.
+typedef struct {
+  uint8_t     type;   // ast_part_type_t
+  uint8_t     op;     // ast_param_op_t, for PART_PARAM
+  bool        quoted; // inside quotes: never split into fields
+  bool        colon;  // ${x:-word}: an empty value counts as unset
+  char       *text;   // literal, parameter name, command, or ~user's name
+  ast_range_t word;
+  void       *code;   // PART_ARITH: program from arith_prepare, or NULL
+} ast_part_t;
+
+// `text` is the word as written. A word with no quoting or expansions has no
+// parts, and its text is its value.
+typedef struct {
+  char       *text;
+  ast_range_t parts;
+} ast_word_t;
+
+typedef struct {
+  char      *name;
+  ast_word_t value;
 } ast_assignment_t;
 
 typedef enum {
@@ -35,44 +89,195 @@ typedef enum {
 typedef struct {
   ast_redir_type_t type;
   int              fd;
-  char            *target;
+  ast_word_t       target; // file, fd, or here-document delimiter
+  ast_word_t       body;   // here-document text, tabs already stripped
 } ast_redir_t;
 
-typedef struct ast_node_t ast_node_t;
+// Nodes are addressed by index into `ast_t.nodes`; AST_NULL marks a missing
+// child (only produced alongside a parse error, or an optional one).
+typedef uint32_t ast_ref_t;
+
+#define AST_NULL UINT32_MAX
 
-struct ast_node_t {
+// One `pattern | pattern) list ;;` of a case command; `body` is AST_NULL
+// when the list is empty.
+typedef struct {
+  ast_range_t patterns; // in `args`
+  ast_ref_t   body;
+} ast_case_item_t;
+
+// ast_node_t.flags, set by the executor's fork-elision pass (elide.c).
+#define AST_TAIL   0x1 // nothing runs after it in the process running it
+#define AST_INLINE 0x2 // AST_SUBSHELL that can run without a fork
+#define AST_CHDIR  0x4 // AST_SUBSHELL with AST_INLINE whose body may `cd`
+
+typedef struct {
   ast_type_t type;
+  uint8_t    flags; // AST_TAIL, AST_INLINE, AST_CHDIR
   union {
     // AST_SIMPLE
     struct {
-      vector_t assigns;
-      vector_t args;
-      vector_t redirs;
+      ast_range_t assigns;
+      ast_range_t args;
+      ast_range_t redirs;
     } simple;
 
     // AST_PIPELINE
     struct {
-      vector_t stages;
+      ast_range_t stages;
     } pipeline;
 
     // AST_SEQUENCE, AST_AND, AST_OR
     struct {
-      ast_node_t *left;
-      ast_node_t *right;
+      ast_ref_t left;
+      ast_ref_t right;
     } binary;
 
     // AST_BACKGROUND
     struct {
-      ast_node_t *child;
+      ast_ref_t child;
     } background;
 
     // AST_SUBSHELL
     struct {
-      ast_node_t *child;
+      ast_ref_t child;
     } subshell;
+
+    // AST_NOT
+    struct {
+      ast_ref_t child;
+    } negation;
+
+    // Compound commands, whose variants all start with the redirections
+    // that apply to the whole command.
+    struct {
+      ast_range_t redirs;
+    } compound;
+
+    // AST_IF. An elif is an AST_IF as the else part.
+    struct {
+      ast_range_t redirs;
+      ast_ref_t   cond;
+      ast_ref_t   then_part;
+      ast_ref_t   else_part; // AST_NULL without one
+    } if_clause;
+
+    // AST_WHILE, AST_UNTIL
+    struct {
+      ast_range_t redirs;
+      ast_ref_t   cond;
+      ast_ref_t   body;
+    } loop;
+
+    // AST_FOR. The first word is the variable's name, the rest are those
+    // after `in`.
+    struct {
+      ast_range_t redirs;
+      ast_range_t words;
+      ast_ref_t   body;
+    } for_clause;
+
+    // AST_CASE
+    struct {
+      ast_range_t redirs;
+      ast_range_t items;
+      uint32_t    subject; // the word, in `args`
+    } case_clause;
   } u;
-};
+} ast_node_t;
+
+#define AST_POOL(T)                                                            \
+  struct {                                                                     \
+    T       *items;                                                            \
+    uint32_t length;                                                           \
+    uint32_t capacity;                                                         \
+  }
+
+// Flat AST: every node sits in one pool and the variable-length parts of a node
+// are ranges into shared side arrays. The pools are heap-backed and survive
+// `ast_reset`, so parsing command after command reuses the same memory; the
+// strings they point to belong to `arena`.
+typedef struct {
+  AST_POOL(ast_node_t) nodes;
+  AST_POOL(ast_word_t) args;
+  AST_POOL(ast_part_t) parts;
+  AST_POOL(ast_assignment_t) assigns;
+  AST_POOL(ast_redir_t) redirs;
+  AST_POOL(ast_ref_t) stages;
+  AST_POOL(ast_ref_t) scratch; // stages of pipelines still being parsed
+  AST_POOL(ast_case_item_t) items;
+  AST_POOL(ast_case_item_t) open_items; // items of cases still being parsed
+  arena_t *arena;
+} ast_t;
+
+void ast_init(ast_t *ast, arena_t *arena);
+void ast_free(ast_t *ast);
+void ast_reset(ast_t *ast);
+
+// Builder. Items added to a simple command must be added while it is the most
+// recently begun one, which is how the parser produces them anyway.
+ast_ref_t ast_add_binary(ast_t *ast, ast_type_t type, ast_ref_t left,
+                         ast_ref_t right);
+ast_ref_t ast_add_unary(ast_t *ast, ast_type_t type, ast_ref_t child);
+ast_ref_t ast_begin_simple(ast_t *ast);
+bool      ast_simple_add_arg(ast_t *ast, ast_ref_t simple, ast_word_t arg);
+bool      ast_simple_add_assign(ast_t *ast, ast_ref_t simple,
+                                ast_assignment_t assign);
+bool      ast_simple_add_redir(ast_t *ast, ast_ref_t simple, ast_redir_t redir);
+uint32_t  ast_begin_pipeline(ast_t *ast);
+bool      ast_pipeline_add_stage(ast_t *ast, ast_ref_t stage);
+ast_ref_t ast_end_pipeline(ast_t *ast, uint32_t mark);
+bool      ast_add_parts(ast_t *ast, const ast_part_t *parts, uint32_t count,
+                        ast_range_t *range);
+
+// Compound commands. A run of words (a for's name and list, a case's word,
+// an item's patterns) is added with nothing else added to `args` in between;
+// items of nested cases are stacked like the stages of nested pipelines.
+ast_ref_t   ast_add_if(ast_t *ast, ast_ref_t cond, ast_ref_t then_part,
+                       ast_ref_t else_part);
+ast_ref_t   ast_add_loop(ast_t *ast, ast_type_t type, ast_ref_t cond,
+                         ast_ref_t body);
+ast_ref_t   ast_add_for(ast_t *ast, ast_range_t words, ast_ref_t body);
+ast_range_t ast_begin_words(const ast_t *ast);
+bool        ast_add_word(ast_t *ast, ast_range_t *words, ast_word_t word);
+uint32_t    ast_begin_case(ast_t *ast);
+bool        ast_case_add_item(ast_t *ast, ast_case_item_t item);
+ast_ref_t   ast_end_case(ast_t *ast, uint32_t mark, uint32_t subject);
+bool        ast_compound_add_redir(ast_t *ast, ast_ref_t compound,
+                                   ast_redir_t redir);
+
+static inline ast_node_t *ast_node(const ast_t *ast, ast_ref_t ref) {
+  return &ast->nodes.items[ref];
+}
+
+static inline ast_word_t *ast_args(const ast_t *ast, ast_range_t r) {
+  return ast->args.items + r.start;
+}
+
+static inline ast_part_t *ast_parts(const ast_t *ast, ast_range_t r) {
+  return ast->parts.items + r.start;
+}
+
+static inline ast_assignment_t *ast_assigns(const ast_t *ast, ast_range_t r) {
+  return ast->assigns.items + r.start;
+}
+
+static inline ast_redir_t *ast_redirs(const ast_t *ast, ast_range_t r) {
+  return ast->redirs.items + r.start;
+}
+
+static inline ast_ref_t *ast_stages(const ast_t *ast, ast_range_t r) {
+  return ast->stages.items + r.start;
+}
+
+static inline ast_case_item_t *ast_items(const ast_t *ast, ast_range_t r) {
+  return ast->items.items + r.start;
+}
+
+// Compound commands are the types from AST_IF on; each has `u.compound`.
+static inline bool ast_is_compound(ast_type_t type) { return type >= AST_IF; }
 
-void ast_dump(ast_node_t *root);
+const char *ast_redir_op(ast_redir_type_t type);
+void        ast_dump(const ast_t *ast, ast_ref_t root);
 
 #endif // AST_H
@@ -0,0 +1,36 @@
+#ifndef CHARCLASS_H
+#define CHARCLASS_H
+
+#include <stddef.h>
+
+// Byte classes used by the scanner. ASCII only, independent of the locale.
+enum {
+  CC_BLANK    = 1 << 0, // ' ', '\t', '\r'
+  CC_NEWLINE  = 1 << 1, // '\n'
+  CC_ALPHA    = 1 << 2, // [A-Za-z_]
+  CC_DIGIT    = 1 << 3, // [0-9]
+  CC_OPERATOR = 1 << 4, // first byte of a multi-char operator: | & < >
+  CC_BREAK    = 1 << 5, // ends a word: blanks, newline, | & ; < > ( )
+  CC_NUL      = 1 << 6, // '\0' terminates scanning like the end of input
+  CC_QUOTE    = 1 << 7, // starts quoting or a substitution: ' " \ ` $
+};
+
+extern const unsigned char cc_table[256];
+
+static inline unsigned cc_class(char c) { return cc_table[(unsigned char)c]; }
+
+// Each returns the first byte in [p, end) that is *not* in the named run.
+// Implementations are picked once at runtime (AVX2, SSE2 or scalar).
+typedef struct {
+  const char *(*skip_blanks)(const char *p, const char *end);
+  const char *(*span_name)(const char *p, const char *end);   // [A-Za-z0-9_]
+  const char *(*span_digits)(const char *p, const char *end); // [0-9]
+  const char *(*span_word)(const char *p, const char *end);   // plain word
+  const char *name;
+} cc_ops_t;
+
+extern cc_ops_t cc_ops;
+
+void cc_init(void);
+
+#endif // CHARCLASS_H
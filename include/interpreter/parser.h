@@ -7,17 +7,36 @@
 #include "interpreter/ast.h"
 #include "interpreter/scanner.h"
 
+#define PARSER_LOOKAHEAD 2 // tokens visible past `cur` via parser_peek
+#define PARSER_RING_SIZE 4 // prev + cur + lookahead, a power of two
+
+// Tokens live in a fixed ring, so parsing any amount of input holds a constant
+// number of them; `cur` and `prev` point into the ring (NULL at end of input)
+// and stay valid until the next advance.
 typedef struct {
   scanner_t *scanner;
+  token_t    ring[PARSER_RING_SIZE];
+  unsigned   head;     // ring slot of `cur`
+  unsigned   buffered; // scanned tokens from `head` onward, `cur` included
   token_t   *cur;
   token_t   *prev;
-  arena_t   *arena;
+  ast_t     *ast;
+  arena_t   *arena; // owns the strings of `ast`
   bool       had_error;
+
+  // Here-document redirections (indices into `ast->redirs`) still waiting
+  // for their bodies, in the order the scanner reads them.
+  uint32_t heredocs[SCANNER_HEREDOCS];
+  unsigned here_first;
+  unsigned here_count;
 } parser_t;
 
-void        parser_init(parser_t *parser, scanner_t *scanner, arena_t *arena);
-ast_node_t *parser_parse(parser_t *parser);
-void        parser_error(parser_t *parser, const char *message);
-void        parser_synchronize(parser_t *parser);
+void      parser_init(parser_t *parser, scanner_t *scanner, ast_t *ast);
+ast_ref_t parser_parse(parser_t *parser);
+ast_ref_t parser_next(parser_t *parser);
+bool      parser_at_end(parser_t *parser);
+token_t  *parser_peek(parser_t *parser, unsigned n);
+void      parser_error(parser_t *parser, const char *message);
+void      parser_synchronize(parser_t *parser);
 
 #endif // PARSER_H
@@ -1,6 +1,7 @@
 #ifndef SCANNER_H
 #define SCANNER_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 #include "allocators/arena.h"
@@ -8,7 +9,7 @@
 typedef enum {
   // Basic tokens
   TOK_WORD,            // default token
-  TOK_ASSIGNMENT_WORD, // "COUNT" in `COUNT=3`
+  TOK_ASSIGNMENT_WORD, // "COUNT=3" in `COUNT=3 cmd`
   TOK_NEWLINE,         // `\n`
   TOK_IO_NUMBER,       // “2” in `2>err`
 
@@ -16,6 +17,7 @@ typedef enum {
   TOK_PIPE,        // |
   TOK_AMP,         // &
   TOK_SEMI,        // ;
+  TOK_DSEMI,       // ;;
   TOK_LESS,        // <
   TOK_GREAT,       // >
   TOK_L_PAREN,     // (
@@ -29,7 +31,25 @@ typedef enum {
   TOK_LESS_GREAT,  // <>
   TOK_D_LESS_DASH, // <<-
   TOK_CLOBBER,     // >|
-  // TODO: add scripting tokens
+
+  TOK_EOF, // end of input
+
+  // Reserved words. The scanner returns them as TOK_WORD; the parser asks
+  // scanner_reserved where one may stand.
+  TOK_IF,
+  TOK_THEN,
+  TOK_ELSE,
+  TOK_ELIF,
+  TOK_FI,
+  TOK_DO,
+  TOK_DONE,
+  TOK_CASE,
+  TOK_ESAC,
+  TOK_WHILE,
+  TOK_UNTIL,
+  TOK_FOR,
+  TOK_IN,
+  TOK_BANG, // !
 } token_type_t;
 
 typedef struct {
@@ -37,26 +57,79 @@ typedef struct {
   size_t stop;
 } token_span_t;
 
+// Tokens do not own their text: `span` holds absolute byte offsets into the
+// scanner's input, and the lexeme stays readable while the span is at or
+// after the scanner's `keep` point. Row and column are derived on demand with
+// `scanner_locate`. A word is `plain` when it has no quoting or substitution,
+// so its lexeme is already its value.
 typedef struct {
   token_type_t type;
-  char       *lexeme;
-  char       *literal;
   token_span_t span;
-  unsigned int row;
-  unsigned int column;
+  bool         plain;
 } token_t;
 
+#define SCANNER_HEREDOCS 16 // here-documents pending on one line, power of two
+
+// A here-document whose operator and delimiter have been scanned. Its body is
+// the raw text of the lines after the next newline, up to (not including) the
+// delimiter line; `read` is set once those lines have been scanned past.
 typedef struct {
-  char        *buf;
-  char        *start;
-  char        *current;
-  unsigned int row;
-  unsigned int col;
-  arena_t     *arena;
-} scanner_t;
-
-void     scanner_init(scanner_t *s, char *source, arena_t *arena);
-token_t *next_token(scanner_t *s);
-void     token_print(const token_t *tok);
+  token_span_t delim;
+  token_span_t body;
+  bool         strip; // `<<-`: leading tabs are not part of any line
+  bool         read;
+} scanner_heredoc_t;
+
+typedef struct scanner_t scanner_t;
+
+// Called when scanning reaches `end`. It makes more input visible, possibly
+// moving `buf` (and raising `base`) after discarding whole lines that lie
+// before `keep`. Returns false once the input is exhausted.
+typedef bool (*scanner_refill_fn)(scanner_t *s);
+
+struct scanner_t {
+  const char       *buf;
+  const char       *end;
+  const char       *start;
+  const char       *current;
+  size_t            base;  // absolute offset of buf[0]
+  size_t            keep;  // earliest offset the parser may still read
+  unsigned          lines; // newlines in the discarded input before `buf`
+  scanner_refill_fn refill;
+  void             *ctx;   // owned by `refill`
+
+  scanner_heredoc_t heredocs[SCANNER_HEREDOCS];
+  unsigned          here_first; // oldest heredoc not yet taken
+  unsigned          here_count;
+  token_type_t      here_op;    // last token, if `<<` or `<<-`
+};
+
+void         scanner_init(scanner_t *s, const char *source, size_t length);
+void         scanner_init_stream(scanner_t *s, scanner_refill_fn refill,
+                                 void *ctx);
+bool         next_token(scanner_t *s, token_t *tok);
+void         scanner_locate(const scanner_t *s, size_t offset,
+                            unsigned int *row, unsigned int *col);
+token_type_t scanner_reserved(const scanner_t *s, const token_t *tok);
+bool         scanner_take_heredoc(scanner_t *s, scanner_heredoc_t *doc);
+char        *token_strdup(const scanner_t *s, const token_t *tok,
+                          arena_t *arena);
+char        *heredoc_strdup(const scanner_t *s, const scanner_heredoc_t *doc,
+                            arena_t *arena);
+void         token_print(const scanner_t *s, const token_t *tok);
+
+static inline const char *token_lexeme(const scanner_t *s, const token_t *tok) {
+  return s->buf + (tok->span.start - s->base);
+}
+
+// Declares that nothing before `offset` will be read again, so a refill may
+// drop it. Called at command boundaries.
+static inline void scanner_release(scanner_t *s, size_t offset) {
+  if (offset > s->keep) s->keep = offset;
+}
+
+static inline size_t token_length(const token_t *tok) {
+  return tok->span.stop - tok->span.start;
+}
 
 #endif // SCANNER_H
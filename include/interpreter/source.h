@@ -0,0 +1,37 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "interpreter/scanner.h"
+
+#define SOURCE_BLOCK  (64u << 10) // read() size for pipes and other streams
+#define SOURCE_WINDOW (1u << 20)  // mapped bytes handed to the scanner at once
+
+// Script input for the scanner. Regular files are mapped and exposed a window
+// at a time, with pages behind the parser dropped as it moves on; anything
+// else is read in blocks into a buffer that only keeps the command being
+// parsed. Either way nothing is read ahead of need, and memory follows the
+// largest command rather than the size of the script.
+typedef struct {
+  int    fd;
+  char  *data;     // the mapping, or the stream buffer
+  size_t length;   // mapped bytes, or valid bytes in the stream buffer
+  size_t capacity; // stream buffer size
+  size_t released; // mapped bytes already returned with MADV_DONTNEED
+  bool   mapped;
+  off_t  synced; // fd offset source_sync left, the end of the last command
+  off_t  ahead;  // fd offset before it, the end of what was read ahead
+} source_t;
+
+// Takes ownership of `fd`, even on failure (false, with errno set). With
+// `map` false the input is always read as a stream, which source_sync needs.
+bool source_open(source_t *src, int fd, bool map);
+void source_close(source_t *src);
+void source_attach(source_t *src, scanner_t *s);
+bool source_sync(source_t *src, const scanner_t *s);
+void source_resume(source_t *src, scanner_t *s);
+
+#endif // SOURCE_H
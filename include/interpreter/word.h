@@ -0,0 +1,16 @@
+#ifndef WORD_H
+#define WORD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "interpreter/ast.h"
+
+#define WORD_DQUOTE  0x1 // the text sits inside "...": only $ ` \ are special
+#define WORD_HEREDOC 0x2 // a here-document body: as WORD_DQUOTE, but \" stays
+
+const char *word_skip(const char *p, const char *end);
+bool        word_parse(ast_t *ast, const char *text, size_t length,
+                       unsigned flags, ast_range_t *parts, const char **error);
+
+#endif // WORD_H
@@ -3,6 +3,7 @@
 
 #include "allocators/arena.h"
 
-void repl_run(arena_t *arena);
+// Returns the status of the last command, or the one given to `exit`.
+int repl_run(arena_t *arena);
 
 #endif // REPL_H
@@ -0,0 +1,15 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stddef.h>
+
+#include "allocators/arena.h"
+
+// Non-interactive execution: no greeting, no line editor, no terminal access.
+// Each complete command is parsed and run before the next one is read, and a
+// syntax error stops the script with status 2. Both return the exit status.
+int script_run(arena_t *arena, const char *source, size_t length);
+int script_run_file(arena_t *arena, const char *path);
+int script_run_stdin(arena_t *arena);
+
+#endif // SCRIPT_H
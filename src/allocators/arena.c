@@ -3,27 +3,85 @@
 #include <stdlib.h>
 #include <string.h>
 
+struct arena_chunk_t {
+  arena_chunk_t *prev;
+  size_t         capacity;
+  _Alignas(16) char data[];
+};
+
+static void use_chunk(arena_t *a, arena_chunk_t *c, size_t offset);
+static void retire_chunk(arena_t *a, arena_chunk_t *c);
+
+// Nothing is allocated until the first arena_alloc, so a command that never
+// parses anything (or fails early) never pays for a chunk.
 int arena_init(arena_t *a, size_t capacity) {
-  a->buf = malloc(capacity);
-  if (!a->buf) return 0;
-  a->capacity = capacity;
-  a->offset   = 0;
+  a->buf       = NULL;
+  a->capacity  = 0;
+  a->offset    = 0;
+  a->chunk     = NULL;
+  a->spare     = NULL;
+  a->min_chunk = capacity ? capacity : 4096;
   return 1;
 }
 
 void arena_free(arena_t *a) {
-  free(a->buf);
-  a->buf = NULL;
+  arena_chunk_t *c = a->chunk;
+  while (c) {
+    arena_chunk_t *prev = c->prev;
+    free(c);
+    c = prev;
+  }
+  free(a->spare);
+  a->buf      = NULL;
+  a->capacity = 0;
+  a->offset   = 0;
+  a->chunk    = NULL;
+  a->spare    = NULL;
 }
 
-void arena_reset(arena_t *a) { a->offset = 0; }
+// Keeps a single chunk (the largest seen) so a burst of allocations does not
+// pin its high-water mark for the lifetime of the arena.
+void arena_reset(arena_t *a) {
+  arena_mark_t empty = {NULL, 0};
+  arena_rewind(a, empty);
+}
 
-void *arena_alloc(arena_t *a, size_t n) {
-  size_t aligned = (n + 7) & ~7;
-  if (a->offset + aligned > a->capacity) return NULL;
-  void *ptr = a->buf + a->offset;
-  a->offset += aligned;
-  return ptr;
+void arena_rewind(arena_t *a, arena_mark_t mark) {
+  while (a->chunk != mark.chunk) {
+    arena_chunk_t *c = a->chunk;
+    a->chunk         = c->prev;
+    retire_chunk(a, c);
+  }
+  use_chunk(a, a->chunk, mark.offset);
+}
+
+void *arena_alloc_slow(arena_t *a, size_t n) {
+  arena_chunk_t *c;
+
+  if (a->buf && n <= a->capacity - a->offset) {
+    void *ptr = a->buf + a->offset;
+    a->offset += n;
+    return ptr;
+  }
+
+  if (a->spare && a->spare->capacity >= n) {
+    c        = a->spare;
+    a->spare = NULL;
+  } else {
+    size_t capacity = a->chunk ? a->chunk->capacity * 2 : a->min_chunk;
+    if (capacity > ARENA_MAX_CHUNK) capacity = ARENA_MAX_CHUNK;
+    if (capacity < a->min_chunk) capacity = a->min_chunk;
+    if (capacity < n) capacity = n;
+
+    c = malloc(sizeof(arena_chunk_t) + capacity);
+    if (!c) return NULL;
+    c->capacity = capacity;
+  }
+
+  c->prev  = a->chunk;
+  a->chunk = c;
+  use_chunk(a, c, n);
+  return c->data;
 }
 
 char *arena_strndup(arena_t *a, const char *s, size_t n) {
@@ -33,3 +91,20 @@ char *arena_strndup(arena_t *a, const char *s, size_t n) {
   dst[n] = '\0';
   return dst;
 }
+
+static void use_chunk(arena_t *a, arena_chunk_t *c, size_t offset) {
+  a->buf      = c ? c->data : NULL;
+  a->capacity = c ? c->capacity : 0;
+  a->offset   = offset;
+}
+
+static void retire_chunk(arena_t *a, arena_chunk_t *c) {
+  if (!a->spare) {
+    a->spare = c;
+  } else if (c->capacity > a->spare->capacity) {
+    free(a->spare);
+    a->spare = c;
+  } else {
+    free(c);
+  }
+}
@@ -0,0 +1,621 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "collections/vector.h"
+#include "executor/arith.h"
+#include "executor/executor.h"
+
+// $((...)) is compiled to code for a small stack machine, and evaluated by
+// running it. An expression whose text is fixed, which is most of them, is
+// compiled once by arith_prepare and its program hung on the AST part, so a
+// loop body runs bytecode rather than parsing the text on every iteration.
+//
+// Values are 64-bit signed integers that wrap on overflow, as in the other
+// shells. A name stands for its variable, looked up in the variable store
+// when the code runs and read as an integer constant; unset or empty is 0.
+// Constant operands are folded as the code is emitted, including the
+// conditions of && || ?: whose untaken side is then dropped.
+
+typedef enum {
+  A_PUSH,   // consts[arg]
+  A_LOAD,   // the variable names[arg]
+  A_STORE,  // the top into names[arg], leaving it there
+  A_NEG,
+  A_NOT,
+  A_BITNOT,
+  A_BOOL,   // the top as 0 or 1
+  A_OR,     // binary operators, which pop their right operand
+  A_AND,
+  A_BITOR,
+  A_XOR,
+  A_BITAND,
+  A_EQ,
+  A_NE,
+  A_LT,
+  A_LE,
+  A_GT,
+  A_GE,
+  A_SHL,
+  A_SHR,
+  A_ADD,
+  A_SUB,
+  A_MUL,
+  A_DIV,
+  A_MOD,
+  A_JFALSE, // top is 0: jump to arg, keeping it; else pop it
+  A_JTRUE,  // top is not 0: make it 1 and jump to arg; else pop it
+  A_JZ,     // pop, and jump to arg if it was 0
+  A_JMP,
+} arith_op_t;
+
+typedef struct {
+  uint8_t  op;  // arith_op_t
+  uint32_t arg;
+} insn_t;
+
+struct arith_program {
+  const char  *text;  // for error messages
+  insn_t      *code;
+  int64_t     *consts;
+  const char **names;
+  uint32_t     count;
+  uint32_t     depth; // stack slots the code needs
+};
+
+// Two-byte operators come first so the longest match wins. && and || are
+// compiled to jumps; their opcodes only name them here.
+static const struct {
+  const char *text;
+  uint8_t     op;
+  uint8_t     prec;
+} BINARY[] = {
+    {"||", A_OR, 1},   {"&&", A_AND, 2},    {"==", A_EQ, 6},
+    {"!=", A_NE, 6},   {"<=", A_LE, 7},     {">=", A_GE, 7},
+    {"<<", A_SHL, 8},  {">>", A_SHR, 8},    {"|", A_BITOR, 3},
+    {"^", A_XOR, 4},   {"&", A_BITAND, 5},  {"<", A_LT, 7},
+    {">", A_GT, 7},    {"+", A_ADD, 9},     {"-", A_SUB, 9},
+    {"*", A_MUL, 10},  {"/", A_DIV, 10},    {"%", A_MOD, 10},
+};
+
+#define BINARY_COUNT (sizeof BINARY / sizeof *BINARY)
+#define ARITH_STACK  16 // slots on the C stack; deeper code takes the arena
+
+typedef struct {
+  const char *p;
+  const char *error;
+  arena_t    *arena;
+  vector_t    code;   // insn_t
+  vector_t    consts; // int64_t
+  vector_t    names;  // const char *
+  uint32_t    floor;  // code before it may be jumped past: never folded
+  uint32_t    depth;
+  uint32_t    max;
+} compiler_t;
+
+// Code emitted after a mark can be dropped again by restore.
+typedef struct {
+  size_t   count;
+  uint32_t floor;
+  uint32_t depth;
+} mark_t;
+
+static bool    compile_assign(compiler_t *c);
+static bool    compile_ternary(compiler_t *c);
+static bool    compile_binary(compiler_t *c, int min_prec);
+static bool    compile_logic(compiler_t *c, uint8_t op, int prec);
+static bool    compile_unary(compiler_t *c);
+static int     match_binary(const char *p);
+static bool    emit(compiler_t *c, uint8_t op, uint32_t arg);
+static bool    emit_unary(compiler_t *c, uint8_t op);
+static bool    emit_binary(compiler_t *c, uint8_t op);
+static bool    push_const(compiler_t *c, int64_t value);
+static bool    take_const(compiler_t *c, int64_t *value);
+static bool    const_at(compiler_t *c, size_t index, int64_t *value);
+static bool    intern(compiler_t *c, const char *name, size_t n,
+                      uint32_t *index);
+static void    place(compiler_t *c, size_t jump);
+static mark_t  mark(const compiler_t *c);
+static void    restore(compiler_t *c, mark_t m);
+static bool    unary(uint8_t op, int64_t v, int64_t *out);
+static bool    apply(uint8_t op, int64_t l, int64_t r, int64_t *out);
+static bool    load(executor_t *ex, const char *name, int64_t *v);
+static bool    store(executor_t *ex, const char *name, int64_t v);
+static bool    fail(compiler_t *c, const char *message);
+static void    skip_space(compiler_t *c);
+static int64_t wrap_neg(int64_t v);
+
+// Compiles every $((...)) in `ast` whose text holds no expansions, into the
+// AST's own arena, so the programs live exactly as long as the parts they
+// hang on. One that fails to compile is left alone and reports its error
+// when it is evaluated, as if it had never been looked at.
+void arith_prepare(const ast_t *ast) {
+  for (uint32_t i = 0; i < ast->parts.length; i++) {
+    ast_part_t *part = &ast->parts.items[i];
+    if (part->type != PART_ARITH || part->code) continue;
+
+    const ast_part_t *word   = ast_parts(ast, part->word);
+    uint32_t          count  = part->word.count;
+    size_t            length = 0;
+    uint32_t          j      = 0;
+    for (; j < count && word[j].type == PART_LITERAL; j++) {
+      length += strlen(word[j].text);
+    }
+    if (j < count) continue;
+
+    char *text = count == 1 ? word[0].text : NULL;
+    if (count != 1) {
+      text = arena_alloc(ast->arena, length + 1);
+      if (!text) continue;
+      text[0] = '\0';
+      for (j = 0; j < count; j++) strcat(text, word[j].text);
+    }
+    const char *error;
+    part->code = arith_compile(ast->arena, text, &error);
+  }
+}
+
+// NULL with `*error` set when `expr` is not a valid expression, or when out
+// of memory.
+arith_program_t *arith_compile(arena_t *arena, const char *expr,
+                               const char **error) {
+  compiler_t c = {.p = expr, .arena = arena};
+  vector_init(&c.code, sizeof(insn_t), arena);
+  vector_init(&c.consts, sizeof(int64_t), arena);
+  vector_init(&c.names, sizeof(const char *), arena);
+
+  skip_space(&c);
+  bool ok = !*c.p ? push_const(&c, 0) : compile_assign(&c); // $(( )) is 0
+  if (ok) {
+    skip_space(&c);
+    if (*c.p) ok = fail(&c, "syntax error");
+  }
+
+  // One block, out of the vectors, whose first elements may still be inline.
+  size_t code   = c.code.length * sizeof(insn_t);
+  size_t consts = c.consts.length * sizeof(int64_t);
+  size_t names  = c.names.length * sizeof(const char *);
+  arith_program_t *program =
+      ok ? arena_alloc(arena, sizeof *program + code + consts + names) : NULL;
+  if (!program) {
+    *error = ok ? "out of memory" : c.error;
+    return NULL;
+  }
+  program->consts = (int64_t *)(program + 1);
+  program->names  = (const char **)((char *)program->consts + consts);
+  program->code   = (insn_t *)((char *)program->names + names);
+  program->text   = expr;
+  program->count  = (uint32_t)c.code.length;
+  program->depth  = c.max;
+  memcpy(program->consts, vector_data(&c.consts), consts);
+  memcpy(program->names, vector_data(&c.names), names);
+  memcpy(program->code, vector_data(&c.code), code);
+  return program;
+}
+
+// Reports its own errors.
+bool arith_run(executor_t *ex, const arith_program_t *program,
+               int64_t *result) {
+  int64_t  small[ARITH_STACK];
+  int64_t *stack = program->depth <= ARITH_STACK
+                       ? small
+                       : arena_alloc(ex->arena, program->depth * sizeof *stack);
+  if (!stack) {
+    fprintf(stderr, "tiny: out of memory\n");
+    return false;
+  }
+
+  const insn_t *code  = program->code;
+  int64_t      *sp    = stack - 1;
+  const char   *error = NULL;
+  for (uint32_t pc = 0; pc < program->count && !error;) {
+    insn_t in = code[pc++];
+    switch ((arith_op_t)in.op) {
+      case A_PUSH: *++sp = program->consts[in.arg]; break;
+      case A_LOAD:
+        if (!load(ex, program->names[in.arg], ++sp)) error = "bad number";
+        break;
+      case A_STORE:
+        if (!store(ex, program->names[in.arg], *sp)) return false;
+        break;
+      case A_NEG:
+      case A_NOT:
+      case A_BITNOT:
+      case A_BOOL: unary(in.op, *sp, sp); break;
+      case A_JFALSE:
+        if (*sp) sp--;
+        else pc = in.arg;
+        break;
+      case A_JTRUE:
+        if (!*sp) {
+          sp--;
+        } else {
+          *sp = 1;
+          pc  = in.arg;
+        }
+        break;
+      case A_JZ:
+        if (!*sp--) pc = in.arg;
+        break;
+      case A_JMP: pc = in.arg; break;
+      default:
+        sp--;
+        if (!apply(in.op, sp[0], sp[1], sp)) error = "division by zero";
+        break;
+    }
+  }
+  if (error) {
+    fprintf(stderr, "tiny: %s: %s\n", program->text, error);
+    return false;
+  }
+  *result = *sp;
+  return true;
+}
+
+// For text that changes between evaluations: compiled into the executor's
+// arena and run once. Reports its own errors.
+bool arith_eval(executor_t *ex, const char *expr, int64_t *result) {
+  const char      *error;
+  arith_program_t *program = arith_compile(ex->arena, expr, &error);
+  if (!program) {
+    fprintf(stderr, "tiny: %s: %s\n", expr, error);
+    return false;
+  }
+  return arith_run(ex, program, result);
+}
+
+// name = value, or name op= value; anything else is a conditional.
+static bool compile_assign(compiler_t *c) {
+  skip_space(c);
+  const char *name = c->p;
+  if (isalpha((unsigned char)*name) || *name == '_') {
+    const char *q = name;
+    while (isalnum((unsigned char)*q) || *q == '_') q++;
+    size_t n = q - name;
+    while (isspace((unsigned char)*q)) q++;
+
+    uint8_t op     = A_PUSH; // none
+    size_t  length = 0;
+    if (q[0] == '=' && q[1] != '=') {
+      length = 1;
+    } else {
+      int i = match_binary(q);
+      if (i >= 0) {
+        size_t text     = strlen(BINARY[i].text);
+        op              = BINARY[i].op;
+        bool   compound = q[text] == '=' && op != A_OR && op != A_AND &&
+                        !(op >= A_EQ && op <= A_GE);
+        if (compound) length = text + 1;
+      }
+    }
+
+    if (length) {
+      uint32_t var;
+      if (!intern(c, name, n, &var)) return false;
+      c->p = q + length;
+      if (length > 1 && !emit(c, A_LOAD, var)) return false;
+      if (!compile_assign(c)) return false;
+      if (length > 1 && !emit_binary(c, op)) return false;
+      return emit(c, A_STORE, var);
+    }
+  }
+  return compile_ternary(c);
+}
+
+static bool compile_ternary(compiler_t *c) {
+  if (!compile_binary(c, 1)) return false;
+  skip_space(c);
+  if (*c->p != '?') return true;
+  c->p++;
+
+  int64_t cond;
+  bool    known = take_const(c, &cond);
+  size_t  jz    = c->code.length;
+  if (!known && !emit(c, A_JZ, 0)) return false;
+  uint32_t depth = c->depth;
+
+  mark_t m = mark(c);
+  if (!compile_assign(c)) return false;
+  if (known && !cond) restore(c, m);
+
+  skip_space(c);
+  if (*c->p != ':') return fail(c, "expecting ':'");
+  c->p++;
+
+  size_t jmp = c->code.length;
+  if (!known) {
+    if (!emit(c, A_JMP, 0)) return false;
+    place(c, jz);
+    c->depth = depth;
+  }
+  m = mark(c);
+  if (!compile_ternary(c)) return false;
+  if (known && cond) restore(c, m);
+  if (!known) place(c, jmp);
+  return true;
+}
+
+// Precedence climbing over the BINARY table.
+static bool compile_binary(compiler_t *c, int min_prec) {
+  if (!compile_unary(c)) return false;
+  for (;;) {
+    skip_space(c);
+    int i = match_binary(c->p);
+    if (i < 0 || BINARY[i].prec < min_prec) return true;
+    c->p += strlen(BINARY[i].text);
+
+    uint8_t op   = BINARY[i].op;
+    int     prec = BINARY[i].prec;
+    bool    ok   = op == A_AND || op == A_OR
+                       ? compile_logic(c, op, prec)
+                       : compile_binary(c, prec + 1) && emit_binary(c, op);
+    if (!ok) return false;
+  }
+}
+
+// The right side of && or || runs only when the left one does not settle
+// the result. A constant left side settles it, or leaves it to the right,
+// at compile time.
+static bool compile_logic(compiler_t *c, uint8_t op, int prec) {
+  int64_t left;
+  if (take_const(c, &left)) {
+    bool settled = op == A_AND ? !left : left != 0;
+    if (!settled) {
+      return compile_binary(c, prec + 1) && emit_unary(c, A_BOOL);
+    }
+    mark_t m = mark(c);
+    if (!compile_binary(c, prec + 1)) return false; // still checked
+    restore(c, m);
+    return push_const(c, op == A_OR);
+  }
+
+  size_t jump = c->code.length;
+  if (!emit(c, op == A_AND ? A_JFALSE : A_JTRUE, 0) ||
+      !compile_binary(c, prec + 1) || !emit_unary(c, A_BOOL)) {
+    return false;
+  }
+  place(c, jump);
+  return true;
+}
+
+static bool compile_unary(compiler_t *c) {
+  skip_space(c);
+  char ch = *c->p;
+
+  if (ch == '+' || ch == '-' || ch == '!' || ch == '~') {
+    c->p++;
+    if (!compile_unary(c)) return false;
+    if (ch == '+') return true;
+    return emit_unary(c, ch == '-' ? A_NEG : ch == '!' ? A_NOT : A_BITNOT);
+  }
+
+  if (ch == '(') {
+    c->p++;
+    if (!compile_assign(c)) return false;
+    skip_space(c);
+    if (*c->p != ')') return fail(c, "expecting ')'");
+    c->p++;
+    return true;
+  }
+
+  if (isdigit((unsigned char)ch)) {
+    char   *end;
+    int64_t value = strtoll(c->p, &end, 0);
+    if (isalnum((unsigned char)*end) || *end == '_') {
+      return fail(c, "bad number");
+    }
+    c->p = end;
+    return push_const(c, value);
+  }
+
+  if (isalpha((unsigned char)ch) || ch == '_') {
+    const char *name = c->p;
+    while (isalnum((unsigned char)*c->p) || *c->p == '_') c->p++;
+    uint32_t var;
+    return intern(c, name, c->p - name, &var) && emit(c, A_LOAD, var);
+  }
+
+  return fail(c, ch ? "syntax error" : "missing operand");
+}
+
+static int match_binary(const char *p) {
+  for (size_t i = 0; i < BINARY_COUNT; i++) {
+    size_t n = strlen(BINARY[i].text);
+    if (strncmp(p, BINARY[i].text, n) == 0) return (int)i;
+  }
+  return -1;
+}
+
+// Appends an instruction, keeping track of how deep the stack gets.
+static bool emit(compiler_t *c, uint8_t op, uint32_t arg) {
+  if (!VECTOR_PUSH(&c->code, insn_t, ((insn_t){op, arg}))) {
+    return fail(c, "out of memory");
+  }
+  switch ((arith_op_t)op) {
+    case A_PUSH:
+    case A_LOAD: c->depth++; break;
+    case A_STORE:
+    case A_NEG:
+    case A_NOT:
+    case A_BITNOT:
+    case A_BOOL:
+    case A_JMP: break;
+    default: c->depth--; break; // binary operators and conditional jumps
+  }
+  if (c->depth > c->max) c->max = c->depth;
+  return true;
+}
+
+static bool emit_unary(compiler_t *c, uint8_t op) {
+  int64_t v;
+  if (take_const(c, &v)) {
+    unary(op, v, &v);
+    return push_const(c, v);
+  }
+  return emit(c, op, 0);
+}
+
+// Folds two constant operands unless that would divide by zero, which is
+// left to fail when, and if, the code runs.
+static bool emit_binary(compiler_t *c, uint8_t op) {
+  size_t  n = c->code.length;
+  int64_t l, r, v;
+  if (n >= 2 && const_at(c, n - 2, &l) && const_at(c, n - 1, &r) &&
+      apply(op, l, r, &v)) {
+    take_const(c, &r);
+    take_const(c, &l);
+    return push_const(c, v);
+  }
+  return emit(c, op, 0);
+}
+
+static bool push_const(compiler_t *c, int64_t value) {
+  uint32_t index = (uint32_t)c->consts.length;
+  if (!VECTOR_PUSH(&c->consts, int64_t, value)) {
+    return fail(c, "out of memory");
+  }
+  return emit(c, A_PUSH, index);
+}
+
+// Removes the constant the code so far ends with, if it does.
+static bool take_const(compiler_t *c, int64_t *value) {
+  if (c->code.length == 0 || !const_at(c, c->code.length - 1, value)) {
+    return false;
+  }
+  c->code.length--;
+  c->depth--;
+  return true;
+}
+
+static bool const_at(compiler_t *c, size_t index, int64_t *value) {
+  insn_t in = VECTOR_AT(&c->code, insn_t, index);
+  if (index < c->floor || in.op != A_PUSH) return false;
+  *value = VECTOR_AT(&c->consts, int64_t, in.arg);
+  return true;
+}
+
+static bool intern(compiler_t *c, const char *name, size_t n,
+                   uint32_t *index) {
+  for (size_t i = 0; i < c->names.length; i++) {
+    const char *known = VECTOR_AT(&c->names, const char *, i);
+    if (strncmp(known, name, n) == 0 && !known[n]) {
+      *index = (uint32_t)i;
+      return true;
+    }
+  }
+  char *copy = arena_strndup(c->arena, name, n);
+  *index     = (uint32_t)c->names.length;
+  if (!copy || !VECTOR_PUSH(&c->names, const char *, copy)) {
+    return fail(c, "out of memory");
+  }
+  return true;
+}
+
+// Points the jump at `jump` to the next instruction, which from now on is
+// a jump target that no constant folding may reach behind.
+static void place(compiler_t *c, size_t jump) {
+  VECTOR_AT(&c->code, insn_t, jump).arg = (uint32_t)c->code.length;
+  c->floor = (uint32_t)c->code.length;
+}
+
+static mark_t mark(const compiler_t *c) {
+  return (mark_t){c->code.length, c->floor, c->depth};
+}
+
+static void restore(compiler_t *c, mark_t m) {
+  c->code.length = m.count;
+  c->floor       = m.floor;
+  c->depth       = m.depth;
+}
+
+static bool unary(uint8_t op, int64_t v, int64_t *out) {
+  switch (op) {
+    case A_NEG: *out = wrap_neg(v); break;
+    case A_NOT: *out = !v; break;
+    case A_BITNOT: *out = ~v; break;
+    default: *out = v != 0; break; // A_BOOL
+  }
+  return true;
+}
+
+// Wrapping arithmetic, as the shells do, without signed overflow. False
+// only for division by zero.
+static bool apply(uint8_t op, int64_t l, int64_t r, int64_t *out) {
+  uint64_t ul = (uint64_t)l, ur = (uint64_t)r;
+  switch ((arith_op_t)op) {
+    case A_OR: *out = l || r; break;
+    case A_AND: *out = l && r; break;
+    case A_BITOR: *out = l | r; break;
+    case A_XOR: *out = l ^ r; break;
+    case A_BITAND: *out = l & r; break;
+    case A_EQ: *out = l == r; break;
+    case A_NE: *out = l != r; break;
+    case A_LT: *out = l < r; break;
+    case A_LE: *out = l <= r; break;
+    case A_GT: *out = l > r; break;
+    case A_GE: *out = l >= r; break;
+    case A_SHL: *out = (int64_t)(ul << (r & 63)); break;
+    case A_SHR: *out = l >> (r & 63); break;
+    case A_ADD: *out = (int64_t)(ul + ur); break;
+    case A_SUB: *out = (int64_t)(ul - ur); break;
+    case A_MUL: *out = (int64_t)(ul * ur); break;
+    case A_DIV:
+    case A_MOD:
+      if (r == 0) return false;
+      if (l == INT64_MIN && r == -1) {
+        *out = op == A_DIV ? INT64_MIN : 0;
+      } else {
+        *out = op == A_DIV ? l / r : l % r;
+      }
+      break;
+    default: return false;
+  }
+  return true;
+}
+
+// Values are nearly always plain decimal, read here without strtoll; any
+// other form (sign, 0x, octal, spaces) takes the general path.
+static bool load(executor_t *ex, const char *name, int64_t *v) {
+  const char *value = exec_getvar(ex, name);
+  *v                = 0;
+  if (!value || !*value) return true;
+
+  uint64_t    u = 0;
+  const char *p = value;
+  while (*p >= '0' && *p <= '9' && p - value < 18) u = u * 10 + (*p++ - '0');
+  if (!*p && (value[0] != '0' || !value[1])) {
+    *v = (int64_t)u;
+    return true;
+  }
+
+  char *end;
+  errno = 0;
+  *v    = strtoll(value, &end, 0);
+  while (isspace((unsigned char)*end)) end++;
+  return !*end && end != value;
+}
+
+static bool store(executor_t *ex, const char *name, int64_t v) {
+  char     text[24];
+  char    *p = text + sizeof text;
+  uint64_t u = v < 0 ? (uint64_t)wrap_neg(v) : (uint64_t)v;
+  *--p       = '\0';
+  do {
+    *--p = (char)('0' + u % 10);
+  } while (u /= 10);
+  if (v < 0) *--p = '-';
+  return exec_setvar(ex, name, p) == 0; // it reports a readonly name
+}
+
+static bool fail(compiler_t *c, const char *message) {
+  c->error = message;
+  return false;
+}
+
+static void skip_space(compiler_t *c) {
+  while (isspace((unsigned char)*c->p)) c->p++;
+}
+
+static int64_t wrap_neg(int64_t v) { return (int64_t)(0 - (uint64_t)v); }
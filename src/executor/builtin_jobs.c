@@ -0,0 +1,271 @@
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "executor/builtins.h"
+#include "executor/jobs.h"
+
+static job_t *find_job(executor_t *ex, const char *name, const char *spec);
+static int    signal_number(const char *name);
+static int    continue_job(executor_t *ex, job_t *job);
+
+// jobs [-l|-p] [job...]. -l adds each job's pid, the time it started and
+// how long it has run (or ran, once done).
+int builtin_jobs(executor_t *ex, int argc, char **argv) {
+  bool pids = false, only_pids = false;
+  int  i    = 1;
+  for (; i < argc && argv[i][0] == '-' && argv[i][1]; i++) {
+    if (strcmp(argv[i], "-l") == 0) pids = true;
+    else if (strcmp(argv[i], "-p") == 0) only_pids = true;
+    else {
+      fprintf(stderr, "tiny: jobs: %s: bad option\n", argv[i]);
+      return 2;
+    }
+  }
+
+  jobs_poll(&ex->jobs, 0);
+  int status = 0;
+  for (int j = 0; j < ex->jobs.top; j++) {
+    job_t *job = &ex->jobs.slots[j];
+    if (!job->id) continue;
+    if (i < argc) {
+      // Only the jobs named on the command line.
+      bool named = false;
+      for (int k = i; k < argc && !named; k++) {
+        named = jobs_find(&ex->jobs, argv[k]) == job;
+      }
+      if (!named) continue;
+    }
+    if (only_pids) printf("%d\n", (int)job->pid);
+    else jobs_print(&ex->jobs, job, stdout, pids);
+  }
+  for (int k = i; k < argc; k++) {
+    if (!find_job(ex, "jobs", argv[k])) status = 1;
+  }
+
+  // Done jobs are reported once, then forgotten.
+  for (int j = 0; j < ex->jobs.top; j++) {
+    job_t *job = &ex->jobs.slots[j];
+    if (job->id && job->state == JOB_DONE) jobs_remove(&ex->jobs, job);
+  }
+  return status;
+}
+
+// wait [-n] [job...]. With no operands waits for every job and returns 0;
+// -n returns the status of whichever job finishes first, or 127 when there
+// is none. A pid whose job the shell has already retired still gets its
+// status. Stopped jobs would never finish: they are left alone, and a
+// stopped job named as an operand gives 128 + SIGTSTP, as `fg` does.
+int builtin_wait(executor_t *ex, int argc, char **argv) {
+  int status = 0;
+  if (argc > 1 && strcmp(argv[1], "-n") == 0) {
+    if (jobs_take_status(&ex->jobs, 0, &status)) return status;
+    job_t *job = jobs_wait_any(&ex->jobs);
+    if (!job) return 127;
+    status = job->status;
+    jobs_remove(&ex->jobs, job);
+    return status;
+  }
+
+  if (argc == 1) {
+    while (ex->jobs.running > ex->jobs.stopped) jobs_poll(&ex->jobs, -1);
+    for (int j = 0; j < ex->jobs.top; j++) {
+      job_t *job = &ex->jobs.slots[j];
+      if (job->id && job->state == JOB_DONE) jobs_remove(&ex->jobs, job);
+    }
+    ex->jobs.retired_count = 0;
+    return 0;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    job_t *job = jobs_find(&ex->jobs, argv[i]);
+    if (!job) {
+      char *end;
+      long  pid = strtol(argv[i], &end, 10);
+      if (!isdigit((unsigned char)argv[i][0]) || *end || pid <= 0 ||
+          !jobs_take_status(&ex->jobs, (pid_t)pid, &status)) {
+        status = 127;
+      }
+      continue;
+    }
+    while (job->state == JOB_RUNNING) jobs_poll(&ex->jobs, -1);
+    if (job->state == JOB_STOPPED) {
+      status = 128 + SIGTSTP;
+      continue;
+    }
+    status = job->status;
+    jobs_remove(&ex->jobs, job);
+  }
+  return status;
+}
+
+// fg [job]: hands the terminal to the job, resumes it and waits until it
+// exits or stops again.
+int builtin_fg(executor_t *ex, int argc, char **argv) {
+  job_t *job = find_job(ex, "fg", argc > 1 ? argv[1] : "%%");
+  if (!job) return 1;
+  if (job->state == JOB_DONE) {
+    int status = job->status;
+    jobs_remove(&ex->jobs, job);
+    return status;
+  }
+
+  printf("%s\n", job->command);
+  fflush(stdout);
+
+  // tcsetpgrp from what is about to be a background group raises SIGTTOU.
+  sigset_t ttou, saved;
+  sigemptyset(&ttou);
+  sigaddset(&ttou, SIGTTOU);
+  sigprocmask(SIG_BLOCK, &ttou, &saved);
+
+  bool terminal = ex->job_control && isatty(0);
+  if (terminal) tcsetpgrp(0, job->pid);
+  int status = continue_job(ex, job);
+
+  while (status == 0) {
+    int   wstatus;
+    pid_t r = waitpid(job->pid, &wstatus, WUNTRACED);
+    if (r < 0 && errno == EINTR) continue;
+    if (r == job->pid) jobs_update(&ex->jobs, job, wstatus);
+    else jobs_wait(&ex->jobs, job); // reaped by the event loop meanwhile
+    break;
+  }
+
+  if (terminal) tcsetpgrp(0, getpgrp());
+  sigprocmask(SIG_SETMASK, &saved, NULL);
+  if (status) return status;
+
+  if (job->state == JOB_STOPPED) {
+    fputc('\n', stderr);
+    jobs_print(&ex->jobs, job, stderr, false);
+    return 128 + SIGTSTP;
+  }
+  status = job->status;
+  jobs_remove(&ex->jobs, job);
+  return status;
+}
+
+// bg [job...]: resumes stopped jobs in the background.
+int builtin_bg(executor_t *ex, int argc, char **argv) {
+  char  *current[] = {"%%"};
+  char **specs     = argc > 1 ? argv + 1 : current;
+  int    count     = argc > 1 ? argc - 1 : 1;
+
+  int status = 0;
+  for (int i = 0; i < count; i++) {
+    job_t *job = find_job(ex, "bg", specs[i]);
+    if (!job || continue_job(ex, job) != 0) {
+      status = 1;
+      continue;
+    }
+    jobs_continued(&ex->jobs, job);
+    printf("[%d] %s &\n", job->id, job->command);
+  }
+  return status;
+}
+
+// kill [-s sig | -sig | -n num] target... and kill -l. A %job target signals
+// the job's whole process group when it has one.
+int builtin_kill(executor_t *ex, int argc, char **argv) {
+  int sig = SIGTERM;
+  int i   = 1;
+
+  if (i < argc && strcmp(argv[i], "-l") == 0) {
+    for (int s = 1; s < NSIG; s++) {
+      const char *name = sigabbrev_np(s);
+      if (name) printf("%s%c", name, s % 8 == 0 ? '\n' : ' ');
+    }
+    putchar('\n');
+    return 0;
+  }
+
+  if (i < argc && argv[i][0] == '-' && argv[i][1]) {
+    const char *name = argv[i] + 1;
+    if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "-n") == 0) &&
+        i + 1 < argc) {
+      name = argv[++i];
+    }
+    if (strcmp(name, "-") != 0) {
+      sig = signal_number(name);
+      if (sig < 0) {
+        fprintf(stderr, "tiny: kill: %s: bad signal\n", name);
+        return 2;
+      }
+      i++;
+    }
+  }
+  if (i < argc && strcmp(argv[i], "--") == 0) i++;
+  if (i == argc) {
+    fprintf(stderr, "tiny: kill: usage: kill [-s sig] pid|%%job...\n");
+    return 2;
+  }
+
+  int status = 0;
+  for (; i < argc; i++) {
+    pid_t target;
+    if (argv[i][0] == '%') {
+      job_t *job = find_job(ex, "kill", argv[i]);
+      if (!job) {
+        status = 1;
+        continue;
+      }
+      target = ex->job_control ? -job->pid : job->pid;
+    } else {
+      char *end;
+      long  pid = strtol(argv[i], &end, 10);
+      if (!*argv[i] || *end) {
+        fprintf(stderr, "tiny: kill: %s: bad pid\n", argv[i]);
+        status = 1;
+        continue;
+      }
+      target = (pid_t)pid;
+    }
+    if (kill(target, sig) != 0) {
+      fprintf(stderr, "tiny: kill: %s: %s\n", argv[i], strerror(errno));
+      status = 1;
+    }
+  }
+  return status;
+}
+
+static job_t *find_job(executor_t *ex, const char *name, const char *spec) {
+  jobs_poll(&ex->jobs, 0);
+  job_t *job = jobs_find(&ex->jobs, spec);
+  if (!job) fprintf(stderr, "tiny: %s: %s: no such job\n", name, spec);
+  return job;
+}
+
+// A number, or a name with or without the SIG prefix, in any case.
+static int signal_number(const char *name) {
+  if (*name >= '0' && *name <= '9') {
+    char *end;
+    long  n = strtol(name, &end, 10);
+    return *end || n >= NSIG ? -1 : (int)n;
+  }
+  if (strncasecmp(name, "SIG", 3) == 0) name += 3;
+  for (int s = 1; s < NSIG; s++) {
+    const char *abbrev = sigabbrev_np(s);
+    if (abbrev && strcasecmp(abbrev, name) == 0) return s;
+  }
+  return -1;
+}
+
+static int continue_job(executor_t *ex, job_t *job) {
+  if (job->state == JOB_DONE) return 0;
+  pid_t target = ex->job_control ? -job->pid : job->pid;
+  if (kill(target, SIGCONT) != 0) {
+    fprintf(stderr, "tiny: %%%d: %s\n", job->id, strerror(errno));
+    return 1;
+  }
+  return 0;
+}
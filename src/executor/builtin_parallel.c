@@ -0,0 +1,266 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "executor/builtins.h"
+#include "executor/jobs.h"
+#include "executor/pathcache.h"
+
+#define MAX_FAILED 101 // exit status cap, as GNU parallel has it
+
+typedef struct {
+  int      id; // in the shell's job table
+  unsigned seq;
+} worker_t;
+
+// A bounded pool of workers. Each worker is an ordinary job in the shell's
+// table, so exits arrive through the same epoll set as `&` jobs; `active`
+// holds this run's workers still being waited for.
+typedef struct {
+  executor_t *ex;
+  char      **command; // template; a "{}" word is replaced by the item
+  int         words;
+  worker_t   *active;
+  size_t      running;
+  size_t      capacity;
+  size_t      limit;
+  FILE       *log;      // --joblog, or NULL
+  uint64_t    epoch_ns; // CLOCK_REALTIME minus CLOCK_MONOTONIC
+  unsigned    seq;
+  unsigned    failed;
+} pool_t;
+
+static size_t cpu_count(void);
+static void   run_item(pool_t *pool, const char *item);
+static bool   grow(pool_t *pool);
+static pid_t  spawn_worker(pool_t *pool, char **argv);
+static char  *join_words(char **argv);
+static void   collect(pool_t *pool, bool block);
+static void   log_job(pool_t *pool, const job_t *job, unsigned seq);
+
+// parallel [-j N] [--joblog file] command [arg...] [::: item...]
+//
+// Runs `command arg... item` once per item, at most N at a time (default: one
+// per CPU this shell may run on; 0 means no limit). Items come after `:::`,
+// or else one per line from stdin, which is read only as slots free up. A
+// `{}` word takes the item instead of appending it. Returns the number of
+// jobs that failed, capped at 101.
+int builtin_parallel(executor_t *ex, int argc, char **argv) {
+  pool_t      pool    = {.ex = ex, .limit = cpu_count()};
+  const char *logfile = NULL;
+
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; i++) {
+    const char *value = NULL;
+    if (strncmp(argv[i], "-j", 2) == 0) {
+      value = argv[i][2] ? argv[i] + 2 : i + 1 < argc ? argv[++i] : NULL;
+      char *end;
+      long  n = value ? strtol(value, &end, 10) : -1;
+      if (!value || !*value || *end || n < 0) {
+        fprintf(stderr, "tiny: parallel: -j: bad job count\n");
+        return 2;
+      }
+      pool.limit = n ? (size_t)n : SIZE_MAX;
+    } else if (strcmp(argv[i], "--joblog") == 0 && i + 1 < argc) {
+      logfile = argv[++i];
+    } else if (strcmp(argv[i], "--") == 0) {
+      i++;
+      break;
+    } else {
+      fprintf(stderr, "tiny: parallel: %s: bad option\n", argv[i]);
+      return 2;
+    }
+  }
+
+  pool.command = argv + i;
+  while (i < argc && strcmp(argv[i], ":::") != 0) i++;
+  pool.words = (int)(argv + i - pool.command);
+  if (pool.words == 0) {
+    fprintf(stderr, "tiny: parallel: usage: parallel [-j N] [--joblog file] "
+                    "command [arg...] [::: item...]\n");
+    return 2;
+  }
+
+  if (logfile) {
+    pool.log = fopen(logfile, "w");
+    if (!pool.log) {
+      fprintf(stderr, "tiny: parallel: %s: %s\n", logfile, strerror(errno));
+      return 1;
+    }
+    fprintf(pool.log, "Seq\tStarttime\tJobRuntime\tExitval\tSignal\tCommand\n");
+
+    struct timespec real, mono;
+    clock_gettime(CLOCK_REALTIME, &real);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    pool.epoch_ns = (uint64_t)(real.tv_sec - mono.tv_sec) * 1000000000u +
+                    (real.tv_nsec - mono.tv_nsec);
+  }
+
+  fflush(NULL);
+  if (i < argc) {
+    for (i++; i < argc; i++) run_item(&pool, argv[i]);
+  } else {
+    // Reading stdin lazily keeps a producer upstream blocked while the pool
+    // is full, rather than buffering its whole output here.
+    char   *line = NULL;
+    size_t  cap  = 0;
+    ssize_t n;
+    while ((n = getline(&line, &cap, stdin)) >= 0) {
+      if (n > 0 && line[n - 1] == '\n') line[--n] = '\0';
+      if (n > 0) run_item(&pool, line);
+    }
+    free(line);
+    clearerr(stdin);
+  }
+  while (pool.running) collect(&pool, true);
+
+  free(pool.active);
+  if (pool.log) fclose(pool.log);
+  return pool.failed > MAX_FAILED ? MAX_FAILED : (int)pool.failed;
+}
+
+// CPUs in this process's affinity mask, which is what a container or
+// `taskset` actually grants, falling back to the online count.
+static size_t cpu_count(void) {
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof set, &set) == 0 && CPU_COUNT(&set) > 0) {
+    return (size_t)CPU_COUNT(&set);
+  }
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (size_t)n : 1;
+}
+
+static void run_item(pool_t *pool, const char *item) {
+  while (pool->running >= pool->limit) collect(pool, true);
+  collect(pool, false);
+
+  // command words, the item if no "{}" took it, and the terminator.
+  char **argv = malloc((pool->words + 2) * sizeof(char *));
+  if (!argv) {
+    fprintf(stderr, "tiny: parallel: out of memory\n");
+    pool->failed++;
+    return;
+  }
+  bool placed = false;
+  int  argc   = 0;
+  for (int w = 0; w < pool->words; w++) {
+    bool slot    = strcmp(pool->command[w], "{}") == 0;
+    placed      |= slot;
+    argv[argc++] = slot ? (char *)item : pool->command[w];
+  }
+  if (!placed) argv[argc++] = (char *)item;
+  argv[argc] = NULL;
+
+  pool->seq++;
+  pid_t pid = spawn_worker(pool, argv);
+  if (pid < 0) {
+    pool->failed++;
+    free(argv);
+    return;
+  }
+
+  job_t *job = NULL;
+  if (pool->running < pool->capacity || grow(pool)) {
+    job = jobs_add(&pool->ex->jobs, pid, join_words(argv));
+  }
+  free(argv);
+  if (!job) {
+    // No event set to watch it with; wait for it on the spot.
+    int wstatus;
+    while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR) {
+    }
+    if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus)) pool->failed++;
+    return;
+  }
+  pool->active[pool->running++] = (worker_t){job->id, pool->seq};
+}
+
+static bool grow(pool_t *pool) {
+  size_t    capacity = pool->capacity ? pool->capacity * 2 : 16;
+  worker_t *active   = realloc(pool->active, capacity * sizeof(worker_t));
+  if (!active) return false;
+  pool->active   = active;
+  pool->capacity = capacity;
+  return true;
+}
+
+static pid_t spawn_worker(pool_t *pool, char **argv) {
+  executor_t *ex   = pool->ex;
+  const char *path = pathcache_lookup(&ex->paths, argv[0],
+                                      exec_getvar(ex, "PATH"));
+  if (!path) {
+    fprintf(stderr, "tiny: parallel: %s: not found\n", argv[0]);
+    return -1;
+  }
+
+  // The shell may hold SIGCHLD blocked for the job reaper.
+  posix_spawnattr_t attr;
+  sigset_t          none;
+  sigemptyset(&none);
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setsigmask(&attr, &none);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+  char **envp = vars_environ(&ex->vars);
+  pid_t  pid;
+  int    err = envp ? posix_spawn(&pid, path, NULL, &attr, argv, envp) : ENOMEM;
+  posix_spawnattr_destroy(&attr);
+  if (err) {
+    fprintf(stderr, "tiny: parallel: %s: %s\n", argv[0], strerror(err));
+    return -1;
+  }
+  return pid;
+}
+
+static char *join_words(char **argv) {
+  size_t length = 0;
+  for (char **w = argv; *w; w++) length += strlen(*w) + 1;
+
+  char *text = malloc(length ? length : 1);
+  if (!text) return NULL;
+  char *p = text;
+  for (char **w = argv; *w; w++) {
+    if (p != text) *p++ = ' ';
+    size_t n = strlen(*w);
+    memcpy(p, *w, n);
+    p += n;
+  }
+  *p = '\0';
+  return text;
+}
+
+// Takes every worker that has finished, first waiting for one if `block`.
+static void collect(pool_t *pool, bool block) {
+  if (pool->running == 0) return;
+  jobs_poll(&pool->ex->jobs, block ? -1 : 0);
+
+  for (size_t i = 0; i < pool->running;) {
+    job_t *job = &pool->ex->jobs.slots[pool->active[i].id - 1];
+    if (job->state != JOB_DONE) {
+      i++;
+      continue;
+    }
+    if (job->status) pool->failed++;
+    if (pool->log) log_job(pool, job, pool->active[i].seq);
+    jobs_remove(&pool->ex->jobs, job);
+    pool->active[i] = pool->active[--pool->running];
+  }
+}
+
+static void log_job(pool_t *pool, const job_t *job, unsigned seq) {
+  int signal = job->status > 128 ? job->status - 128 : 0;
+  fprintf(pool->log, "%u\t%.3f\t%.3f\t%d\t%d\t%s\n", seq,
+          (pool->epoch_ns + job->started_ns) / 1e9, job->elapsed_ns / 1e9,
+          signal ? 0 : job->status, signal,
+          job->command ? job->command : "");
+}
@@ -0,0 +1,200 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "executor/builtins.h"
+
+#define SPEC_MAX 32 // longest conversion spec we rebuild for the C printf
+
+static const char *put_escape(const char *p, bool in_b, bool *stop);
+static long        arg_integer(const char *s, int *status);
+static double      arg_double(const char *s, int *status);
+
+// echo [-n] args: XSI echo, so backslash escapes are always interpreted and
+// `\c` suppresses all further output.
+int builtin_echo(executor_t *ex, int argc, char **argv) {
+  bool newline = true;
+  int  i       = 1;
+  if (i < argc && strcmp(argv[i], "-n") == 0) {
+    newline = false;
+    i++;
+  }
+
+  for (; i < argc; i++) {
+    for (const char *p = argv[i]; *p;) {
+      if (*p != '\\') {
+        putchar(*p++);
+        continue;
+      }
+      bool stop = false;
+      p         = put_escape(p + 1, true, &stop);
+      if (stop) return builtin_flush(ex);
+    }
+    if (i + 1 < argc) putchar(' ');
+  }
+  if (newline) putchar('\n');
+  return builtin_flush(ex);
+}
+
+// printf format [args]: the format is reused until every argument has been
+// consumed; missing arguments read as "" or 0.
+int builtin_printf(executor_t *ex, int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "tiny: printf: usage: printf format [arg...]\n");
+    return 2;
+  }
+
+  const char *format = argv[1];
+  int         next   = 2;
+  int         status = 0;
+
+  do {
+    int first = next;
+    for (const char *p = format; *p;) {
+      if (*p == '\\') {
+        bool stop = false;
+        p         = put_escape(p + 1, false, &stop);
+        continue;
+      }
+      if (*p != '%') {
+        putchar(*p++);
+        continue;
+      }
+      if (p[1] == '%') {
+        putchar('%');
+        p += 2;
+        continue;
+      }
+
+      // Copy flags, width and precision, then the conversion character.
+      char   spec[SPEC_MAX];
+      size_t n     = 0;
+      spec[n++]    = *p++;
+      while (*p && strchr("-+ #0123456789.", *p) && n < SPEC_MAX - 3) {
+        spec[n++] = *p++;
+      }
+      char conv = *p;
+      if (!conv) break;
+      p++;
+
+      const char *arg = next < argc ? argv[next++] : NULL;
+      switch (conv) {
+        case 'b': {
+          if (!arg) break;
+          for (const char *q = arg; *q;) {
+            if (*q != '\\') {
+              putchar(*q++);
+              continue;
+            }
+            bool stop = false;
+            q         = put_escape(q + 1, true, &stop);
+            if (stop) return builtin_flush(ex) ? 1 : status;
+          }
+          break;
+        }
+        case 's':
+          spec[n++] = 's';
+          spec[n]   = '\0';
+          printf(spec, arg ? arg : "");
+          break;
+        case 'c':
+          if (arg && *arg) putchar(*arg);
+          break;
+        case 'd':
+        case 'i':
+          spec[n++] = 'l';
+          spec[n++] = conv;
+          spec[n]   = '\0';
+          printf(spec, arg ? arg_integer(arg, &status) : 0L);
+          break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+          spec[n++] = 'l';
+          spec[n++] = conv;
+          spec[n]   = '\0';
+          printf(spec, (unsigned long)(arg ? arg_integer(arg, &status) : 0L));
+          break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+          spec[n++] = conv;
+          spec[n]   = '\0';
+          printf(spec, arg ? arg_double(arg, &status) : 0.0);
+          break;
+        default:
+          fprintf(stderr, "tiny: printf: %%%c: invalid directive\n", conv);
+          builtin_flush(ex);
+          return 1;
+      }
+    }
+    // A format without conversions must not loop forever on leftover args.
+    if (next == first) break;
+  } while (next < argc);
+
+  return builtin_flush(ex) ? 1 : status;
+}
+
+// Writes the escape following a backslash and returns the position after it.
+// `in_b` selects the echo/%b flavour: octal is \0nnn and \c stops output.
+static const char *put_escape(const char *p, bool in_b, bool *stop) {
+  static const char from[] = "\\abfnrtv";
+  static const char to[]   = "\\\a\b\f\n\r\t\v";
+
+  const char *hit = *p ? strchr(from, *p) : NULL;
+  if (hit) {
+    putchar(to[hit - from]);
+    return p + 1;
+  }
+  if (in_b && *p == 'c') {
+    *stop = true;
+    return p + 1;
+  }
+
+  bool octal = in_b ? *p == '0' : (*p >= '0' && *p <= '7');
+  if (octal) {
+    if (in_b) p++;
+    int value = 0;
+    for (int i = 0; i < 3 && *p >= '0' && *p <= '7'; i++, p++) {
+      value = value * 8 + (*p - '0');
+    }
+    putchar(value);
+    return p;
+  }
+
+  putchar('\\');
+  return p;
+}
+
+// Numeric arguments accept C constants and the 'c / "c character form.
+static long arg_integer(const char *s, int *status) {
+  if (*s == '\'' || *s == '"') return (unsigned char)s[1];
+  char *end;
+  errno  = 0;
+  long v = strtol(s, &end, 0);
+  if (!*s || *end || errno) {
+    fprintf(stderr, "tiny: printf: %s: invalid number\n", s);
+    *status = 1;
+  }
+  return v;
+}
+
+static double arg_double(const char *s, int *status) {
+  if (*s == '\'' || *s == '"') return (unsigned char)s[1];
+  char *end;
+  errno    = 0;
+  double v = strtod(s, &end);
+  if (!*s || *end || errno) {
+    fprintf(stderr, "tiny: printf: %s: invalid number\n", s);
+    *status = 1;
+  }
+  return v;
+}
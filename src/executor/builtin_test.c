@@ -0,0 +1,255 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "executor/builtins.h"
+
+// test / [ per POSIX: up to four arguments are decided by argument count, as
+// the standard requires; longer expressions use the XSI -a/-o/!/() grammar
+// with -a binding tighter than -o.
+typedef struct {
+  char **argv;
+  int    argc;
+  int    pos;
+  bool   error;
+} test_state_t;
+
+static bool test_or(test_state_t *t);
+static bool test_and(test_state_t *t);
+static bool test_primary(test_state_t *t);
+static bool test_nargs(test_state_t *t, int n);
+static bool is_unary(const char *op);
+static bool is_binary(const char *op);
+static bool eval_unary(test_state_t *t, const char *op, const char *arg);
+static bool eval_binary(test_state_t *t, const char *l, const char *op,
+                        const char *r);
+static bool parse_integer(test_state_t *t, const char *s, long *out);
+
+int builtin_test(executor_t *ex, int argc, char **argv) {
+  (void)ex;
+  if (strcmp(argv[0], "[") == 0) {
+    if (strcmp(argv[argc - 1], "]") != 0) {
+      fprintf(stderr, "tiny: [: missing ]\n");
+      return 2;
+    }
+    argc--;
+  }
+
+  test_state_t t = {argv + 1, argc - 1, 0, false};
+  bool         r = t.argc <= 4 ? test_nargs(&t, t.argc) : test_or(&t);
+
+  if (!t.error && t.pos != t.argc) {
+    fprintf(stderr, "tiny: test: %s: unexpected operator\n", t.argv[t.pos]);
+    t.error = true;
+  }
+  if (t.error) return 2;
+  return r ? 0 : 1;
+}
+
+// Evaluates exactly `n` arguments starting at t->pos using the POSIX
+// count-based rules.
+static bool test_nargs(test_state_t *t, int n) {
+  char **a = t->argv + t->pos;
+  switch (n) {
+    case 0: return false;
+    case 1:
+      t->pos++;
+      return a[0][0] != '\0';
+    case 2:
+      if (strcmp(a[0], "!") == 0) {
+        t->pos++;
+        return !test_nargs(t, 1);
+      }
+      if (is_unary(a[0])) {
+        t->pos += 2;
+        return eval_unary(t, a[0], a[1]);
+      }
+      break;
+    case 3:
+      if (is_binary(a[1])) {
+        t->pos += 3;
+        return eval_binary(t, a[0], a[1], a[2]);
+      }
+      if (strcmp(a[1], "-a") == 0 || strcmp(a[1], "-o") == 0) {
+        bool l = a[0][0] != '\0', r = a[2][0] != '\0';
+        t->pos += 3;
+        return a[1][1] == 'a' ? (l && r) : (l || r);
+      }
+      if (strcmp(a[0], "!") == 0) {
+        t->pos++;
+        return !test_nargs(t, 2);
+      }
+      if (strcmp(a[0], "(") == 0 && strcmp(a[2], ")") == 0) {
+        t->pos += 3;
+        return a[1][0] != '\0';
+      }
+      break;
+    case 4:
+      if (strcmp(a[0], "!") == 0) {
+        t->pos++;
+        return !test_nargs(t, 3);
+      }
+      if (strcmp(a[0], "(") == 0 && strcmp(a[3], ")") == 0) {
+        t->pos++;
+        bool r = test_nargs(t, 2);
+        t->pos++;
+        return r;
+      }
+      break;
+  }
+  return test_or(t);
+}
+
+static bool test_or(test_state_t *t) {
+  bool r = test_and(t);
+  while (t->pos < t->argc && strcmp(t->argv[t->pos], "-o") == 0) {
+    t->pos++;
+    bool rhs = test_and(t);
+    r        = r || rhs;
+  }
+  return r;
+}
+
+static bool test_and(test_state_t *t) {
+  bool r = test_primary(t);
+  while (t->pos < t->argc && strcmp(t->argv[t->pos], "-a") == 0) {
+    t->pos++;
+    bool rhs = test_primary(t);
+    r        = r && rhs;
+  }
+  return r;
+}
+
+static bool test_primary(test_state_t *t) {
+  if (t->pos >= t->argc) {
+    fprintf(stderr, "tiny: test: argument expected\n");
+    t->error = true;
+    return false;
+  }
+
+  char **a    = t->argv + t->pos;
+  int    left = t->argc - t->pos;
+
+  if (strcmp(a[0], "!") == 0) {
+    t->pos++;
+    return !test_primary(t);
+  }
+  if (strcmp(a[0], "(") == 0) {
+    t->pos++;
+    bool r = test_or(t);
+    if (t->pos >= t->argc || strcmp(t->argv[t->pos], ")") != 0) {
+      fprintf(stderr, "tiny: test: missing )\n");
+      t->error = true;
+      return false;
+    }
+    t->pos++;
+    return r;
+  }
+  if (left >= 3 && is_binary(a[1])) {
+    t->pos += 3;
+    return eval_binary(t, a[0], a[1], a[2]);
+  }
+  if (left >= 2 && is_unary(a[0])) {
+    t->pos += 2;
+    return eval_unary(t, a[0], a[1]);
+  }
+  t->pos++;
+  return a[0][0] != '\0';
+}
+
+static bool is_unary(const char *op) {
+  return op[0] == '-' && op[1] && !op[2] && strchr("bcdefghLnprSstuwxz", op[1]);
+}
+
+static bool is_binary(const char *op) {
+  static const char *const ops[] = {"=",   "!=",  "-eq", "-ne", "-lt", "-le",
+                                    "-gt", "-ge", "-nt", "-ot", "-ef"};
+  for (size_t i = 0; i < sizeof ops / sizeof *ops; i++) {
+    if (strcmp(op, ops[i]) == 0) return true;
+  }
+  return false;
+}
+
+static bool eval_unary(test_state_t *t, const char *op, const char *arg) {
+  struct stat st;
+
+  switch (op[1]) {
+    case 'n': return arg[0] != '\0';
+    case 'z': return arg[0] == '\0';
+    case 't': {
+      long fd;
+      return parse_integer(t, arg, &fd) && isatty((int)fd);
+    }
+    case 'r': return access(arg, R_OK) == 0;
+    case 'w': return access(arg, W_OK) == 0;
+    case 'x': return access(arg, X_OK) == 0;
+    case 'h':
+    case 'L': return lstat(arg, &st) == 0 && S_ISLNK(st.st_mode);
+  }
+
+  if (stat(arg, &st) != 0) return false;
+  switch (op[1]) {
+    case 'b': return S_ISBLK(st.st_mode);
+    case 'c': return S_ISCHR(st.st_mode);
+    case 'd': return S_ISDIR(st.st_mode);
+    case 'e': return true;
+    case 'f': return S_ISREG(st.st_mode);
+    case 'g': return st.st_mode & S_ISGID;
+    case 'p': return S_ISFIFO(st.st_mode);
+    case 'S': return S_ISSOCK(st.st_mode);
+    case 's': return st.st_size > 0;
+    case 'u': return st.st_mode & S_ISUID;
+  }
+  return false;
+}
+
+static bool eval_binary(test_state_t *t, const char *l, const char *op,
+                        const char *r) {
+  if (op[0] == '=') return strcmp(l, r) == 0;
+  if (op[0] == '!') return strcmp(l, r) != 0;
+
+  if (op[1] == 'n' && op[2] == 't') {
+    struct stat a, b;
+    if (stat(l, &a) != 0) return false;
+    if (stat(r, &b) != 0) return true;
+    return a.st_mtim.tv_sec > b.st_mtim.tv_sec ||
+           (a.st_mtim.tv_sec == b.st_mtim.tv_sec &&
+            a.st_mtim.tv_nsec > b.st_mtim.tv_nsec);
+  }
+  if (op[1] == 'o' && op[2] == 't') return eval_binary(t, r, "-nt", l);
+  if (op[1] == 'e' && op[2] == 'f') {
+    struct stat a, b;
+    return stat(l, &a) == 0 && stat(r, &b) == 0 && a.st_dev == b.st_dev &&
+           a.st_ino == b.st_ino;
+  }
+
+  long x, y;
+  if (!parse_integer(t, l, &x) || !parse_integer(t, r, &y)) return false;
+  switch (op[1]) {
+    case 'e': return x == y;
+    case 'n': return x != y;
+    case 'l': return op[2] == 't' ? x < y : x <= y;
+    case 'g': return op[2] == 't' ? x > y : x >= y;
+  }
+  return false;
+}
+
+static bool parse_integer(test_state_t *t, const char *s, long *out) {
+  char *end;
+  errno = 0;
+  while (*s == ' ' || *s == '\t') s++;
+  *out = strtol(s, &end, 10);
+  while (*end == ' ' || *end == '\t') end++;
+  if (!*s || *end || errno) {
+    fprintf(stderr, "tiny: test: %s: bad number\n", s);
+    t->error = true;
+    return false;
+  }
+  return true;
+}
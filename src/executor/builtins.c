@@ -0,0 +1,488 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "builtin_table.h"
+#include "collections/vector.h"
+#include "executor/builtins.h"
+#include "executor/expand.h"
+#include "executor/pathcache.h"
+
+static const builtin_t BUILTINS[] = {
+#define BUILTIN(name, suffix, flags) {name, builtin_##suffix, flags},
+#include "executor/builtins.def"
+#undef BUILTIN
+};
+
+// `set -o` options, each an unsigned field of the executor.
+typedef struct {
+  const char *name;
+  size_t      offset;
+} shell_option_t;
+
+static const shell_option_t OPTIONS[] = {
+    {"jobs-max", offsetof(executor_t, jobs_max)},
+    {"pipe-size", offsetof(executor_t, pipe_size)},
+};
+
+static bool      is_name(const char *s);
+static unsigned  read_ifs(const executor_t *ex, const vector_t *escaped,
+                          const char *s, size_t k);
+static int       leave_loops(executor_t *ex, int argc, char **argv, bool next);
+static int       declare_vars(executor_t *ex, int argc, char **argv,
+                              const char *name, unsigned flag);
+static int       compare_vars(const void *a, const void *b);
+static unsigned *option_value(executor_t *ex, const shell_option_t *option);
+static char     *logical_path(const char *base, const char *dir);
+
+// Ends a builtin's output. Inside a pipeline stage stdout is fully buffered
+// and left for the stage to flush in large writes; elsewhere the output goes
+// out now. Either way, 1 if writing failed.
+int builtin_flush(executor_t *ex) {
+  if (ex->batch_output) return ferror(stdout) ? 1 : 0;
+  return fflush(stdout) == 0 ? 0 : 1;
+}
+
+// One hash, one table load and one strcmp against the only possible match.
+const builtin_t *builtin_lookup(const char *name) {
+  uint32_t h = builtin_name_hash(BUILTIN_HASH_SEED, name) & BUILTIN_HASH_MASK;
+  int      i = BUILTIN_SLOTS[h];
+  if (i < 0 || strcmp(BUILTINS[i].name, name) != 0) return NULL;
+  return &BUILTINS[i];
+}
+
+int builtin_colon(executor_t *ex, int argc, char **argv) {
+  (void)ex, (void)argc, (void)argv;
+  return 0;
+}
+
+int builtin_true(executor_t *ex, int argc, char **argv) {
+  (void)ex, (void)argc, (void)argv;
+  return 0;
+}
+
+int builtin_false(executor_t *ex, int argc, char **argv) {
+  (void)ex, (void)argc, (void)argv;
+  return 1;
+}
+
+int builtin_exit(executor_t *ex, int argc, char **argv) {
+  int status = ex->status;
+  if (argc > 1) {
+    char *end;
+    long  n = strtol(argv[1], &end, 10);
+    if (!*argv[1] || *end || n < 0) {
+      fprintf(stderr, "tiny: exit: %s: bad number\n", argv[1]);
+      status = 2;
+    } else {
+      status = (int)(n & 0xff);
+    }
+  }
+  ex->exiting = true;
+  return status;
+}
+
+int builtin_break(executor_t *ex, int argc, char **argv) {
+  return leave_loops(ex, argc, argv, false);
+}
+
+int builtin_continue(executor_t *ex, int argc, char **argv) {
+  return leave_loops(ex, argc, argv, true);
+}
+
+// cd [-L|-P] [dir|-]. Paths are resolved logically against $PWD (so `..`
+// undoes a symlink step) unless -P is given or the logical path fails.
+int builtin_cd(executor_t *ex, int argc, char **argv) {
+  bool physical = false;
+  int  i        = 1;
+  for (; i < argc && argv[i][0] == '-' && argv[i][1]; i++) {
+    if (strcmp(argv[i], "--") == 0) {
+      i++;
+      break;
+    }
+    if (strcmp(argv[i], "-P") == 0) physical = true;
+    else if (strcmp(argv[i], "-L") == 0) physical = false;
+    else break;
+  }
+
+  const char *dir   = i < argc ? argv[i] : exec_getvar(ex, "HOME");
+  bool        print = false;
+  if (!dir || !*dir) {
+    fprintf(stderr, "tiny: cd: HOME not set\n");
+    return 1;
+  }
+  if (strcmp(dir, "-") == 0) {
+    dir = exec_getvar(ex, "OLDPWD");
+    if (!dir) {
+      fprintf(stderr, "tiny: cd: OLDPWD not set\n");
+      return 1;
+    }
+    print = true;
+  }
+
+  const char *pwd    = exec_getvar(ex, "PWD");
+  char       *target = NULL;
+  if (!physical && pwd && pwd[0] == '/') target = logical_path(pwd, dir);
+
+  if (!target || chdir(target) != 0) {
+    free(target);
+    target = NULL;
+    if (chdir(dir) != 0) {
+      fprintf(stderr, "tiny: cd: %s: %s\n", dir, strerror(errno));
+      return 1;
+    }
+  }
+
+  int status = pwd ? exec_setvar(ex, "OLDPWD", pwd) : 0;
+  if (!target) target = getcwd(NULL, 0);
+  if (target) status |= exec_setvar(ex, "PWD", target);
+  if (print && target) printf("%s\n", target);
+  free(target);
+  return status;
+}
+
+int builtin_pwd(executor_t *ex, int argc, char **argv) {
+  bool physical = argc > 1 && strcmp(argv[argc - 1], "-P") == 0;
+
+  const char *pwd = exec_getvar(ex, "PWD");
+  struct stat a, b;
+  if (!physical && pwd && pwd[0] == '/' && stat(pwd, &a) == 0 &&
+      stat(".", &b) == 0 && a.st_dev == b.st_dev && a.st_ino == b.st_ino) {
+    printf("%s\n", pwd);
+    return 0;
+  }
+
+  char *cwd = getcwd(NULL, 0);
+  if (!cwd) {
+    fprintf(stderr, "tiny: pwd: %s\n", strerror(errno));
+    return 1;
+  }
+  printf("%s\n", cwd);
+  free(cwd);
+  return 0;
+}
+
+// export [-p] [name[=value]...]
+int builtin_export(executor_t *ex, int argc, char **argv) {
+  return declare_vars(ex, argc, argv, "export", VAR_EXPORT);
+}
+
+// readonly [-p] [name[=value]...]
+int builtin_readonly(executor_t *ex, int argc, char **argv) {
+  return declare_vars(ex, argc, argv, "readonly", VAR_READONLY);
+}
+
+// set -o [option=value] | set +o option. Only numeric shell options so far,
+// where 0 means off; tiny has no positional parameters to set.
+int builtin_set(executor_t *ex, int argc, char **argv) {
+  size_t count = sizeof OPTIONS / sizeof *OPTIONS;
+
+  if (argc == 2 && strcmp(argv[1], "-o") == 0) {
+    for (size_t i = 0; i < count; i++) {
+      printf("%s\t%u\n", OPTIONS[i].name, *option_value(ex, &OPTIONS[i]));
+    }
+    return 0;
+  }
+
+  for (size_t i = 0; argc == 3 && i < count; i++) {
+    size_t length = strlen(OPTIONS[i].name);
+    if (strncmp(argv[2], OPTIONS[i].name, length) != 0) continue;
+
+    const char *value = argv[2] + length;
+    if (strcmp(argv[1], "+o") == 0 && !*value) {
+      *option_value(ex, &OPTIONS[i]) = 0;
+      return 0;
+    }
+    if (strcmp(argv[1], "-o") == 0 && *value == '=' && value[1]) {
+      char         *end;
+      unsigned long n = strtoul(value + 1, &end, 10);
+      if (!*end && n <= UINT_MAX) {
+        *option_value(ex, &OPTIONS[i]) = (unsigned)n;
+        return 0;
+      }
+    }
+  }
+  fprintf(stderr, "tiny: set: %s: unsupported\n",
+          argc > 1 ? argv[argc - 1] : "");
+  return 2;
+}
+
+static unsigned *option_value(executor_t *ex, const shell_option_t *option) {
+  return (unsigned *)((char *)ex + option->offset);
+}
+
+// unset [-v] name...; functions do not exist, so -f unsets nothing.
+int builtin_unset(executor_t *ex, int argc, char **argv) {
+  int i = 1;
+  if (i < argc && strcmp(argv[i], "-f") == 0) return 0;
+  if (i < argc && strcmp(argv[i], "-v") == 0) i++;
+
+  int status = 0;
+  for (; i < argc; i++) {
+    if (!is_name(argv[i])) {
+      fprintf(stderr, "tiny: unset: %s: bad variable name\n", argv[i]);
+      status = 1;
+      continue;
+    }
+    status |= exec_unsetvar(ex, argv[i]);
+  }
+  return status;
+}
+
+// read [-r] name...: one line from stdin, split on $IFS; the last name takes
+// the rest of the line. lineread_next leaves the fd offset exactly after the
+// consumed line for whatever runs next, without reading a byte at a time.
+int builtin_read(executor_t *ex, int argc, char **argv) {
+  bool raw = false;
+  int  i   = 1;
+  if (i < argc && strcmp(argv[i], "-r") == 0) {
+    raw = true;
+    i++;
+  }
+  if (i == argc) {
+    fprintf(stderr, "tiny: read: missing variable name\n");
+    return 2;
+  }
+
+  vector_t line, text, escaped;
+  vector_init(&line, 1, ex->arena);
+  vector_init(&text, 1, ex->arena);
+  vector_init(&escaped, 1, ex->arena);
+  bool eof  = false;
+  bool more = true;
+
+  while (more) {
+    text.length = 0;
+    eof         = lineread_next(&ex->input, 0, &text) <= 0;
+    more        = false;
+
+    const char *s = vector_data(&text);
+    for (size_t k = 0; k < text.length; k++) {
+      char c = s[k];
+      if (!raw && c == '\\') {
+        if (++k == text.length) {
+          more = !eof; // line continuation; dropped at the end of input
+          break;
+        }
+        // Escaped bytes are kept but protected from splitting: one bit each
+        // in `escaped`, which only grows as far as the last escape.
+        size_t at = line.length;
+        while (escaped.length <= at / 8) {
+          if (!VECTOR_PUSH(&escaped, uint8_t, 0)) return 2;
+        }
+        VECTOR_AT(&escaped, uint8_t, at / 8) |= 1u << at % 8;
+        c = s[k];
+      }
+      if (!VECTOR_PUSH(&line, char, c)) return 2;
+    }
+  }
+  size_t n = line.length;
+  if (!VECTOR_PUSH(&line, char, '\0')) return 2;
+
+  char  *s = vector_data(&line);
+  size_t k = 0;
+  for (; i < argc; i++) {
+    while (k < n && read_ifs(ex, &escaped, s, k) & IFS_SPACE) k++;
+
+    size_t start = k;
+    if (i + 1 < argc) {
+      while (k < n && !read_ifs(ex, &escaped, s, k)) k++;
+      if (k < n) s[k++] = '\0';
+    } else {
+      // The last variable keeps the remainder minus trailing IFS whitespace.
+      size_t end = n;
+      while (end > start && read_ifs(ex, &escaped, s, end - 1) & IFS_SPACE) {
+        end--;
+      }
+      s[end] = '\0';
+    }
+
+    if (exec_setvar(ex, argv[i], s + start) != 0) return 2;
+  }
+
+  return eof ? 1 : 0;
+}
+
+int builtin_hash(executor_t *ex, int argc, char **argv) {
+  pathcache_t *pc = &ex->paths;
+
+  if (argc == 2 && strcmp(argv[1], "-r") == 0) {
+    pathcache_clear(pc);
+    return 0;
+  }
+
+  if (argc == 2 && strcmp(argv[1], "-s") == 0) {
+    printf("hits    %lu\nmisses  %lu\nprobes  %lu\n", pc->hits, pc->misses,
+           pc->probes);
+    return 0;
+  }
+
+  if (argc == 1) {
+    if (pc->count) printf("hits\tcommand\n");
+    for (size_t i = 0; i < pc->capacity; i++) {
+      if (!pc->slots[i].name) continue;
+      printf("%4u\t%s\n", pc->slots[i].hits, pc->slots[i].path);
+    }
+    return 0;
+  }
+
+  int status = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!pathcache_lookup(pc, argv[i], exec_getvar(ex, "PATH"))) {
+      fprintf(stderr, "tiny: hash: %s: not found\n", argv[i]);
+      status = 1;
+    }
+  }
+  return status;
+}
+
+// export and readonly: give each name `flag`, assigning it first when a value
+// is given. With no names, lists the variables that have the flag, sorted,
+// as commands that would recreate them.
+static int declare_vars(executor_t *ex, int argc, char **argv,
+                        const char *name, unsigned flag) {
+  int i = 1;
+  if (i < argc && strcmp(argv[i], "-p") == 0) i++;
+
+  if (i == argc) {
+    vars_t       *vars   = &ex->vars;
+    size_t        count  = 0;
+    const var_t **listed = arena_alloc(ex->arena, vars->count * sizeof *listed);
+    if (!listed && vars->count) return 1;
+    for (size_t s = 0; s < vars->capacity; s++) {
+      if (vars->slots[s].name && (vars->slots[s].flags & flag)) {
+        listed[count++] = &vars->slots[s];
+      }
+    }
+    qsort(listed, count, sizeof(var_t *), compare_vars);
+
+    for (size_t v = 0; v < count; v++) {
+      const char *value = var_value(listed[v]);
+      printf("%s %s", name, listed[v]->name);
+      if (value) {
+        printf("='");
+        for (const char *p = value; *p; p++) {
+          if (*p == '\'') printf("'\\''");
+          else putchar(*p);
+        }
+        putchar('\'');
+      }
+      putchar('\n');
+    }
+    return builtin_flush(ex);
+  }
+
+  int status = 0;
+  for (; i < argc; i++) {
+    char *eq = strchr(argv[i], '=');
+    if (eq) *eq = '\0';
+    if (!is_name(argv[i])) {
+      fprintf(stderr, "tiny: %s: %s: bad variable name\n", name, argv[i]);
+      status = 1;
+    } else if (eq && exec_setvar(ex, argv[i], eq + 1) != 0) {
+      status = 1;
+    } else if (!vars_set_flags(&ex->vars, argv[i], flag)) {
+      fprintf(stderr, "tiny: %s: out of memory\n", name);
+      status = 1;
+    }
+    if (eq) *eq = '=';
+  }
+  return status;
+}
+
+static int compare_vars(const void *a, const void *b) {
+  return strcmp((*(const var_t *const *)a)->name,
+                (*(const var_t *const *)b)->name);
+}
+
+// break [n] and continue [n]: unwind n enclosing loops, the last of them
+// going on to its next pass for continue. The executor stops running
+// commands while ex->breaking is set and each loop it leaves counts it down.
+// Outside a loop both do nothing, as in other shells. A bad count is an
+// error but still counts as 1, or `while :; do break 0; done` would never end.
+static int leave_loops(executor_t *ex, int argc, char **argv, bool next) {
+  long n      = 1;
+  int  status = 0;
+  if (argc > 1) {
+    char *end;
+    n = strtol(argv[1], &end, 10);
+    if (!*argv[1] || *end || n < 1) {
+      fprintf(stderr, "tiny: %s: %s: bad number\n", argv[0], argv[1]);
+      n      = 1;
+      status = 2;
+    }
+  }
+  if (ex->loops == 0) return status;
+  ex->breaking   = n < ex->loops ? (unsigned)n : ex->loops;
+  ex->continuing = next;
+  return status;
+}
+
+// The IFS_* class of byte `k` of a line `read` has taken in; none if it was
+// escaped.
+static unsigned read_ifs(const executor_t *ex, const vector_t *escaped,
+                         const char *s, size_t k) {
+  const uint8_t *bits = vector_data(escaped);
+  if (k / 8 < escaped->length && bits[k / 8] & 1u << k % 8) return 0;
+  return ex->ifs[(unsigned char)s[k]];
+}
+
+static bool is_name(const char *s) {
+  if (!(*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z'))) {
+    return false;
+  }
+  for (s++; *s; s++) {
+    if (!(*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') ||
+          (*s >= '0' && *s <= '9'))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Joins `dir` onto `base` (unless absolute) and folds `.` and `..` lexically.
+// Returns a malloc'd absolute path.
+static char *logical_path(const char *base, const char *dir) {
+  size_t len  = strlen(base) + strlen(dir) + 2;
+  char  *in   = malloc(len);
+  char  *out  = malloc(len + 1);
+  if (!in || !out) {
+    free(in);
+    free(out);
+    return NULL;
+  }
+  if (dir[0] == '/') snprintf(in, len, "%s", dir);
+  else snprintf(in, len, "%s/%s", base, dir);
+
+  size_t n = 0;
+  for (char *seg = in; *seg;) {
+    while (*seg == '/') seg++;
+    char  *end = strchrnul(seg, '/');
+    size_t sl  = end - seg;
+
+    if (sl == 0 || (sl == 1 && seg[0] == '.')) {
+      // skip
+    } else if (sl == 2 && seg[0] == '.' && seg[1] == '.') {
+      while (n > 0 && out[n - 1] != '/') n--;
+      if (n > 0) n--;
+    } else {
+      out[n++] = '/';
+      memcpy(out + n, seg, sl);
+      n += sl;
+    }
+    seg = end;
+  }
+  if (n == 0) out[n++] = '/';
+  out[n] = '\0';
+
+  free(in);
+  return out;
+}
@@ -0,0 +1,251 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "executor/builtins.h"
+#include "executor/elide.h"
+
+// Fork elision. One pass over a parsed command marks the places where a
+// fork can be skipped, and the executor acts on the marks:
+//   AST_TAIL    nothing runs after the node in the process that runs it.
+//               When that process is about to exit (ex->exit_after), an
+//               external command replaces it with execve instead of being
+//               spawned and waited for, and a pipeline's last stage runs in
+//               it rather than in a child.
+//   AST_INLINE  a subshell whose body can only change the directory and
+//               whether the shell is exiting. The executor saves and puts
+//               those back instead of forking; AST_CHDIR says it may cd.
+
+static void mark(const ast_t *ast, ast_ref_t ref, bool tail);
+static bool inline_safe(const ast_t *ast, ast_ref_t ref, uint8_t *flags);
+static bool pure_redirs(const ast_t *ast, ast_range_t range);
+static bool pure_simple(const ast_t *ast, const ast_node_t *node);
+static bool pure_parts(const ast_t *ast, ast_range_t range, bool arith);
+static bool arith_assigns(const char *s);
+
+void elide_mark(const ast_t *ast, ast_ref_t root) {
+  mark(ast, root, true);
+}
+
+// Whether `ref` can run in place of a subshell with no state saved at all,
+// as $(...) does: only lists of pure builtins with no assignments or
+// redirections, over words that cannot assign.
+bool elide_pure(const ast_t *ast, ast_ref_t ref) {
+  const ast_node_t *node = ast_node(ast, ref);
+  switch (node->type) {
+    case AST_SEQUENCE:
+    case AST_AND:
+    case AST_OR:
+      return elide_pure(ast, node->u.binary.left) &&
+             elide_pure(ast, node->u.binary.right);
+    case AST_SIMPLE: {
+      if (node->u.simple.assigns.count || node->u.simple.redirs.count ||
+          !pure_simple(ast, node)) {
+        return false;
+      }
+      const ast_word_t *args    = ast_args(ast, node->u.simple.args);
+      const builtin_t  *builtin = builtin_lookup(args[0].text);
+      return builtin && (builtin->flags & BUILTIN_PURE);
+    }
+    default: return false;
+  }
+}
+
+static void mark(const ast_t *ast, ast_ref_t ref, bool tail) {
+  if (ref == AST_NULL) return;
+  ast_node_t *node = ast_node(ast, ref);
+  node->flags      = tail ? AST_TAIL : 0;
+
+  switch (node->type) {
+    case AST_SIMPLE: break;
+    case AST_PIPELINE: {
+      // Each stage is the last thing its own process does.
+      const ast_ref_t *stages = ast_stages(ast, node->u.pipeline.stages);
+      for (uint32_t i = 0; i < node->u.pipeline.stages.count; i++) {
+        mark(ast, stages[i], true);
+      }
+      break;
+    }
+    case AST_SEQUENCE:
+    case AST_AND:
+    case AST_OR:
+      mark(ast, node->u.binary.left, false);
+      mark(ast, node->u.binary.right, tail);
+      break;
+    case AST_BACKGROUND: mark(ast, node->u.background.child, true); break;
+    case AST_SUBSHELL: {
+      // Forked, the body is all its process does. Run inline, the executor
+      // keeps AST_TAIL in the body from counting unless the subshell's own
+      // AST_TAIL does.
+      mark(ast, node->u.subshell.child, true);
+      uint8_t flags = AST_INLINE;
+      if (inline_safe(ast, node->u.subshell.child, &flags)) {
+        node->flags |= flags;
+      }
+      break;
+    }
+    case AST_NOT: mark(ast, node->u.negation.child, false); break;
+    case AST_IF: {
+      // The branch taken is the last thing the if does, unless the if's
+      // own redirections still have to be undone after it.
+      bool last = tail && node->u.compound.redirs.count == 0;
+      mark(ast, node->u.if_clause.cond, false);
+      mark(ast, node->u.if_clause.then_part, last);
+      mark(ast, node->u.if_clause.else_part, last);
+      break;
+    }
+    case AST_WHILE:
+    case AST_UNTIL:
+      mark(ast, node->u.loop.cond, false);
+      mark(ast, node->u.loop.body, false);
+      break;
+    case AST_FOR: mark(ast, node->u.for_clause.body, false); break;
+    case AST_CASE: {
+      bool                   last  = tail && node->u.compound.redirs.count == 0;
+      const ast_case_item_t *items = ast_items(ast, node->u.case_clause.items);
+      for (uint32_t i = 0; i < node->u.case_clause.items.count; i++) {
+        mark(ast, items[i].body, last);
+      }
+      break;
+    }
+  }
+}
+
+// Pipeline stages and nested subshells keep their effects to themselves
+// whichever way they run. A background job would be the shell's own.
+static bool inline_safe(const ast_t *ast, ast_ref_t ref, uint8_t *flags) {
+  if (ref == AST_NULL) return false;
+  const ast_node_t *node = ast_node(ast, ref);
+  switch (node->type) {
+    case AST_PIPELINE:
+    case AST_SUBSHELL: return true;
+    case AST_BACKGROUND: return false;
+    case AST_SEQUENCE:
+    case AST_AND:
+    case AST_OR:
+      return inline_safe(ast, node->u.binary.left, flags) &&
+             inline_safe(ast, node->u.binary.right, flags);
+    case AST_SIMPLE: {
+      if (!pure_simple(ast, node)) return false;
+      const ast_assignment_t *assigns =
+          ast_assigns(ast, node->u.simple.assigns);
+      for (uint32_t i = 0; i < node->u.simple.assigns.count; i++) {
+        if (!pure_parts(ast, assigns[i].value.parts, false)) return false;
+      }
+      if (!pure_redirs(ast, node->u.simple.redirs)) return false;
+
+      // Prefix assignments only reach a builtin's environment, and an
+      // external command runs in a child anyway.
+      const ast_word_t *args    = ast_args(ast, node->u.simple.args);
+      const builtin_t  *builtin = builtin_lookup(args[0].text);
+      if (!builtin || (builtin->flags & BUILTIN_PURE)) return true;
+      if (builtin->fn == builtin_cd) {
+        *flags |= AST_CHDIR;
+        return true;
+      }
+      return builtin->fn == builtin_exit;
+    }
+    case AST_NOT: return inline_safe(ast, node->u.negation.child, flags);
+    case AST_IF: {
+      ast_ref_t else_part = node->u.if_clause.else_part;
+      return pure_redirs(ast, node->u.compound.redirs) &&
+             inline_safe(ast, node->u.if_clause.cond, flags) &&
+             inline_safe(ast, node->u.if_clause.then_part, flags) &&
+             (else_part == AST_NULL || inline_safe(ast, else_part, flags));
+    }
+    case AST_WHILE:
+    case AST_UNTIL:
+      return pure_redirs(ast, node->u.compound.redirs) &&
+             inline_safe(ast, node->u.loop.cond, flags) &&
+             inline_safe(ast, node->u.loop.body, flags);
+    case AST_CASE: {
+      const ast_word_t *subject =
+          &ast->args.items[node->u.case_clause.subject];
+      if (!pure_redirs(ast, node->u.compound.redirs) ||
+          !pure_parts(ast, subject->parts, false)) {
+        return false;
+      }
+      const ast_case_item_t *items = ast_items(ast, node->u.case_clause.items);
+      for (uint32_t i = 0; i < node->u.case_clause.items.count; i++) {
+        const ast_word_t *patterns = ast_args(ast, items[i].patterns);
+        for (uint32_t j = 0; j < items[i].patterns.count; j++) {
+          if (!pure_parts(ast, patterns[j].parts, false)) return false;
+        }
+        if (items[i].body != AST_NULL &&
+            !inline_safe(ast, items[i].body, flags)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    // The loop variable is an assignment.
+    case AST_FOR: return false;
+  }
+  return false;
+}
+
+static bool pure_redirs(const ast_t *ast, ast_range_t range) {
+  const ast_redir_t *redirs = ast_redirs(ast, range);
+  for (uint32_t i = 0; i < range.count; i++) {
+    if (!pure_parts(ast, redirs[i].target.parts, false) ||
+        !pure_parts(ast, redirs[i].body.parts, false)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// A command whose name is literal, so it cannot turn out to be a builtin
+// other than the one it names, and whose arguments cannot assign.
+static bool pure_simple(const ast_t *ast, const ast_node_t *node) {
+  const ast_word_t *args  = ast_args(ast, node->u.simple.args);
+  uint32_t          count = node->u.simple.args.count;
+  if (count == 0 || args[0].parts.count) return false;
+  for (uint32_t i = 1; i < count; i++) {
+    if (!pure_parts(ast, args[i].parts, false)) return false;
+  }
+  return true;
+}
+
+// ${x:=...}, ${x?...} and assignments inside $((...)) reach past a subshell.
+// A nested $(...) is fine: it makes the same choice for itself. Inside
+// $((...)) only literal text can be checked; an expansion there may bring
+// its own `=`, as `e=x=5; $(($e))` does.
+static bool pure_parts(const ast_t *ast, ast_range_t range, bool arith) {
+  const ast_part_t *parts = ast_parts(ast, range);
+  for (uint32_t i = 0; i < range.count; i++) {
+    if (arith && parts[i].type != PART_LITERAL) return false;
+    switch ((ast_part_type_t)parts[i].type) {
+      case PART_LITERAL:
+        if (arith && arith_assigns(parts[i].text)) return false;
+        break;
+      case PART_PARAM:
+        if (parts[i].op == PARAM_ASSIGN || parts[i].op == PARAM_ERROR ||
+            !pure_parts(ast, parts[i].word, false)) {
+          return false;
+        }
+        break;
+      case PART_ARITH:
+        if (!pure_parts(ast, parts[i].word, true)) return false;
+        break;
+      case PART_COMMAND:
+      case PART_TILDE: break;
+    }
+  }
+  return true;
+}
+
+// An `=` that is not part of == != <= >=, though <<= and >>= do assign.
+static bool arith_assigns(const char *s) {
+  for (const char *p = strchr(s, '='); p; p = strchr(p + 1, '=')) {
+    if (p[1] == '=') {
+      p++;
+      continue;
+    }
+    if (p == s || !strchr("=!<>", p[-1])) return true;
+    if (p - s >= 2 && (p[-1] == '<' || p[-1] == '>') && p[-2] == p[-1]) {
+      return true;
+    }
+  }
+  return false;
+}
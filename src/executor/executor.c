@@ -0,0 +1,1031 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "collections/vector.h"
+#include "executor/arith.h"
+#include "executor/builtins.h"
+#include "executor/elide.h"
+#include "executor/executor.h"
+#include "executor/expand.h"
+#include "executor/jobs.h"
+#include "executor/pathcache.h"
+#include "executor/redir.h"
+
+// Where a child's stdin/stdout come from inside a pipeline; -1 leaves the
+// shell's own. `spare` is a pipe end only the parent should keep. `group`
+// starts the child in a process group of its own, for a background job.
+typedef struct {
+  int  in;
+  int  out;
+  int  spare;
+  bool group;
+} exec_io_t;
+
+static const exec_io_t NO_IO = {-1, -1, -1, false};
+
+static int    exec_node(executor_t *ex, ast_ref_t ref);
+static int    exec_pipeline(executor_t *ex, const ast_node_t *node);
+static int    exec_tail(executor_t *ex, const ast_node_t *node, char **argv);
+static int    inline_subshell(executor_t *ex, const ast_node_t *node);
+static int    exec_redirected(executor_t *ex, const ast_node_t *node);
+static int    exec_compound(executor_t *ex, const ast_node_t *node);
+static int    exec_loop(executor_t *ex, const ast_node_t *node);
+static int    exec_for(executor_t *ex, const ast_node_t *node);
+static int    exec_case(executor_t *ex, const ast_node_t *node);
+static bool   loop_stops(executor_t *ex);
+static void   next_iteration(executor_t *ex, arena_mark_t mark);
+static int    exec_assignments(executor_t *ex, const ast_node_t *node,
+                               unsigned substitutions);
+static pid_t  start_node(executor_t *ex, ast_ref_t ref, exec_io_t io);
+static pid_t  spawn_simple(executor_t *ex, const ast_node_t *node,
+                           char **argv, exec_io_t io);
+static pid_t  fork_node(executor_t *ex, ast_ref_t ref, exec_io_t io);
+static void   start_job(executor_t *ex, ast_ref_t ref, pid_t pid);
+static void   describe(FILE *out, const ast_t *ast, ast_ref_t ref);
+static void   describe_words(FILE *out, const ast_t *ast, ast_range_t range,
+                             const char *lead, const char *sep);
+static void   describe_redirs(FILE *out, const ast_t *ast, ast_range_t range,
+                              const char *sep);
+static int    run_builtin(executor_t *ex, const ast_node_t *node,
+                          const builtin_t *builtin, int argc, char **argv);
+static bool   expand_redirs(executor_t *ex, ast_range_t range,
+                            const ast_redir_t **out);
+static char  *resolve_command(executor_t *ex, const char *path,
+                              const char *name, bool *owned);
+static int    exec_error(executor_t *ex, const redir_plan_t *plan,
+                         const char *name, int err);
+static char **build_envp(executor_t *ex, const ast_node_t *node,
+                         const char **path);
+static int    wait_pid(pid_t pid);
+static void   resize_pipe(executor_t *ex, int fd);
+
+void executor_init(executor_t *ex, arena_t *arena) {
+  ex->status     = 0;
+  ex->last_bg    = 0;
+  ex->shell_pid  = getpid();
+  ex->arena      = arena;
+  ex->ast        = NULL;
+  ex->exiting    = false;
+  ex->exit_after = false;
+  pathcache_init(&ex->paths);
+  vars_init(&ex->vars);
+  jobs_init(&ex->jobs);
+  lineread_init(&ex->input);
+  ex->jobs_max      = 0;
+  ex->pipe_size     = 0;
+  ex->pipe_max      = 0;
+  ex->substitutions = 0;
+  ex->forks         = 0;
+  ex->forks_saved   = 0;
+  ex->loops         = 0;
+  ex->breaking      = 0;
+  ex->continuing    = false;
+  ex->job_control   = false;
+  ex->batch_output  = false;
+  expand_set_ifs(ex, exec_getvar(ex, "IFS"));
+}
+
+void executor_free(executor_t *ex) {
+  pathcache_free(&ex->paths);
+  vars_free(&ex->vars);
+  jobs_free(&ex->jobs);
+  lineread_free(&ex->input);
+}
+
+const char *exec_getvar(executor_t *ex, const char *name) {
+  return vars_get(&ex->vars, name);
+}
+
+// Returns 0, or 1 after reporting a readonly variable.
+int exec_setvar(executor_t *ex, const char *name, const char *value) {
+  if (!vars_set(&ex->vars, name, value)) {
+    fprintf(stderr, "tiny: %s: %s\n", name,
+            errno == EPERM ? "readonly variable" : strerror(errno));
+    return 1;
+  }
+  if (strcmp(name, "PATH") == 0) pathcache_clear(&ex->paths);
+  if (strcmp(name, "IFS") == 0) expand_set_ifs(ex, exec_getvar(ex, name));
+  return 0;
+}
+
+int exec_unsetvar(executor_t *ex, const char *name) {
+  if (!vars_unset(&ex->vars, name)) {
+    fprintf(stderr, "tiny: unset: %s: readonly variable\n", name);
+    return 1;
+  }
+  if (strcmp(name, "PATH") == 0) pathcache_clear(&ex->paths);
+  if (strcmp(name, "IFS") == 0) expand_set_ifs(ex, exec_getvar(ex, name));
+  return 0;
+}
+
+int exec_run(executor_t *ex, const ast_t *ast, ast_ref_t root) {
+  // Nothing from an earlier command still points at a variable's value.
+  vars_compact(&ex->vars);
+  elide_mark(ast, root);
+  arith_prepare(ast);
+  ex->ast    = ast;
+  ex->status = exec_node(ex, root);
+  return ex->status;
+}
+
+// Runs `root` of another tree in the middle of the current command, as for a
+// command substitution done in-process, then switches back to the current
+// tree. Unlike exec_run, leaves variable storage alone: the command being
+// expanded may still point into it.
+int exec_inline(executor_t *ex, const ast_t *ast, ast_ref_t root) {
+  const ast_t *outer      = ex->ast;
+  bool         exit_after = ex->exit_after;
+  ex->ast                 = ast;
+  ex->exit_after          = false;
+  int status              = exec_node(ex, root);
+  ex->ast                 = outer;
+  ex->exit_after          = exit_after;
+  return status;
+}
+
+// Starts `root` of another tree with its stdout on `out` and returns its pid
+// without waiting, or -1. `spare` is the other end of that pipe, which the
+// child must not hold. Simple commands are spawned; anything else runs in a
+// forked copy of the shell.
+pid_t exec_start(executor_t *ex, const ast_t *ast, ast_ref_t root, int out,
+                 int spare) {
+  exec_io_t    io    = {-1, out, spare, false};
+  const ast_t *outer = ex->ast;
+  ex->ast            = ast;
+  pid_t pid          = start_node(ex, root, io);
+  ex->ast            = outer;
+  return pid;
+}
+
+// With $TINY_STATS set, reports to stderr how many children the shell
+// started and how many elide_mark let it skip: called as the shell exits or
+// replaces itself.
+void exec_stats(executor_t *ex) {
+  if (!exec_getvar(ex, "TINY_STATS")) return;
+  fprintf(stderr, "tiny: forks %u, saved %u, substitutions %u\n", ex->forks,
+          ex->forks_saved, ex->substitutions);
+}
+
+// Collects finished background jobs without blocking. With job control on
+// (an interactive shell) they are also reported, which forgets them;
+// otherwise they are forgotten quietly, bar the status `wait` may ask for.
+void exec_reap(executor_t *ex) {
+  jobs_poll(&ex->jobs, 0);
+  if (ex->job_control) jobs_notify(&ex->jobs, stderr);
+  else jobs_retire(&ex->jobs);
+}
+
+static int exec_node(executor_t *ex, ast_ref_t ref) {
+  if (ref == AST_NULL || ex->exiting || ex->breaking) return ex->status;
+
+  const ast_node_t *node = ast_node(ex->ast, ref);
+  switch (node->type) {
+    case AST_SIMPLE: {
+      unsigned subs = ex->substitutions;
+      char   **argv;
+      int      argc;
+      if (!expand_words(ex, ast_args(ex->ast, node->u.simple.args),
+                        node->u.simple.args.count, &argv, &argc)) {
+        return 1;
+      }
+      if (argc == 0) return exec_assignments(ex, node, subs);
+
+      const builtin_t *builtin = builtin_lookup(argv[0]);
+      if (builtin) return run_builtin(ex, node, builtin, argc, argv);
+      if ((node->flags & AST_TAIL) && ex->exit_after) {
+        return exec_tail(ex, node, argv);
+      }
+
+      pid_t pid = spawn_simple(ex, node, argv, NO_IO);
+      return pid < 0 ? ex->status : wait_pid(pid);
+    }
+    case AST_PIPELINE: return exec_pipeline(ex, node);
+    case AST_SEQUENCE:
+      ex->status = exec_node(ex, node->u.binary.left);
+      return exec_node(ex, node->u.binary.right);
+    case AST_AND:
+      ex->status = exec_node(ex, node->u.binary.left);
+      if (ex->status != 0 || ex->exiting) return ex->status;
+      return exec_node(ex, node->u.binary.right);
+    case AST_OR:
+      ex->status = exec_node(ex, node->u.binary.left);
+      if (ex->status == 0 || ex->exiting) return ex->status;
+      return exec_node(ex, node->u.binary.right);
+    case AST_BACKGROUND: {
+      // With a cap, the shell itself waits for a slot before starting more.
+      while (ex->jobs_max && ex->jobs.running >= ex->jobs_max) {
+        jobs_poll(&ex->jobs, -1);
+      }
+      exec_io_t io  = {-1, -1, -1, ex->job_control};
+      pid_t     pid = start_node(ex, node->u.background.child, io);
+      if (pid > 0) start_job(ex, node->u.background.child, pid);
+      return 0;
+    }
+    case AST_SUBSHELL: {
+      if (node->flags & AST_INLINE) return inline_subshell(ex, node);
+      pid_t pid = fork_node(ex, node->u.subshell.child, NO_IO);
+      return pid < 0 ? 1 : wait_pid(pid);
+    }
+    case AST_NOT: {
+      int status = exec_node(ex, node->u.negation.child);
+      return ex->exiting ? status : status == 0;
+    }
+    case AST_IF:
+    case AST_WHILE:
+    case AST_UNTIL:
+    case AST_FOR:
+    case AST_CASE:
+      if (node->u.compound.redirs.count) return exec_redirected(ex, node);
+      return exec_compound(ex, node);
+  }
+  return 1;
+}
+
+static int exec_pipeline(executor_t *ex, const ast_node_t *node) {
+  const ast_ref_t *stages = ast_stages(ex->ast, node->u.pipeline.stages);
+  uint32_t         count  = node->u.pipeline.stages.count;
+
+  vector_t pids;
+  vector_init(&pids, sizeof(pid_t), ex->arena);
+
+  int   in       = -1;
+  int   status   = 0;
+  pid_t last     = -1;
+  bool  in_shell = (node->flags & AST_TAIL) && ex->exit_after;
+  bool  ran_last = false;
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (i + 1 == count && in_shell) {
+      // Nothing follows the pipeline: rather than start the last stage and
+      // wait for it, the shell becomes it, with the pipe as its stdin.
+      if (in >= 0) {
+        dup2(in, 0);
+        close(in);
+        in = -1;
+      }
+      ex->forks_saved++;
+      status   = exec_node(ex, stages[i]);
+      ran_last = true;
+      break;
+    }
+
+    int fds[2] = {-1, -1};
+    if (i + 1 < count && pipe2(fds, O_CLOEXEC) < 0) {
+      fprintf(stderr, "tiny: pipe: %s\n", strerror(errno));
+      status = 1;
+      break;
+    }
+    if (fds[0] >= 0 && ex->pipe_size) resize_pipe(ex, fds[0]);
+
+    exec_io_t io  = {in, fds[1], fds[0], false};
+    pid_t     pid = start_node(ex, stages[i], io);
+
+    if (in >= 0) close(in);
+    if (fds[1] >= 0) close(fds[1]);
+    in = fds[0];
+
+    last = pid;
+    if (pid > 0) VECTOR_PUSH(&pids, pid_t, pid);
+  }
+  if (in >= 0) close(in);
+
+  for (size_t i = 0; i < pids.length; i++) {
+    pid_t pid    = VECTOR_AT(&pids, pid_t, i);
+    int   result = wait_pid(pid);
+    if (pid == last && !ran_last) status = result;
+  }
+
+  return last < 0 && !ran_last ? ex->status : status;
+}
+
+// The last command of a process that is about to exit replaces it, which
+// saves spawning the command and waiting for it. Returns only if the command
+// could not be run.
+static int exec_tail(executor_t *ex, const ast_node_t *node, char **argv) {
+  const ast_redir_t *redirs = ast_redirs(ex->ast, node->u.simple.redirs);
+  uint32_t           count  = node->u.simple.redirs.count;
+  for (uint32_t i = 0; i < count; i++) {
+    // A long here-document may be fed by a thread, which execve would end.
+    if (redirs[i].type == REDIR_HERE_DOC ||
+        redirs[i].type == REDIR_HERE_STRIP) {
+      pid_t pid = spawn_simple(ex, node, argv, NO_IO);
+      return pid < 0 ? ex->status : wait_pid(pid);
+    }
+  }
+  if (!expand_redirs(ex, node->u.simple.redirs, &redirs)) return 1;
+
+  redir_plan_t plan;
+  redir_plan_init(&plan, ex->arena);
+  if (!redir_plan_build(&plan, redirs, count)) {
+    redir_plan_release(&plan);
+    return 1;
+  }
+
+  const char *env_path;
+  char      **envp    = build_envp(ex, node, &env_path);
+  bool        owned   = false;
+  bool        applied = false;
+  char       *path    = NULL;
+  int         err     = ENOENT;
+  if (envp) path = resolve_command(ex, env_path, argv[0], &owned);
+
+  if (path) {
+    // Output still buffered belongs where stdout was before the command's
+    // own redirections.
+    ex->forks_saved++;
+    exec_stats(ex);
+    fflush(NULL);
+    err = 0; // redir_plan_apply reports its own failure
+    if ((applied = redir_plan_apply(&plan))) {
+      sigset_t none;
+      sigemptyset(&none);
+      sigprocmask(SIG_SETMASK, &none, NULL);
+      execve(path, argv, envp);
+      err = errno;
+
+      // A remembered path that vanished: forget it and search $PATH again.
+      if (err == ENOENT && !owned && path != argv[0]) {
+        pathcache_forget(&ex->paths, argv[0]);
+        path = resolve_command(ex, env_path, argv[0], &owned);
+        if (path) execve(path, argv, envp);
+        err = path ? errno : ENOENT;
+      }
+    }
+    ex->forks_saved--;
+  }
+  if (path && owned) free(path);
+  if (node->u.simple.assigns.count) vars_drop_overlay(&ex->vars);
+
+  int status = 1;
+  if (envp && err) {
+    status = exec_error(ex, applied ? NULL : &plan, argv[0], err);
+  }
+  redir_plan_release(&plan);
+  return status;
+}
+
+// A subshell marked AST_INLINE runs in the shell itself. All its body can
+// change is the directory, with $PWD and $OLDPWD, and whether the shell is
+// exiting, so only those are saved and put back.
+static int inline_subshell(executor_t *ex, const ast_node_t *node) {
+  int         cwd    = -1;
+  const char *pwd    = NULL;
+  const char *oldpwd = NULL;
+  if (node->flags & AST_CHDIR) {
+    cwd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (cwd < 0) {
+      pid_t pid = fork_node(ex, node->u.subshell.child, NO_IO);
+      return pid < 0 ? 1 : wait_pid(pid);
+    }
+    // Copied: `cd` replaces the values the store holds.
+    pwd    = exec_getvar(ex, "PWD");
+    oldpwd = exec_getvar(ex, "OLDPWD");
+    if (pwd) pwd = arena_strndup(ex->arena, pwd, strlen(pwd));
+    if (oldpwd) oldpwd = arena_strndup(ex->arena, oldpwd, strlen(oldpwd));
+  }
+
+  bool exit_after = ex->exit_after;
+  ex->exit_after  = exit_after && (node->flags & AST_TAIL);
+  ex->forks_saved++;
+  int status     = exec_node(ex, node->u.subshell.child);
+  ex->exit_after = exit_after;
+  ex->exiting    = false;
+
+  if (cwd >= 0) {
+    if (fchdir(cwd) != 0) {
+      fprintf(stderr, "tiny: cd: %s\n", strerror(errno));
+    }
+    close(cwd);
+    if (pwd) exec_setvar(ex, "PWD", pwd);
+    else exec_unsetvar(ex, "PWD");
+    if (oldpwd) exec_setvar(ex, "OLDPWD", oldpwd);
+    else exec_unsetvar(ex, "OLDPWD");
+  }
+  return status;
+}
+
+// Redirections on a compound command cover everything it runs, so they are
+// made on the shell's own descriptors and undone afterwards, as for a
+// builtin. `while read line; do ...; done <file` reads the file throughout.
+static int exec_redirected(executor_t *ex, const ast_node_t *node) {
+  const ast_redir_t *redirs;
+  if (!expand_redirs(ex, node->u.compound.redirs, &redirs)) return 1;
+
+  redir_plan_t plan;
+  vector_t     saved;
+  redir_plan_init(&plan, ex->arena);
+  vector_init(&saved, sizeof(redir_op_t), ex->arena);
+
+  int status = 1;
+  fflush(NULL);
+  if (redir_plan_build(&plan, redirs, node->u.compound.redirs.count) &&
+      redir_plan_apply_saving(&plan, &saved)) {
+    status = exec_compound(ex, node);
+  }
+  fflush(NULL);
+  redir_restore(&saved);
+  redir_plan_release(&plan);
+  return status;
+}
+
+static int exec_compound(executor_t *ex, const ast_node_t *node) {
+  switch (node->type) {
+    case AST_IF:
+      ex->status = exec_node(ex, node->u.if_clause.cond);
+      if (ex->exiting || ex->breaking) return ex->status;
+      if (ex->status == 0) return exec_node(ex, node->u.if_clause.then_part);
+      if (node->u.if_clause.else_part == AST_NULL) return 0;
+      return exec_node(ex, node->u.if_clause.else_part);
+    case AST_WHILE:
+    case AST_UNTIL: return exec_loop(ex, node);
+    case AST_FOR: return exec_for(ex, node);
+    case AST_CASE: return exec_case(ex, node);
+    default: return 1;
+  }
+}
+
+// The body is run from the AST on every pass, and each pass starts from the
+// arena as the loop found it: what an iteration expanded or built is gone
+// before the next, so a loop runs in the memory of one pass however long it
+// goes on. The status is the body's last, or 0 if it never ran.
+static int exec_loop(executor_t *ex, const ast_node_t *node) {
+  arena_mark_t mark   = arena_mark(ex->arena);
+  int          status = 0;
+  ex->loops++;
+  for (;;) {
+    ex->status = exec_node(ex, node->u.loop.cond);
+    if (loop_stops(ex)) break;
+    if ((ex->status == 0) != (node->type == AST_WHILE)) break;
+
+    status     = exec_node(ex, node->u.loop.body);
+    ex->status = status;
+    bool stop  = loop_stops(ex);
+    next_iteration(ex, mark);
+    if (stop) break;
+  }
+  ex->loops--;
+  return status;
+}
+
+// The words are expanded once, before the first pass, into memory that the
+// passes leave alone.
+static int exec_for(executor_t *ex, const ast_node_t *node) {
+  const ast_word_t *words = ast_args(ex->ast, node->u.for_clause.words);
+  uint32_t          count = node->u.for_clause.words.count;
+  char            **argv;
+  int               argc;
+  if (!expand_words(ex, words + 1, count - 1, &argv, &argc)) return 1;
+
+  arena_mark_t mark   = arena_mark(ex->arena);
+  int          status = 0;
+  ex->loops++;
+  for (int i = 0; i < argc; i++) {
+    if (exec_setvar(ex, words[0].text, argv[i]) != 0) {
+      status = 1;
+      break;
+    }
+    status     = exec_node(ex, node->u.for_clause.body);
+    ex->status = status;
+    bool stop  = loop_stops(ex);
+    next_iteration(ex, mark);
+    if (stop) break;
+  }
+  ex->loops--;
+  return status;
+}
+
+// The first item with a pattern matching the word runs; patterns are
+// expanded only as far as it takes to find it.
+static int exec_case(executor_t *ex, const ast_node_t *node) {
+  const ast_word_t *word    = &ex->ast->args.items[node->u.case_clause.subject];
+  const char       *subject = expand_word(ex, word);
+  if (!subject) return 1;
+
+  const ast_case_item_t *items = ast_items(ex->ast, node->u.case_clause.items);
+  for (uint32_t i = 0; i < node->u.case_clause.items.count; i++) {
+    const ast_word_t *patterns = ast_args(ex->ast, items[i].patterns);
+    for (uint32_t j = 0; j < items[i].patterns.count; j++) {
+      const char *pattern = expand_pattern(ex, &patterns[j]);
+      if (!pattern) return 1;
+      if (fnmatch(pattern, subject, 0) == 0) {
+        return items[i].body == AST_NULL ? 0 : exec_node(ex, items[i].body);
+      }
+    }
+  }
+  return 0;
+}
+
+// After a command in a loop: whether the loop is over, because the shell is
+// exiting or a `break` or `continue` is leaving it. A `continue` aimed at
+// this loop is used up here, and the loop goes round again.
+static bool loop_stops(executor_t *ex) {
+  if (ex->exiting) return true;
+  if (!ex->breaking) return false;
+  if (--ex->breaking) return true;
+  bool stop      = !ex->continuing;
+  ex->continuing = false;
+  return stop;
+}
+
+// Ends a pass through a loop. Nothing from the pass points into the arena
+// past `mark` or at a variable's value any more, so both can be reclaimed,
+// and background jobs it started are reaped as they would be between
+// commands.
+static void next_iteration(executor_t *ex, arena_mark_t mark) {
+  arena_rewind(ex->arena, mark);
+  vars_compact(&ex->vars);
+  if (ex->last_bg) exec_reap(ex);
+}
+
+// `NAME=value` with no command name, plus any redirections, which are
+// performed (creating files) and then dropped. The status is that of the last
+// command substitution if one ran since `substitutions` was read, as in
+// `x=$(false)`.
+static int exec_assignments(executor_t *ex, const ast_node_t *node,
+                            unsigned substitutions) {
+  const ast_redir_t *redirs;
+  if (!expand_redirs(ex, node->u.simple.redirs, &redirs)) return 1;
+
+  redir_plan_t plan;
+  redir_plan_init(&plan, ex->arena);
+  bool ok = redir_plan_build(&plan, redirs, node->u.simple.redirs.count);
+  redir_plan_release(&plan);
+  if (!ok) return 1;
+
+  ast_assignment_t *assigns = ast_assigns(ex->ast, node->u.simple.assigns);
+  int               status  = 0;
+  for (uint32_t i = 0; i < node->u.simple.assigns.count; i++) {
+    char *value = expand_word(ex, &assigns[i].value);
+    if (!value) return 1;
+    status |= exec_setvar(ex, assigns[i].name, value);
+  }
+  if (status == 0 && ex->substitutions != substitutions) return ex->status;
+  return status;
+}
+
+// Builtins run inside the shell: redirections are applied to the shell's own
+// descriptors and undone afterwards instead of forking.
+static int run_builtin(executor_t *ex, const ast_node_t *node,
+                       const builtin_t *builtin, int argc, char **argv) {
+  if (node->u.simple.redirs.count == 0) {
+    int status = builtin->fn(ex, argc, argv);
+    if (!ex->batch_output) fflush(stdout);
+    return status;
+  }
+
+  const ast_redir_t *redirs;
+  if (!expand_redirs(ex, node->u.simple.redirs, &redirs)) return 1;
+
+  redir_plan_t plan;
+  vector_t     saved;
+  redir_plan_init(&plan, ex->arena);
+  vector_init(&saved, sizeof(redir_op_t), ex->arena);
+
+  int status = 1;
+  fflush(NULL);
+  if (redir_plan_build(&plan, redirs, node->u.simple.redirs.count) &&
+      redir_plan_apply_saving(&plan, &saved)) {
+    status = builtin->fn(ex, argc, argv);
+  }
+  fflush(NULL);
+  redir_restore(&saved);
+  redir_plan_release(&plan);
+  return status;
+}
+
+// Starts `ref` without waiting. Simple commands are spawned directly; anything
+// that needs the shell itself (subshells, lists) runs in a forked copy. Only
+// a literal command name shows that a command is not a builtin before its
+// words are expanded; the others expand in the fork, so nothing runs twice.
+static pid_t start_node(executor_t *ex, ast_ref_t ref, exec_io_t io) {
+  const ast_node_t *node = ast_node(ex->ast, ref);
+
+  if (node->type == AST_SIMPLE && node->u.simple.args.count > 0) {
+    const ast_word_t *args = ast_args(ex->ast, node->u.simple.args);
+    char            **argv;
+    int               argc;
+    if (args[0].parts.count == 0 && !builtin_lookup(args[0].text)) {
+      if (!expand_words(ex, args, node->u.simple.args.count, &argv, &argc)) {
+        ex->status = 1;
+        return -1;
+      }
+      return spawn_simple(ex, node, argv, io);
+    }
+  }
+  if (node->type == AST_SUBSHELL) {
+    return fork_node(ex, node->u.subshell.child, io);
+  }
+  return fork_node(ex, ref, io);
+}
+
+// posix_spawn uses CLONE_VM|CLONE_VFORK on Linux, so the cost of starting a
+// command does not grow with the shell's heap the way fork() does.
+static pid_t spawn_simple(executor_t *ex, const ast_node_t *node,
+                          char **argv, exec_io_t io) {
+  const ast_redir_t *redirs;
+  if (!expand_redirs(ex, node->u.simple.redirs, &redirs)) {
+    ex->status = 1;
+    return -1;
+  }
+
+  redir_plan_t plan;
+  redir_plan_init(&plan, ex->arena);
+  if (io.in >= 0) redir_plan_add(&plan, io.in, 0);
+  if (io.out >= 0) redir_plan_add(&plan, io.out, 1);
+
+  if (!redir_plan_build(&plan, redirs, node->u.simple.redirs.count)) {
+    redir_plan_release(&plan);
+    ex->status = 1;
+    return -1;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+
+  // The shell may hold SIGCHLD blocked for the job reaper; commands start
+  // with nothing blocked.
+  posix_spawnattr_t attr;
+  sigset_t          none;
+  short             flags = POSIX_SPAWN_SETSIGMASK;
+  sigemptyset(&none);
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setsigmask(&attr, &none);
+  if (io.group) {
+    flags |= POSIX_SPAWN_SETPGROUP;
+    posix_spawnattr_setpgroup(&attr, 0);
+  }
+  posix_spawnattr_setflags(&attr, flags);
+
+  // Builtin output buffered ahead of this command must reach the pipe first.
+  if (ex->batch_output) fflush(stdout);
+
+  pid_t       pid  = -1;
+  int         err  = ENOMEM;
+  const char *env_path;
+  char      **envp = build_envp(ex, node, &env_path);
+  if (envp && redir_plan_spawn_actions(&plan, &actions)) {
+    bool  owned;
+    char *path = resolve_command(ex, env_path, argv[0], &owned);
+    err        = path ? posix_spawn(&pid, path, &actions, &attr, argv, envp)
+                      : ENOENT;
+
+    // A remembered path that vanished: forget it and search $PATH once more.
+    if (err == ENOENT && path && !owned && path != argv[0]) {
+      pathcache_forget(&ex->paths, argv[0]);
+      path = resolve_command(ex, env_path, argv[0], &owned);
+      if (path) err = posix_spawn(&pid, path, &actions, &attr, argv, envp);
+    }
+    if (owned) free(path);
+  }
+  if (node->u.simple.assigns.count) vars_drop_overlay(&ex->vars);
+  if (envp && err) ex->status = exec_error(ex, &plan, argv[0], err);
+
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  redir_plan_release(&plan);
+
+  if (!envp) {
+    ex->status = 1;
+    return -1;
+  }
+  if (err) return -1;
+  ex->forks++;
+  return pid;
+}
+
+// Finds the program for `name`. A prefix `PATH=...` assignment, passed as
+// `path`, applies to this command only, so it bypasses (and does not disturb)
+// the cache; the result is then malloc'd and `*owned` is set.
+static char *resolve_command(executor_t *ex, const char *path,
+                             const char *name, bool *owned) {
+  *owned = false;
+  if (path && !strchr(name, '/')) {
+    *owned = true;
+    return pathcache_search(&ex->paths, name, path);
+  }
+  return (char *)pathcache_lookup(&ex->paths, name,
+                                  exec_getvar(ex, "PATH"));
+}
+
+// A command that cannot be run says so on its own stderr, so that
+// `cmd 2>/dev/null || fallback` stays quiet. The plan is applied for the
+// message and undone after it; NULL means it is already in effect. Returns
+// the command's status: 127 if not found, 126 otherwise, 1 if the
+// redirections themselves fail.
+static int exec_error(executor_t *ex, const redir_plan_t *plan,
+                      const char *name, int err) {
+  vector_t saved;
+  vector_init(&saved, sizeof(redir_op_t), ex->arena);
+  fflush(NULL);
+  bool ok = !plan || redir_plan_apply_saving(plan, &saved);
+  if (ok && err == ENOENT) fprintf(stderr, "tiny: %s: not found\n", name);
+  else if (ok) fprintf(stderr, "tiny: %s: %s\n", name, strerror(err));
+  redir_restore(&saved);
+  if (!ok) return 1;
+  return err == ENOENT ? 127 : 126;
+}
+
+static pid_t fork_node(executor_t *ex, ast_ref_t ref, exec_io_t io) {
+  fflush(NULL);
+  pid_t pid = fork();
+  if (pid < 0) {
+    fprintf(stderr, "tiny: fork: %s\n", strerror(errno));
+    return -1;
+  }
+  if (pid > 0) {
+    // Set on both sides so the group exists whichever runs first.
+    if (io.group) setpgid(pid, pid);
+    ex->forks++;
+    return pid;
+  }
+
+  sigset_t none;
+  sigemptyset(&none);
+  if (io.group) setpgid(0, 0);
+  sigprocmask(SIG_SETMASK, &none, NULL);
+  jobs_detach(&ex->jobs);
+  ex->job_control = false;
+  ex->exit_after  = true;
+
+  if (io.in >= 0) dup2(io.in, 0);
+  if (io.out >= 0) dup2(io.out, 1);
+  if (io.in >= 0) close(io.in);
+  if (io.out >= 0) close(io.out);
+  if (io.spare >= 0) close(io.spare);
+
+  // Writing into a pipe, builtins fill a buffer the size of the pipe and
+  // leave it to stdio, so a stream of echo/printf costs one write per
+  // pipeful rather than one per command.
+  if (io.out >= 0) {
+    int size = fcntl(1, F_GETPIPE_SZ);
+    setvbuf(stdout, NULL, _IOFBF, size > BUFSIZ ? size : BUFSIZ);
+    ex->batch_output = true;
+  }
+
+  int status = exec_node(ex, ref);
+  fflush(NULL);
+  _exit(status);
+}
+
+// Redirections with their targets and here-document bodies expanded, copied
+// into the arena only when some of them need it. Returns false after
+// reporting an error.
+static bool expand_redirs(executor_t *ex, ast_range_t range,
+                          const ast_redir_t **out) {
+  const ast_redir_t *redirs = ast_redirs(ex->ast, range);
+  uint32_t           count  = range.count;
+
+  uint32_t plain = 0;
+  while (plain < count && redirs[plain].target.parts.count == 0 &&
+         redirs[plain].body.parts.count == 0) {
+    plain++;
+  }
+  *out = redirs;
+  if (plain == count) return true;
+
+  ast_redir_t *copy = arena_alloc(ex->arena, count * sizeof *copy);
+  if (!copy) {
+    fprintf(stderr, "tiny: out of memory\n");
+    return false;
+  }
+  memcpy(copy, redirs, count * sizeof *copy);
+  for (uint32_t i = plain; i < count; i++) {
+    // A here-document's delimiter is never expanded; its body may be.
+    bool here = copy[i].type == REDIR_HERE_DOC ||
+                copy[i].type == REDIR_HERE_STRIP;
+    if (!here && !(copy[i].target.text = expand_word(ex, &copy[i].target))) {
+      return false;
+    }
+    if (copy[i].body.text &&
+        !(copy[i].body.text = expand_word(ex, &copy[i].body))) {
+      return false;
+    }
+  }
+  *out = copy;
+  return true;
+}
+
+// The shell's cached environment; prefix assignments (`FOO=1 cmd`) are laid
+// over it for this command only and must be dropped with vars_drop_overlay
+// once it has started. `*path` is set to the value of a `PATH=` among them,
+// else NULL. Reports its own errors.
+static char **build_envp(executor_t *ex, const ast_node_t *node,
+                         const char **path) {
+  uint32_t count = node->u.simple.assigns.count;
+  *path          = NULL;
+  if (count == 0) {
+    char **envp = vars_environ(&ex->vars);
+    if (!envp) fprintf(stderr, "tiny: out of memory\n");
+    return envp;
+  }
+
+  ast_assignment_t *assigns = ast_assigns(ex->ast, node->u.simple.assigns);
+  char            **entries = arena_alloc(ex->arena, count * sizeof(char *));
+  if (!entries) {
+    fprintf(stderr, "tiny: out of memory\n");
+    return NULL;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    const var_t *var = vars_find(&ex->vars, assigns[i].name);
+    if (var && (var->flags & VAR_READONLY)) {
+      fprintf(stderr, "tiny: %s: readonly variable\n", assigns[i].name);
+      return NULL;
+    }
+
+    const char *value = expand_word(ex, &assigns[i].value);
+    if (!value) return NULL;
+    if (strcmp(assigns[i].name, "PATH") == 0) *path = value;
+
+    size_t name_len  = strlen(assigns[i].name);
+    size_t value_len = strlen(value);
+    char  *entry     = arena_alloc(ex->arena, name_len + value_len + 2);
+    if (!entry) {
+      fprintf(stderr, "tiny: out of memory\n");
+      return NULL;
+    }
+    memcpy(entry, assigns[i].name, name_len);
+    entry[name_len] = '=';
+    memcpy(entry + name_len + 1, value, value_len + 1);
+    entries[i] = entry;
+  }
+
+  char **envp = vars_overlay(&ex->vars, entries, count, ex->arena);
+  if (!envp) fprintf(stderr, "tiny: out of memory\n");
+  return envp;
+}
+
+static int wait_pid(pid_t pid) {
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) return 127;
+  }
+  if (WIFEXITED(status)) return WEXITSTATUS(status);
+  if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+  return 1;
+}
+
+// Grows a pipe to `set -o pipe-size`, clamped to what an unprivileged process
+// may ask for. Larger pipes mean fewer wakeups for stages moving bulk data.
+static void resize_pipe(executor_t *ex, int fd) {
+  if (ex->pipe_max == 0) {
+    FILE *f = fopen("/proc/sys/fs/pipe-max-size", "r");
+    if (!f || fscanf(f, "%u", &ex->pipe_max) != 1) ex->pipe_max = 1 << 20;
+    if (f) fclose(f);
+  }
+  unsigned size = ex->pipe_size < ex->pipe_max ? ex->pipe_size : ex->pipe_max;
+  fcntl(fd, F_SETPIPE_SZ, (int)size); // best effort; the default still works
+}
+
+static void start_job(executor_t *ex, ast_ref_t ref, pid_t pid) {
+  ex->last_bg = pid;
+
+  char  *text = NULL;
+  size_t size;
+  FILE  *out = open_memstream(&text, &size);
+  if (out) {
+    describe(out, ex->ast, ref);
+    fclose(out);
+  }
+  if (!text) return;
+
+  job_t *job = jobs_add(&ex->jobs, pid, text);
+  if (!job) {
+    free(text);
+    return;
+  }
+  if (ex->job_control) fprintf(stderr, "[%d] %d\n", job->id, (int)pid);
+}
+
+// Renders a command back to shell syntax for `jobs`.
+static void describe(FILE *out, const ast_t *ast, ast_ref_t ref) {
+  if (ref == AST_NULL) return;
+
+  const ast_node_t *node = ast_node(ast, ref);
+  switch (node->type) {
+    case AST_SIMPLE: {
+      const char *sep = "";
+      ast_assignment_t *assigns = ast_assigns(ast, node->u.simple.assigns);
+      for (uint32_t i = 0; i < node->u.simple.assigns.count; i++, sep = " ") {
+        fprintf(out, "%s%s=%s", sep, assigns[i].name, assigns[i].value.text);
+      }
+      describe_words(out, ast, node->u.simple.args, sep, " ");
+      describe_redirs(out, ast, node->u.simple.redirs, " ");
+      break;
+    }
+    case AST_PIPELINE: {
+      const ast_ref_t *stages = ast_stages(ast, node->u.pipeline.stages);
+      for (uint32_t i = 0; i < node->u.pipeline.stages.count; i++) {
+        if (i) fputs(" | ", out);
+        describe(out, ast, stages[i]);
+      }
+      break;
+    }
+    case AST_SEQUENCE:
+    case AST_AND:
+    case AST_OR:
+      describe(out, ast, node->u.binary.left);
+      fputs(node->type == AST_SEQUENCE ? "; "
+            : node->type == AST_AND    ? " && "
+                                       : " || ",
+            out);
+      describe(out, ast, node->u.binary.right);
+      break;
+    case AST_BACKGROUND:
+      describe(out, ast, node->u.background.child);
+      fputs(" &", out);
+      break;
+    case AST_SUBSHELL:
+      fputc('(', out);
+      describe(out, ast, node->u.subshell.child);
+      fputc(')', out);
+      break;
+    case AST_NOT:
+      fputs("! ", out);
+      describe(out, ast, node->u.negation.child);
+      break;
+    case AST_IF: {
+      // An else part that is a bare AST_IF was written as elif.
+      const ast_node_t *clause = node;
+      fputs("if ", out);
+      for (;;) {
+        describe(out, ast, clause->u.if_clause.cond);
+        fputs("; then ", out);
+        describe(out, ast, clause->u.if_clause.then_part);
+        ast_ref_t rest = clause->u.if_clause.else_part;
+        if (rest == AST_NULL) break;
+        clause = ast_node(ast, rest);
+        if (clause->type != AST_IF || clause->u.compound.redirs.count) {
+          fputs("; else ", out);
+          describe(out, ast, rest);
+          break;
+        }
+        fputs("; elif ", out);
+      }
+      fputs("; fi", out);
+      break;
+    }
+    case AST_WHILE:
+    case AST_UNTIL:
+      fputs(node->type == AST_WHILE ? "while " : "until ", out);
+      describe(out, ast, node->u.loop.cond);
+      fputs("; do ", out);
+      describe(out, ast, node->u.loop.body);
+      fputs("; done", out);
+      break;
+    case AST_FOR: {
+      ast_range_t words = node->u.for_clause.words;
+      fprintf(out, "for %s in", ast_args(ast, words)[0].text);
+      describe_words(out, ast, (ast_range_t){words.start + 1, words.count - 1},
+                     " ", " ");
+      fputs("; do ", out);
+      describe(out, ast, node->u.for_clause.body);
+      fputs("; done", out);
+      break;
+    }
+    case AST_CASE: {
+      fprintf(out, "case %s in",
+              ast->args.items[node->u.case_clause.subject].text);
+      ast_case_item_t *items = ast_items(ast, node->u.case_clause.items);
+      for (uint32_t i = 0; i < node->u.case_clause.items.count; i++) {
+        describe_words(out, ast, items[i].patterns, " ", "|");
+        fputs(") ", out);
+        describe(out, ast, items[i].body);
+        fputs(";;", out);
+      }
+      fputs(" esac", out);
+      break;
+    }
+  }
+  if (ast_is_compound(node->type)) {
+    describe_redirs(out, ast, node->u.compound.redirs, " ");
+  }
+}
+
+// The words with `lead` before the first and `sep` before the others.
+static void describe_words(FILE *out, const ast_t *ast, ast_range_t range,
+                           const char *lead, const char *sep) {
+  ast_word_t *words = ast_args(ast, range);
+  for (uint32_t i = 0; i < range.count; i++) {
+    fprintf(out, "%s%s", i ? sep : lead, words[i].text);
+  }
+}
+
+static void describe_redirs(FILE *out, const ast_t *ast, ast_range_t range,
+                            const char *sep) {
+  ast_redir_t *redirs = ast_redirs(ast, range);
+  for (uint32_t i = 0; i < range.count; i++) {
+    fprintf(out, "%s%d%s%s", sep, redirs[i].fd, ast_redir_op(redirs[i].type),
+            redirs[i].target.text);
+  }
+}
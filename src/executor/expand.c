@@ -0,0 +1,727 @@
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <inttypes.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "collections/vector.h"
+#include "executor/arith.h"
+#include "executor/elide.h"
+#include "executor/executor.h"
+#include "executor/expand.h"
+#include "executor/glob.h"
+#include "interpreter/parser.h"
+#include "interpreter/scanner.h"
+
+#define EXPAND_MIN_BUFFER 256   // first size of the buffer, past `small`
+#define EXPAND_READ       65536 // least room for each read of $(...) output
+
+// An expansion in progress. Every field is built in place at the end of
+// `buf` and NUL-terminated there; `fields` holds their offsets, since `buf`
+// may move as it grows. Intermediate strings (a pattern, a copy of a value
+// to trim, the output of a command) are put past the end of the output and
+// dropped again, so the result takes one buffer however it was produced.
+typedef struct {
+  executor_t   *ex;
+  vector_t      buf;     // char
+  vector_t      fields;  // size_t
+  size_t        start;   // offset of the field being built
+  bool          open;    // that field exists, though it may still be empty
+  bool          spaced;  // IFS white space ended the last field
+  bool          split;   // unquoted expansions are split into fields
+  bool          pattern; // quoted text is escaped for fnmatch
+  bool          glob;    // the word may need pathname expansion
+  vector_t      quoted;  // span_t: quoted output of that word, kept for it
+  glob_cache_t *globs;   // directories listed for this command, or NULL
+} expand_t;
+
+// Bytes [start, end) of `buf` came from quoted text.
+typedef struct {
+  size_t start;
+  size_t end;
+} span_t;
+
+static bool        expand_begin(expand_t *e, executor_t *ex, bool split);
+static bool        expand_parts(expand_t *e, ast_range_t range);
+static bool        expand_part(expand_t *e, const ast_part_t *part);
+static bool        expand_param(expand_t *e, const ast_part_t *part);
+static const char *param_value(expand_t *e, const char *name, char *num,
+                               size_t size);
+static const char *assign(expand_t *e, const ast_part_t *part);
+static bool        report(expand_t *e, const ast_part_t *part);
+static bool        trim(expand_t *e, const ast_part_t *part, const char *value);
+static bool        prefix_matches(const char *pattern, char *s, size_t n);
+static bool        command_output(expand_t *e, const ast_part_t *part);
+static bool        capture(expand_t *e, const ast_t *ast, ast_ref_t root);
+static ssize_t     capture_write(void *cookie, const char *s, size_t n);
+static bool        read_child(expand_t *e, const ast_t *ast, ast_ref_t root);
+static bool        arith(expand_t *e, const ast_part_t *part);
+static bool        tilde(expand_t *e, const ast_part_t *part);
+static size_t      scratch(expand_t *e, ast_range_t word, bool pattern);
+static bool        reserve(expand_t *e, size_t extra);
+static bool        put(expand_t *e, const char *s, size_t n);
+static bool        put_literal(expand_t *e, const char *s, size_t n);
+static bool        put_value(expand_t *e, const char *s, size_t n, bool quoted);
+static bool        put_result(expand_t *e, size_t at, size_t from, size_t n,
+                              bool quoted);
+static bool        put_split(expand_t *e, const char *s, size_t n);
+static bool        may_glob(const executor_t *ex, const ast_word_t *word);
+static bool        glob_fields(expand_t *e, size_t first);
+static char       *glob_pattern(expand_t *e, size_t at, size_t *span);
+static bool        end_field(expand_t *e);
+static char       *buf_at(expand_t *e, size_t offset);
+static bool        out_of_memory(void);
+
+// Classifies each byte of $IFS when it is assigned, so splitting costs one
+// table lookup per byte. Unset, IFS acts as space, tab and newline.
+void expand_set_ifs(executor_t *ex, const char *ifs) {
+  memset(ex->ifs, 0, sizeof ex->ifs);
+  if (!ifs) ifs = " \t\n";
+  for (const unsigned char *p = (const unsigned char *)ifs; *p; p++) {
+    ex->ifs[*p] = strchr(" \t\n", *p) ? IFS_SPACE : IFS_DELIM;
+  }
+}
+
+// Expands a command's words into `*argv`, NULL-terminated, in ex->arena. When
+// no word has parts, which is most commands, argv points at the words' own
+// text and nothing is copied. Returns false after reporting an error.
+bool expand_words(executor_t *ex, const ast_word_t *words, uint32_t count,
+                  char ***argv, int *argc) {
+  uint32_t plain = 0;
+  while (plain < count && words[plain].parts.count == 0 &&
+         !strpbrk(words[plain].text, "*?[")) {
+    plain++;
+  }
+  if (plain == count) {
+    char **out = arena_alloc(ex->arena, (count + 1) * sizeof(char *));
+    if (!out) return out_of_memory();
+    for (uint32_t i = 0; i < count; i++) out[i] = words[i].text;
+    out[count] = NULL;
+    *argv      = out;
+    *argc      = (int)count;
+    return true;
+  }
+
+  expand_t e;
+  if (!expand_begin(&e, ex, true)) return false;
+  for (uint32_t i = 0; i < count; i++) {
+    size_t first    = e.fields.length;
+    e.start         = e.buf.length;
+    e.open          = false;
+    e.spaced        = false;
+    e.glob          = may_glob(ex, &words[i]);
+    e.quoted.length = 0;
+    if (words[i].parts.count == 0) {
+      if (!put_literal(&e, words[i].text, strlen(words[i].text))) return false;
+    } else if (!expand_parts(&e, words[i].parts)) {
+      return false;
+    }
+    if (e.open && !end_field(&e)) return false;
+    if (e.glob && !glob_fields(&e, first)) return false;
+  }
+
+  size_t n   = e.fields.length;
+  char **out = arena_alloc(ex->arena, (n + 1) * sizeof(char *));
+  if (!out) return out_of_memory();
+  for (size_t i = 0; i < n; i++) {
+    out[i] = buf_at(&e, VECTOR_AT(&e.fields, size_t, i));
+  }
+  out[n] = NULL;
+  *argv  = out;
+  *argc  = (int)n;
+  return true;
+}
+
+// One word to one string, without field splitting: assignment values,
+// redirection targets and here-document bodies. NULL after reporting an
+// error.
+char *expand_word(executor_t *ex, const ast_word_t *word) {
+  if (word->parts.count == 0) return word->text;
+
+  expand_t e;
+  if (!expand_begin(&e, ex, false) || !expand_parts(&e, word->parts) ||
+      !put(&e, "", 1)) {
+    return NULL;
+  }
+  return e.buf.data; // never `small`: see expand_begin
+}
+
+// A case pattern for fnmatch(3): expanded like expand_word, but with quoted
+// text escaped so that it matches only itself. NULL after reporting an
+// error.
+char *expand_pattern(executor_t *ex, const ast_word_t *word) {
+  if (word->parts.count == 0) return word->text;
+
+  expand_t e;
+  if (!expand_begin(&e, ex, false)) return NULL;
+  e.pattern = true;
+  if (!expand_parts(&e, word->parts) || !put(&e, "", 1)) return NULL;
+  return e.buf.data;
+}
+
+static bool expand_begin(expand_t *e, executor_t *ex, bool split) {
+  e->ex      = ex;
+  e->start   = 0;
+  e->open    = false;
+  e->spaced  = false;
+  e->split   = split;
+  e->pattern = false;
+  e->glob    = false;
+  e->globs   = NULL;
+  vector_init(&e->buf, 1, ex->arena);
+  vector_init(&e->fields, sizeof(size_t), ex->arena);
+  vector_init(&e->quoted, sizeof(span_t), ex->arena);
+  // Results must outlive `e`, so the buffer leaves `small` straight away.
+  return vector_reserve(&e->buf, EXPAND_MIN_BUFFER) || out_of_memory();
+}
+
+static bool expand_parts(expand_t *e, ast_range_t range) {
+  const ast_part_t *parts = ast_parts(e->ex->ast, range);
+  for (uint32_t i = 0; i < range.count; i++) {
+    if (!expand_part(e, &parts[i])) return false;
+  }
+  return true;
+}
+
+static bool expand_part(expand_t *e, const ast_part_t *part) {
+  switch ((ast_part_type_t)part->type) {
+    case PART_LITERAL: {
+      size_t n = strlen(part->text);
+      return part->quoted ? put_value(e, part->text, n, true)
+                          : put_literal(e, part->text, n);
+    }
+    case PART_PARAM: return expand_param(e, part);
+    case PART_COMMAND: return command_output(e, part);
+    case PART_ARITH: return arith(e, part);
+    case PART_TILDE: return tilde(e, part);
+  }
+  return true;
+}
+
+static bool expand_param(expand_t *e, const ast_part_t *part) {
+  char        num[24];
+  const char *value = param_value(e, part->text, num, sizeof num);
+  bool        set   = value && !(part->colon && !*value);
+
+  // "${x-}" and "$unset" still make a field, if an empty one.
+  if (part->quoted) {
+    e->open   = true;
+    e->spaced = false;
+  }
+
+  switch ((ast_param_op_t)part->op) {
+    case PARAM_VALUE: break;
+    case PARAM_LENGTH: {
+      int n = snprintf(num, sizeof num, "%zu", value ? strlen(value) : 0);
+      return put_value(e, num, n, part->quoted);
+    }
+    case PARAM_DEFAULT:
+      if (!set) return expand_parts(e, part->word);
+      break;
+    case PARAM_ALTERNATE: return set ? expand_parts(e, part->word) : true;
+    case PARAM_ASSIGN:
+      if (!set && !(value = assign(e, part))) return false;
+      break;
+    case PARAM_ERROR:
+      if (!set) return report(e, part);
+      break;
+    case PARAM_SUFFIX:
+    case PARAM_LONG_SUFFIX:
+    case PARAM_PREFIX:
+    case PARAM_LONG_PREFIX: return trim(e, part, value ? value : "");
+  }
+  if (!value) return true;
+  return put_value(e, value, strlen(value), part->quoted);
+}
+
+// Variables, and the special parameters the shell has. Positional parameters
+// do not exist yet, so they and $@ $* are unset.
+static const char *param_value(expand_t *e, const char *name, char *num,
+                               size_t size) {
+  executor_t *ex = e->ex;
+  switch (name[0]) {
+    case '?': snprintf(num, size, "%d", ex->status); return num;
+    case '$': snprintf(num, size, "%d", (int)ex->shell_pid); return num;
+    case '!':
+      if (!ex->last_bg) return NULL;
+      snprintf(num, size, "%d", (int)ex->last_bg);
+      return num;
+    case '#': return "0";
+    case '-': return "";
+    case '0': return "tiny";
+    case '@':
+    case '*': return NULL;
+  }
+  if (isdigit((unsigned char)name[0])) return NULL;
+  return exec_getvar(ex, name);
+}
+
+// ${x=word}: the expanded word becomes the variable's value, and the value.
+static const char *assign(expand_t *e, const ast_part_t *part) {
+  if (!isalpha((unsigned char)part->text[0]) && part->text[0] != '_') {
+    fprintf(stderr, "tiny: %s: cannot assign in this way\n", part->text);
+    return NULL;
+  }
+  size_t at = scratch(e, part->word, false);
+  if (at == SIZE_MAX) return NULL;
+  int status    = exec_setvar(e->ex, part->text, buf_at(e, at));
+  e->buf.length = at;
+  return status == 0 ? exec_getvar(e->ex, part->text) : NULL;
+}
+
+// ${x?word}: the command fails with the word as its message.
+static bool report(expand_t *e, const ast_part_t *part) {
+  size_t at = scratch(e, part->word, false);
+  if (at == SIZE_MAX) return false;
+  const char *message = buf_at(e, at);
+  fprintf(stderr, "tiny: %s: %s\n", part->text,
+          *message ? message : "parameter null or not set");
+  return false;
+}
+
+// ${x%pattern} and the like. The pattern is expanded and the value copied
+// after the output, so matching allocates nothing: a prefix is tried by
+// writing a NUL into the copy and putting the byte back.
+static bool trim(expand_t *e, const ast_part_t *part, const char *value) {
+  size_t at  = e->buf.length;
+  size_t pat = scratch(e, part->word, true);
+  if (pat == SIZE_MAX) return false;
+  size_t copy   = e->buf.length;
+  size_t length = strlen(value);
+  if (!put(e, value, length) || !put(e, "", 1)) return false;
+
+  const char *pattern = buf_at(e, pat);
+  char       *v       = buf_at(e, copy);
+  size_t      from = 0, to = length;
+  switch (part->op) {
+    case PARAM_SUFFIX: // shortest first: start from the empty suffix
+      for (size_t i = length + 1; i-- > 0;) {
+        if (fnmatch(pattern, v + i, 0) == 0) {
+          to = i;
+          break;
+        }
+      }
+      break;
+    case PARAM_LONG_SUFFIX:
+      for (size_t i = 0; i <= length; i++) {
+        if (fnmatch(pattern, v + i, 0) == 0) {
+          to = i;
+          break;
+        }
+      }
+      break;
+    case PARAM_PREFIX:
+      for (size_t i = 0; i <= length; i++) {
+        if (prefix_matches(pattern, v, i)) {
+          from = i;
+          break;
+        }
+      }
+      break;
+    case PARAM_LONG_PREFIX:
+      for (size_t i = length + 1; i-- > 0;) {
+        if (prefix_matches(pattern, v, i)) {
+          from = i;
+          break;
+        }
+      }
+      break;
+  }
+  return put_result(e, at, copy + from, to - from, part->quoted);
+}
+
+static bool prefix_matches(const char *pattern, char *s, size_t n) {
+  char saved = s[n];
+  s[n]       = '\0';
+  bool match = fnmatch(pattern, s, 0) == 0;
+  s[n]       = saved;
+  return match;
+}
+
+// $(...). The body is parsed here; when every command in it is a pure
+// builtin it runs in the shell itself with stdout writing to the end of the
+// buffer, and otherwise it is started with stdout on a pipe that is read
+// straight into the buffer. Either way the trailing newlines are then
+// dropped by shortening the result, which is split in place.
+static bool command_output(expand_t *e, const ast_part_t *part) {
+  ast_t     ast;
+  scanner_t scanner;
+  parser_t  parser;
+  ast_init(&ast, e->ex->arena);
+  scanner_init(&scanner, part->text, strlen(part->text));
+  parser_init(&parser, &scanner, &ast);
+
+  ast_ref_t root = parser_parse(&parser);
+  if (root != AST_NULL) {
+    elide_mark(&ast, root);
+    arith_prepare(&ast);
+  }
+
+  size_t at = e->buf.length;
+  bool   ok = !parser.had_error; // already reported
+  if (!ok) {
+    e->ex->status = 2;
+  } else if (root == AST_NULL) {
+    e->ex->status = 0;
+  } else if (elide_pure(&ast, root)) {
+    ok = capture(e, &ast, root);
+  } else {
+    ok = read_child(e, &ast, root);
+  }
+  ast_free(&ast);
+  e->ex->substitutions++;
+  if (!ok) return false;
+
+  size_t n = e->buf.length - at;
+  while (n > 0 && *buf_at(e, at + n - 1) == '\n') n--;
+  return put_result(e, at, at, n, part->quoted);
+}
+
+// Runs a pure body in the shell with stdout swapped for a stream that
+// appends to the buffer. The builtins flush once, when it is closed.
+static bool capture(expand_t *e, const ast_t *ast, ast_ref_t root) {
+  static const cookie_io_functions_t io = {.write = capture_write};
+
+  FILE *out = fopencookie(e, "w", io);
+  if (!out) return out_of_memory();
+
+  FILE *saved = stdout;
+  bool  batch = e->ex->batch_output;
+
+  stdout              = out;
+  e->ex->batch_output = true;
+  e->ex->status       = exec_inline(e->ex, ast, root);
+  stdout              = saved;
+  e->ex->batch_output = batch;
+  return fclose(out) == 0; // a failed write has been reported
+}
+
+static ssize_t capture_write(void *cookie, const char *s, size_t n) {
+  expand_t *e = cookie;
+  if (!reserve(e, n)) return 0;
+  memcpy(buf_at(e, e->buf.length), s, n);
+  e->buf.length += n;
+  return (ssize_t)n;
+}
+
+// Any other body runs in a child. Reads are as large as the room left in
+// the buffer, which grows geometrically, so a full pipe drains in one call.
+static bool read_child(expand_t *e, const ast_t *ast, ast_ref_t root) {
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) < 0) {
+    fprintf(stderr, "tiny: pipe: %s\n", strerror(errno));
+    return false;
+  }
+  e->ex->status = 1; // unless the child starts
+  pid_t pid     = exec_start(e->ex, ast, root, fds[1], fds[0]);
+  close(fds[1]);
+  e->globs = NULL; // the command may change what directories hold
+
+  bool ok = true;
+  while (pid > 0) {
+    if (!reserve(e, EXPAND_READ)) {
+      ok = false;
+      break;
+    }
+    ssize_t n = read(fds[0], buf_at(e, e->buf.length),
+                     e->buf.capacity - e->buf.length);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    e->buf.length += n;
+  }
+  close(fds[0]);
+  if (pid < 0) return true; // reported; the output is empty
+
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  e->ex->status = WIFEXITED(status)     ? WEXITSTATUS(status)
+                  : WIFSIGNALED(status) ? 128 + WTERMSIG(status)
+                                        : 1;
+  return ok;
+}
+
+// An expression with a fixed text was compiled by arith_prepare; the rest
+// are expanded first and compiled on the spot.
+static bool arith(expand_t *e, const ast_part_t *part) {
+  int64_t value;
+  if (part->code) {
+    if (!arith_run(e->ex, part->code, &value)) return false;
+  } else {
+    size_t at = scratch(e, part->word, false);
+    if (at == SIZE_MAX) return false;
+    bool ok       = arith_eval(e->ex, buf_at(e, at), &value);
+    e->buf.length = at;
+    if (!ok) return false;
+  }
+
+  char num[24];
+  int  n = snprintf(num, sizeof num, "%" PRId64, value);
+  return put_value(e, num, n, part->quoted);
+}
+
+// ~ is $HOME and ~user that user's home directory; an unknown user leaves
+// the word as written.
+static bool tilde(expand_t *e, const ast_part_t *part) {
+  const char *home = NULL;
+  if (!part->text[0]) {
+    home = exec_getvar(e->ex, "HOME");
+  } else {
+    struct passwd *pw = getpwnam(part->text);
+    if (pw) home = pw->pw_dir;
+  }
+  if (!home) {
+    return put_literal(e, "~", 1) &&
+           put_literal(e, part->text, strlen(part->text));
+  }
+  return put_value(e, home, strlen(home), true);
+}
+
+// Expands a nested word past the end of the output as one NUL-terminated
+// string and returns its offset, or SIZE_MAX. The caller truncates `buf`
+// back to it once done.
+static size_t scratch(expand_t *e, ast_range_t word, bool pattern) {
+  bool split = e->split, escape = e->pattern, open = e->open;
+  bool spaced = e->spaced, glob = e->glob;
+
+  size_t at  = e->buf.length;
+  e->split   = false;
+  e->pattern = pattern;
+  e->glob    = false;
+  bool ok    = expand_parts(e, word) && put(e, "", 1);
+
+  e->split   = split;
+  e->pattern = escape;
+  e->glob    = glob;
+  e->open    = open;
+  e->spaced  = spaced;
+  return ok ? at : SIZE_MAX;
+}
+
+// Room for `extra` more bytes, doubling so that a run of small appends
+// stays linear.
+static bool reserve(expand_t *e, size_t extra) {
+  size_t need = e->buf.length + extra;
+  if (need <= e->buf.capacity) return true;
+  size_t capacity = e->buf.capacity * 2;
+  if (capacity < need) capacity = need;
+  return vector_reserve(&e->buf, capacity) || out_of_memory();
+}
+
+// `s` may lie inside `buf` past the output, when a result computed there is
+// moved into place. The room it needs is then already reserved, so `buf`
+// cannot move under it.
+static bool put(expand_t *e, const char *s, size_t n) {
+  if (!reserve(e, n)) return false;
+  memmove(buf_at(e, e->buf.length), s, n);
+  e->buf.length += n;
+  return true;
+}
+
+// Text from the word itself, never split.
+static bool put_literal(expand_t *e, const char *s, size_t n) {
+  if (n == 0) return true;
+  e->open   = true;
+  e->spaced = false;
+  return put(e, s, n);
+}
+
+// The result of an expansion: split unless quoted, and escaped when it is
+// quoted part of a pattern.
+static bool put_value(expand_t *e, const char *s, size_t n, bool quoted) {
+  if (!quoted) return e->split ? put_split(e, s, n) : put_literal(e, s, n);
+
+  e->open   = true;
+  e->spaced = false;
+  if (e->glob && n) {
+    span_t *last = e->quoted.length
+                       ? &VECTOR_AT(&e->quoted, span_t, e->quoted.length - 1)
+                       : NULL;
+    size_t  at   = e->buf.length;
+    if (last && last->end == at) {
+      last->end = at + n;
+    } else if (!VECTOR_PUSH(&e->quoted, span_t, ((span_t){at, at + n}))) {
+      return out_of_memory();
+    }
+  }
+  if (!e->pattern) return put(e, s, n);
+  for (size_t i = 0; i < n; i++) {
+    if (s[i] && strchr("*?[\\", s[i]) && !put(e, "\\", 1)) return false;
+    if (!put(e, s + i, 1)) return false;
+  }
+  return true;
+}
+
+// Moves a result computed at `from` down to `at`, the end of the output.
+static bool put_result(expand_t *e, size_t at, size_t from, size_t n,
+                       bool quoted) {
+  e->buf.length = at;
+  const char *s = buf_at(e, from);
+  if (e->pattern && quoted) { // escaping lengthens it: work from a copy
+    s = arena_strndup(e->ex->arena, s, n);
+    if (!s) return out_of_memory();
+  }
+  return put_value(e, s, n, quoted);
+}
+
+// Field splitting. IFS white space at either end is dropped and a run of it
+// separates fields; any other IFS byte ends a field, even an empty one, and
+// takes the white space next to it along. A field never comes out longer
+// than its text, so splitting a result in place only writes behind what it
+// reads.
+static bool put_split(expand_t *e, const char *s, size_t n) {
+  const unsigned char *ifs = e->ex->ifs;
+  size_t               run = 0;
+  for (size_t i = 0; i < n; i++) {
+    unsigned cls = ifs[(unsigned char)s[i]];
+    if (!cls) continue;
+    if (i > run && !put_literal(e, s + run, i - run)) return false;
+    run = i + 1;
+
+    if (cls & IFS_SPACE) {
+      if (!e->open) continue;
+      if (!end_field(e)) return false;
+      e->spaced = true;
+    } else {
+      if ((e->open || !e->spaced) && !end_field(e)) return false;
+      e->spaced = false;
+    }
+  }
+  return put_literal(e, s + run, n - run);
+}
+
+// Whether pathname expansion may apply to a word: it has an unquoted `*`, `?`
+// or `[`, or an unquoted expansion whose value may hold one. Only such words
+// pay for remembering which of their bytes were quoted.
+static bool may_glob(const executor_t *ex, const ast_word_t *word) {
+  if (word->parts.count == 0) return strpbrk(word->text, "*?[") != NULL;
+  const ast_part_t *parts = ast_parts(ex->ast, word->parts);
+  for (uint32_t i = 0; i < word->parts.count; i++) {
+    if (parts[i].quoted) continue;
+    switch ((ast_part_type_t)parts[i].type) {
+      case PART_LITERAL:
+        if (strpbrk(parts[i].text, "*?[")) return true;
+        break;
+      case PART_PARAM:
+      case PART_COMMAND: return true;
+      case PART_ARITH:
+      case PART_TILDE: break;
+    }
+  }
+  return false;
+}
+
+// Pathname expansion of the fields a word produced, from `first` on. Each
+// field with an unquoted wildcard is replaced by the paths it matches, or
+// kept as it is when there are none. Fields from the first such one onward
+// are copied aside and put back, with the matches in their place.
+static bool glob_fields(expand_t *e, size_t first) {
+  size_t  n        = e->fields.length;
+  size_t  span     = 0;
+  char  **patterns = arena_alloc(e->ex->arena, (n - first) * sizeof(char *));
+  if (n > first && !patterns) return out_of_memory();
+
+  size_t magic = n;
+  for (size_t f = first; f < n; f++) {
+    size_t at           = VECTOR_AT(&e->fields, size_t, f);
+    patterns[f - first] = glob_pattern(e, at, &span);
+    if (patterns[f - first] && magic == n) magic = f;
+  }
+  if (magic == n) return true;
+
+  size_t base   = VECTOR_AT(&e->fields, size_t, magic);
+  size_t length = e->buf.length - base;
+  char  *copy   = arena_alloc(e->ex->arena, length);
+  if (!copy) return out_of_memory();
+  memcpy(copy, buf_at(e, base), length);
+
+  vector_t matches;
+  vector_init(&matches, sizeof(char *), e->ex->arena);
+  if (!e->globs) {
+    const char *locale = exec_getvar(e->ex, "LC_ALL");
+    if (!locale || !*locale) locale = exec_getvar(e->ex, "LC_COLLATE");
+    if (!locale || !*locale) locale = exec_getvar(e->ex, "LANG");
+    e->globs = arena_alloc(e->ex->arena, sizeof *e->globs);
+    if (!e->globs) return out_of_memory();
+    glob_cache_init(e->globs, e->ex->arena, locale);
+  }
+
+  e->buf.length    = base;
+  e->fields.length = magic;
+  e->start         = base;
+  const char *text = copy;
+  for (size_t f = magic; f < n; f++, text += strlen(text) + 1) {
+    const char *pattern = patterns[f - first];
+
+    matches.length = 0;
+    long found     = pattern ? glob_expand(e->globs, pattern, &matches) : 0;
+    if (found < 0) return out_of_memory();
+    for (long i = 0; i < found; i++) {
+      const char *match = VECTOR_AT(&matches, char *, i);
+      if (!put(e, match, strlen(match)) || !end_field(e)) return false;
+    }
+    if (found == 0 && (!put(e, text, strlen(text)) || !end_field(e))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The pattern for the field at `at`, with its quoted bytes escaped, or NULL
+// when it has no unquoted wildcard and is used as it is. `*span` walks the
+// quoted spans along with the fields.
+static char *glob_pattern(expand_t *e, size_t at, size_t *span) {
+  const span_t *spans = vector_data(&e->quoted);
+  size_t        count = e->quoted.length;
+  const char   *field = buf_at(e, at);
+  size_t        n     = strlen(field);
+
+  size_t s     = *span;
+  bool   magic = false;
+  for (size_t i = 0; i < n && !magic; i++) {
+    while (s < count && spans[s].end <= at + i) s++;
+    bool quoted = s < count && spans[s].start <= at + i;
+    magic       = !quoted && strchr("*?[", field[i]);
+  }
+  if (!magic) {
+    while (*span < count && spans[*span].end <= at + n) (*span)++;
+    return NULL;
+  }
+
+  char *pattern = arena_alloc(e->ex->arena, 2 * n + 1);
+  if (!pattern) return NULL;
+  char *out = pattern;
+  for (size_t i = 0; i < n; i++) {
+    while (*span < count && spans[*span].end <= at + i) (*span)++;
+    bool quoted = *span < count && spans[*span].start <= at + i;
+    if (quoted && strchr("*?[]\\!-^", field[i])) *out++ = '\\';
+    *out++ = field[i];
+  }
+  *out = '\0';
+  return pattern;
+}
+
+static bool end_field(expand_t *e) {
+  if (!put(e, "", 1)) return false;
+  if (!VECTOR_PUSH(&e->fields, size_t, e->start)) return out_of_memory();
+  e->start = e->buf.length;
+  e->open  = false;
+  return true;
+}
+
+static char *buf_at(expand_t *e, size_t offset) {
+  return (char *)vector_data(&e->buf) + offset;
+}
+
+static bool out_of_memory(void) {
+  fprintf(stderr, "tiny: out of memory\n");
+  return false;
+}
@@ -0,0 +1,528 @@
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "executor/glob.h"
+
+#define GLOB_BATCH    (256u << 10) // arena block that getdents64 fills
+#define GLOB_MIN_ROOM (16u << 10)  // least room left to read into a block
+
+// Pathname expansion. A pattern is split at its slashes and each component
+// compiled once into a matcher; the walk then lists only the directories a
+// component with wildcards has to search, goes straight through literal
+// ones, and drops a name as soon as its component fails to match. In a
+// pattern, `\` makes the next byte literal: expand.c escapes quoted text.
+
+// The kernel's struct linux_dirent64; glibc only wraps the call from 2.30.
+typedef struct {
+  uint64_t       d_ino;
+  int64_t        d_off;
+  unsigned short d_reclen;
+  unsigned char  d_type;
+  char           d_name[];
+} dirent64_t;
+
+typedef enum { OP_BYTE, OP_ANY, OP_STAR, OP_SET } op_type_t;
+
+typedef struct {
+  uint8_t  type; // op_type_t
+  uint8_t  byte; // OP_BYTE
+  uint16_t set;  // OP_SET: index into matcher_t.sets
+} op_t;
+
+// One compiled component. A name needs at least `min` bytes, exactly that
+// many without a star, and must begin with `head` and end with `tail`, the
+// literal bytes before the first star and after the last: for `*.c` that
+// settles every name without running the ops.
+typedef struct {
+  op_t    *ops;
+  uint8_t *sets;  // 32 bytes for each OP_SET, a bit per byte value
+  char    *bytes; // the OP_BYTE bytes of the head, then of the tail
+  uint32_t count;
+  uint32_t min;
+  uint32_t head;  // leading OP_BYTE ops
+  uint32_t tail;  // trailing OP_BYTE ops after the last star
+  bool     star;
+  bool     dot;   // starts with a literal '.', so hidden names may match
+} matcher_t;
+
+typedef struct {
+  matcher_t   match;
+  const char *sep; // the slashes after the component, empty for the last
+  size_t      sep_len;
+} component_t;
+
+// A name with its first 8 bytes as a big-endian number, so that comparing
+// keys compares those bytes.
+typedef struct {
+  uint64_t key;
+  char    *name;
+} keyed_t;
+
+typedef struct {
+  glob_cache_t *cache;
+  component_t  *parts;
+  size_t        count;
+  vector_t      path; // char: the path matched so far
+  vector_t     *out;  // char *
+} walk_t;
+
+static bool        compile(arena_t *arena, const char *p, size_t n,
+                           matcher_t *m);
+static const char *parse_set(const char *p, const char *end, uint8_t *set);
+static bool        add_class(const char *name, size_t n, uint8_t *set);
+static bool        matches(const matcher_t *m, const char *s, size_t n);
+static bool        step(const matcher_t *m, const op_t *op, unsigned char c);
+static bool        walk(walk_t *w, size_t i);
+static bool        listing(glob_cache_t *cache, const char *path, size_t n,
+                           glob_dir_t *dir);
+static bool        is_dir(walk_t *w, uint8_t type);
+static bool        exists(walk_t *w, bool dir);
+static const char *path_cstr(walk_t *w);
+static bool        append(walk_t *w, const char *s, size_t n);
+static bool        sort_bytes(arena_t *arena, char **names, size_t n);
+static int         compare_keyed(const void *a, const void *b);
+static int         compare_locale(const void *a, const void *b);
+
+// `locale` is the shell's LC_COLLATE as the environment sets it (LC_ALL,
+// LC_COLLATE, then LANG). The C locale sorts by byte with strcmp; any other
+// is loaded for strcoll the first time it is asked for.
+void glob_cache_init(glob_cache_t *cache, arena_t *arena, const char *locale) {
+  *cache = (glob_cache_t){.arena = arena};
+  vector_init(&cache->dirs, sizeof(glob_dir_t), arena);
+
+  bool c = !locale || !*locale || strcmp(locale, "C") == 0 ||
+           strcmp(locale, "POSIX") == 0;
+  const char *now = setlocale(LC_COLLATE, NULL);
+  if (!c && (!now || strcmp(now, locale) != 0) &&
+      !setlocale(LC_COLLATE, locale)) {
+    c = true; // not installed: fall back to bytes
+  }
+  if (c && now && strcmp(now, "C") != 0) setlocale(LC_COLLATE, "C");
+  cache->strcoll = !c;
+}
+
+// Appends the paths matching `pattern` to `matches` (char *, in the arena),
+// sorted. Returns how many, or -1 when out of memory. Directories that cannot
+// be read hold no matches, as with glob(3)'s default.
+long glob_expand(glob_cache_t *cache, const char *pattern, vector_t *matches) {
+  walk_t w = {.cache = cache, .out = matches};
+  vector_init(&w.path, 1, cache->arena);
+
+  const char *p = pattern;
+  while (*p == '/') p++;
+  if (!append(&w, pattern, p - pattern)) return -1;
+
+  size_t count = 1;
+  for (const char *s = p; (s = strchr(s, '/'));) {
+    while (*s == '/') s++;
+    if (*s) count++;
+  }
+  w.parts = arena_alloc(cache->arena, count * sizeof *w.parts);
+  if (!w.parts) return -1;
+  for (size_t i = 0; i < count; i++) {
+    const char *end = strchrnul(p, '/');
+    const char *sep = end;
+    while (*sep == '/') sep++;
+    if (!compile(cache->arena, p, end - p, &w.parts[i].match)) return -1;
+    w.parts[i].sep     = end;
+    w.parts[i].sep_len = sep - end;
+    p                  = sep;
+  }
+  w.count = count;
+
+  size_t first = matches->length;
+  if (!walk(&w, 0)) return -1;
+
+  size_t found = matches->length - first;
+  char **names = (char **)vector_data(matches) + first;
+  if (found > 1 && cache->strcoll) {
+    qsort(names, found, sizeof(char *), compare_locale);
+  } else if (found > 1 && !sort_bytes(cache->arena, names, found)) {
+    return -1;
+  }
+  return (long)found;
+}
+
+static bool compile(arena_t *arena, const char *p, size_t n, matcher_t *m) {
+  size_t brackets = 0;
+  for (size_t i = 0; i < n; i++) brackets += p[i] == '[';
+
+  *m       = (matcher_t){0};
+  m->ops   = arena_alloc(arena, (n + 1) * sizeof *m->ops);
+  m->sets  = brackets ? arena_alloc(arena, brackets * 32) : NULL;
+  m->bytes = arena_alloc(arena, n + 1);
+  if (!m->ops || (brackets && !m->sets) || !m->bytes) return false;
+
+  const char *end  = p + n;
+  uint32_t    sets = 0;
+  while (p < end) {
+    op_t op = {.type = OP_BYTE, .byte = (uint8_t)*p};
+    if (*p == '*') {
+      op.type = OP_STAR;
+      while (p < end && *p == '*') p++;
+      m->star = true;
+    } else if (*p == '?') {
+      op.type = OP_ANY;
+      p++;
+    } else if (*p == '[') {
+      const char *q = parse_set(p, end, m->sets + 32 * sets);
+      if (q) {
+        op.type = OP_SET;
+        op.set  = sets++;
+      }
+      p = q ? q : p + 1;
+    } else if (*p == '\\' && p + 1 < end) {
+      op.byte = (uint8_t)p[1];
+      p += 2;
+    } else {
+      p++;
+    }
+    m->ops[m->count++] = op;
+  }
+
+  while (m->head < m->count && m->ops[m->head].type == OP_BYTE) {
+    m->bytes[m->head] = (char)m->ops[m->head].byte;
+    m->head++;
+  }
+  if (m->star) {
+    while (m->ops[m->count - 1 - m->tail].type == OP_BYTE) m->tail++;
+    for (uint32_t i = 0; i < m->tail; i++) {
+      m->bytes[m->head + i] = (char)m->ops[m->count - m->tail + i].byte;
+    }
+  }
+  for (uint32_t i = 0; i < m->count; i++) m->min += m->ops[i].type != OP_STAR;
+  m->dot = m->head > 0 && m->bytes[0] == '.';
+  return true;
+}
+
+// Reads the bracket expression at `p` into the 256-bit `set`. Returns the
+// byte after its `]`, or NULL when there is none and the `[` is literal.
+// Ranges are by byte value, which is what they mean in the C locale.
+static const char *parse_set(const char *p, const char *end, uint8_t *set) {
+  memset(set, 0, 32);
+  bool negate = ++p < end && (*p == '!' || *p == '^');
+  if (negate) p++;
+
+  for (bool first = true; p < end; first = false) {
+    if (*p == ']' && !first) {
+      if (negate) {
+        for (int i = 0; i < 32; i++) set[i] = ~set[i];
+      }
+      return p + 1;
+    }
+
+    unsigned lo;
+    if (*p == '[' && p + 1 < end && strchr(":=.", p[1])) {
+      // [:class:], or [=c=] and [.c.], which a byte locale reduces to c.
+      const char *q = p + 2;
+      while (q + 1 < end && !(q[0] == p[1] && q[1] == ']')) q++;
+      if (q + 1 >= end) return NULL;
+      if (p[1] == ':') {
+        if (!add_class(p + 2, q - p - 2, set)) return NULL;
+        p = q + 2;
+        continue;
+      }
+      if (q != p + 3) return NULL;
+      lo = (uint8_t)p[2];
+      p  = q + 2;
+    } else if (*p == '\\' && p + 1 < end) {
+      lo = (uint8_t)p[1];
+      p += 2;
+    } else {
+      lo = (uint8_t)*p++;
+    }
+
+    unsigned hi = lo;
+    if (p + 1 < end && *p == '-' && p[1] != ']') {
+      if (p[1] == '\\' && p + 2 < end) p++;
+      hi = (uint8_t)p[1];
+      p += 2;
+    }
+    for (unsigned c = lo; c <= hi; c++) set[c >> 3] |= 1u << (c & 7);
+  }
+  return NULL;
+}
+
+static bool add_class(const char *name, size_t n, uint8_t *set) {
+  static const struct {
+    const char *name;
+    int (*is)(int);
+  } CLASSES[] = {
+      {"alnum", isalnum}, {"alpha", isalpha}, {"blank", isblank},
+      {"cntrl", iscntrl}, {"digit", isdigit}, {"graph", isgraph},
+      {"lower", islower}, {"print", isprint}, {"punct", ispunct},
+      {"space", isspace}, {"upper", isupper}, {"xdigit", isxdigit},
+  };
+  for (size_t i = 0; i < sizeof CLASSES / sizeof *CLASSES; i++) {
+    if (strlen(CLASSES[i].name) != n || memcmp(CLASSES[i].name, name, n)) {
+      continue;
+    }
+    for (unsigned c = 0; c < 256; c++) {
+      if (CLASSES[i].is((int)c)) set[c >> 3] |= 1u << (c & 7);
+    }
+    return true;
+  }
+  return false;
+}
+
+// Stars backtrack to the latest one only: a later star can always absorb
+// what an earlier one would have had to, so the match stays linear in
+// practice and never recurses.
+static bool matches(const matcher_t *m, const char *s, size_t n) {
+  if (n < m->min || (!m->star && n != m->min)) return false;
+  if (s[0] == '.' && !m->dot) return false;
+  if (memcmp(s, m->bytes, m->head) != 0 ||
+      memcmp(s + n - m->tail, m->bytes + m->head, m->tail) != 0) {
+    return false;
+  }
+
+  const op_t          *op      = m->ops + m->head;
+  const op_t          *ops_end = m->ops + m->count - m->tail;
+  const unsigned char *t       = (const unsigned char *)s + m->head;
+  const unsigned char *t_end   = (const unsigned char *)s + n - m->tail;
+  const op_t          *star    = NULL;
+  const unsigned char *resume  = NULL;
+  while (t < t_end) {
+    if (op < ops_end) {
+      if (op->type == OP_STAR) {
+        star   = ++op;
+        resume = t;
+        continue;
+      }
+      if (step(m, op, *t)) {
+        op++;
+        t++;
+        continue;
+      }
+    }
+    if (!star) return false;
+    op = star;
+    t  = ++resume;
+  }
+  while (op < ops_end && op->type == OP_STAR) op++;
+  return op == ops_end;
+}
+
+static bool step(const matcher_t *m, const op_t *op, unsigned char c) {
+  switch ((op_type_t)op->type) {
+    case OP_BYTE: return op->byte == c;
+    case OP_SET: return m->sets[32 * op->set + (c >> 3)] >> (c & 7) & 1;
+    case OP_ANY:
+    case OP_STAR: break;
+  }
+  return true;
+}
+
+// Matches component `i` against the directory in `w->path`, descending for
+// each name that matches while components remain.
+static bool walk(walk_t *w, size_t i) {
+  const component_t *part = &w->parts[i];
+  bool               last = i + 1 == w->count;
+  bool               dir  = !last || part->sep_len > 0; // must be one
+  size_t             base = w->path.length;
+
+  // No wildcards: nothing to list, the name is just used.
+  if (part->match.head == part->match.count && !part->match.star) {
+    bool ok = append(w, part->match.bytes, part->match.head) &&
+              append(w, part->sep, part->sep_len);
+    if (ok && !last) {
+      ok = walk(w, i + 1);
+    } else if (ok && exists(w, dir)) {
+      char *match = arena_strndup(w->cache->arena, vector_data(&w->path),
+                                  w->path.length);
+      ok          = match && VECTOR_PUSH(w->out, char *, match);
+    }
+    w->path.length = base;
+    return ok;
+  }
+
+  glob_dir_t listed;
+  if (!listing(w->cache, vector_data(&w->path), base, &listed)) return false;
+  for (size_t e = 0; e < listed.count; e++) {
+    const glob_entry_t *entry = &listed.entries[e];
+    if (!matches(&part->match, entry->name, entry->length)) continue;
+
+    bool ok = append(w, entry->name, entry->length);
+    if (ok && dir && !is_dir(w, entry->type)) {
+      w->path.length = base;
+      continue;
+    }
+    ok = ok && append(w, part->sep, part->sep_len);
+    if (ok && !last) {
+      ok = walk(w, i + 1);
+    } else if (ok) {
+      char *match = arena_strndup(w->cache->arena, vector_data(&w->path),
+                                  w->path.length);
+      ok          = match && VECTOR_PUSH(w->out, char *, match);
+    }
+    w->path.length = base;
+    if (!ok) return false;
+  }
+  return true;
+}
+
+// The entries of the directory `path` (n bytes; "" is the current one),
+// from the cache or read now. getdents64 fills arena blocks back to back and
+// the entries point at the names in its records, which are never copied.
+// `.` and `..` are left out: no pattern expands to them.
+static bool listing(glob_cache_t *cache, const char *path, size_t n,
+                    glob_dir_t *dir) {
+  for (size_t i = 0; i < cache->dirs.length; i++) {
+    const glob_dir_t *d = &VECTOR_AT(&cache->dirs, glob_dir_t, i);
+    if (d->length == n && memcmp(d->path, path, n) == 0) {
+      *dir = *d;
+      return true;
+    }
+  }
+
+  arena_t *arena = cache->arena;
+  *dir           = (glob_dir_t){.path = arena_strndup(arena, path, n),
+                                .length = n};
+  if (!dir->path) return false;
+
+  vector_t entries;
+  vector_init(&entries, sizeof(glob_entry_t), arena);
+  int    fd    = open(n ? dir->path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  char  *block = NULL;
+  size_t room  = 0;
+  bool   ok    = true;
+  if (fd >= 0) cache->reads++;
+  while (fd >= 0 && ok) {
+    if (room < GLOB_MIN_ROOM) {
+      if (!(block = arena_alloc(arena, GLOB_BATCH))) break;
+      room = GLOB_BATCH;
+    }
+    long got = syscall(SYS_getdents64, fd, block, room);
+    if (got <= 0) break; // an error ends the listing early, as readdir's does
+
+    for (long off = 0; off < got && ok;) {
+      dirent64_t *d = (dirent64_t *)(block + off);
+      off += d->d_reclen;
+      char *name = d->d_name;
+      if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]))) {
+        continue;
+      }
+      glob_entry_t entry = {name, (uint32_t)strlen(name), d->d_type};
+      ok                 = VECTOR_PUSH(&entries, glob_entry_t, entry);
+    }
+    block += got; // records keep 8-byte alignment
+    room -= got;
+  }
+  if (fd >= 0) close(fd);
+  if (!ok || (fd >= 0 && !block)) return false;
+
+  dir->entries = vector_data(&entries);
+  dir->count   = entries.length;
+  if (entries.length && !entries.data) { // still inline: it would go stale
+    dir->entries = arena_alloc(arena, entries.length * sizeof(glob_entry_t));
+    if (!dir->entries) return false;
+    memcpy(dir->entries, entries.small, entries.length * sizeof(glob_entry_t));
+  }
+  return VECTOR_PUSH(&cache->dirs, glob_dir_t, *dir);
+}
+
+// A directory entry is a directory, going by d_type where the file system
+// fills it in and following symbolic links otherwise.
+static bool is_dir(walk_t *w, uint8_t type) {
+  if (type == DT_DIR) return true;
+  if (type != DT_LNK && type != DT_UNKNOWN) return false;
+  struct stat st;
+  const char *path = path_cstr(w);
+  return path && stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static bool exists(walk_t *w, bool dir) {
+  struct stat st;
+  const char *path = path_cstr(w);
+  if (!path) return false;
+  if (dir) return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+  return lstat(path, &st) == 0;
+}
+
+static const char *path_cstr(walk_t *w) {
+  if (!append(w, "", 1)) return NULL;
+  w->path.length--;
+  return vector_data(&w->path);
+}
+
+static bool append(walk_t *w, const char *s, size_t n) {
+  vector_t *path = &w->path;
+  size_t    need = path->length + n;
+  if (need > path->capacity &&
+      !vector_reserve(path, need > path->capacity * 2 ? need
+                                                      : path->capacity * 2)) {
+    return false;
+  }
+  memcpy((char *)vector_data(path) + path->length, s, n);
+  path->length += n;
+  return true;
+}
+
+// The C locale's order, which is strcmp's: an LSD radix sort on the first 8
+// bytes of each name, skipping the byte positions every name agrees on, then
+// a comparison sort of each run of names that share all 8. File names mostly
+// differ early, so those runs are short.
+static bool sort_bytes(arena_t *arena, char **names, size_t n) {
+  keyed_t *a = arena_alloc(arena, 2 * n * sizeof *a);
+  if (!a) return false;
+  keyed_t *b = a + n;
+
+  size_t counts[8][256] = {0};
+  for (size_t i = 0; i < n; i++) {
+    const unsigned char *s   = (const unsigned char *)names[i];
+    uint64_t             key = 0;
+    for (int j = 0; j < 8; j++) {
+      key = key << 8 | *s;
+      s += *s != 0;
+    }
+    a[i] = (keyed_t){key, names[i]};
+    for (int d = 0; d < 8; d++) counts[d][key >> (8 * d) & 0xff]++;
+  }
+
+  for (int d = 0; d < 8; d++) {
+    size_t *count = counts[d];
+    if (count[a[0].key >> (8 * d) & 0xff] == n) continue; // all agree
+    size_t at = 0;
+    for (int c = 0; c < 256; c++) {
+      size_t k = count[c];
+      count[c] = at;
+      at += k;
+    }
+    for (size_t i = 0; i < n; i++) {
+      b[count[a[i].key >> (8 * d) & 0xff]++] = a[i];
+    }
+    keyed_t *t = a;
+    a          = b;
+    b          = t;
+  }
+
+  for (size_t i = 0, run; i < n; i += run) {
+    for (run = 1; i + run < n && a[i + run].key == a[i].key; run++) {
+    }
+    if (run > 1 && (a[i].key & 0xff)) {
+      qsort(a + i, run, sizeof *a, compare_keyed);
+    }
+  }
+  for (size_t i = 0; i < n; i++) names[i] = a[i].name;
+  return true;
+}
+
+// Names with equal keys, which are at least 8 bytes long.
+static int compare_keyed(const void *a, const void *b) {
+  return strcmp(((const keyed_t *)a)->name + 8, ((const keyed_t *)b)->name + 8);
+}
+
+static int compare_locale(const void *a, const void *b) {
+  return strcoll(*(char *const *)a, *(char *const *)b);
+}
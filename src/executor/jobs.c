@@ -0,0 +1,429 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "executor/jobs.h"
+
+#define JOBS_INITIAL 16
+#define JOBS_EVENTS  64 // epoll events taken per wakeup
+
+static bool     start_events(jobs_t *jobs);
+static bool     start_sigfd(jobs_t *jobs);
+static void     reap_event(jobs_t *jobs, const struct epoll_event *ev);
+static void     reap_children(jobs_t *jobs);
+static int      decode_status(int wstatus);
+static void     format_times(const job_t *job, char *buf, size_t size);
+static uint64_t now_ns(void);
+
+void jobs_init(jobs_t *jobs) {
+  const char *force = getenv("TINY_JOBS");
+
+  jobs->slots     = NULL;
+  jobs->capacity  = 0;
+  jobs->top       = 0;
+  jobs->running   = 0;
+  jobs->stopped   = 0;
+  jobs->epfd      = -1;
+  jobs->sigfd     = -1;
+  jobs->use_pidfd = !(force && strcmp(force, "signalfd") == 0);
+
+  jobs->retired_next  = 0;
+  jobs->retired_count = 0;
+}
+
+void jobs_free(jobs_t *jobs) {
+  for (int i = 0; i < jobs->top; i++) {
+    if (jobs->slots[i].id) jobs_remove(jobs, &jobs->slots[i]);
+  }
+  if (jobs->epfd >= 0) close(jobs->epfd);
+  if (jobs->sigfd >= 0) {
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &chld, NULL);
+    close(jobs->sigfd);
+  }
+  free(jobs->slots);
+  jobs_init(jobs);
+}
+
+// A forked subshell must not reap or report the parent's jobs, and must not
+// touch the epoll set it shares with the parent.
+void jobs_detach(jobs_t *jobs) {
+  for (int i = 0; i < jobs->top; i++) {
+    if (jobs->slots[i].pidfd >= 0) close(jobs->slots[i].pidfd);
+    free(jobs->slots[i].command);
+  }
+  if (jobs->epfd >= 0) close(jobs->epfd);
+  if (jobs->sigfd >= 0) close(jobs->sigfd);
+  free(jobs->slots);
+  jobs_init(jobs);
+}
+
+job_t *jobs_add(jobs_t *jobs, pid_t pid, char *command) {
+  if (jobs->epfd < 0 && !start_events(jobs)) return NULL;
+
+  if ((size_t)jobs->top == jobs->capacity) {
+    size_t capacity = jobs->capacity ? jobs->capacity * 2 : JOBS_INITIAL;
+    job_t *slots    = realloc(jobs->slots, capacity * sizeof(job_t));
+    if (!slots) return NULL;
+    memset(slots + jobs->capacity, 0,
+           (capacity - jobs->capacity) * sizeof(job_t));
+    jobs->slots    = slots;
+    jobs->capacity = capacity;
+  }
+
+  int    index = jobs->top++;
+  job_t *job   = &jobs->slots[index];
+  *job         = (job_t){.id         = index + 1,
+                         .pid        = pid,
+                         .pidfd      = -1,
+                         .state      = JOB_RUNNING,
+                         .command    = command,
+                         .started_ns = now_ns()};
+  jobs->running++;
+
+  if (jobs->use_pidfd) {
+    job->pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = index};
+    if (job->pidfd < 0 && errno == ESRCH) {
+      jobs_wait(jobs, job); // already reaped elsewhere
+    } else if (job->pidfd < 0 ||
+               epoll_ctl(jobs->epfd, EPOLL_CTL_ADD, job->pidfd, &ev) != 0) {
+      // Out of fds: this job (and any others like it) is left to SIGCHLD.
+      if (job->pidfd >= 0) close(job->pidfd);
+      job->pidfd = -1;
+      if (jobs->sigfd < 0) start_sigfd(jobs);
+    }
+  }
+  // A child that exited before SIGCHLD was blocked left no signal for the
+  // signalfd to deliver, so a job left to it is looked at once on the way in.
+  int wstatus;
+  if (job->pidfd < 0 && job->state != JOB_DONE &&
+      waitpid(pid, &wstatus, WNOHANG) == pid) {
+    jobs_update(jobs, job, wstatus);
+  }
+  return job;
+}
+
+// Forgets a job. A job still running is left running, unwatched.
+void jobs_remove(jobs_t *jobs, job_t *job) {
+  if (job->state != JOB_DONE) jobs->running--;
+  if (job->state == JOB_STOPPED) jobs->stopped--;
+  if (job->pidfd >= 0) {
+    epoll_ctl(jobs->epfd, EPOLL_CTL_DEL, job->pidfd, NULL);
+    close(job->pidfd);
+  }
+  free(job->command);
+  *job = (job_t){.pidfd = -1};
+
+  while (jobs->top > 0 && jobs->slots[jobs->top - 1].id == 0) jobs->top--;
+}
+
+// Reaps whatever has finished, waiting up to `timeout_ms` (-1: forever) for
+// the first exit. Returns true if any job finished.
+bool jobs_poll(jobs_t *jobs, int timeout_ms) {
+  if (jobs->epfd < 0 || jobs->running == 0) return false;
+
+  size_t             before = jobs->running;
+  struct epoll_event events[JOBS_EVENTS];
+
+  int n;
+  while ((n = epoll_wait(jobs->epfd, events, JOBS_EVENTS, timeout_ms)) < 0) {
+    if (errno != EINTR) return false;
+  }
+  for (int i = 0; i < n; i++) reap_event(jobs, &events[i]);
+
+  // A full batch may have left more behind; take those without blocking.
+  while (n == JOBS_EVENTS) {
+    n = epoll_wait(jobs->epfd, events, JOBS_EVENTS, 0);
+    for (int i = 0; i < n; i++) reap_event(jobs, &events[i]);
+  }
+  return jobs->running < before;
+}
+
+int jobs_wait(jobs_t *jobs, job_t *job) {
+  int wstatus;
+  while (job->state != JOB_DONE) {
+    pid_t r = waitpid(job->pid, &wstatus, 0);
+    if (r == job->pid) {
+      jobs_update(jobs, job, wstatus);
+    } else if (r < 0 && errno != EINTR) {
+      // Reaped elsewhere (ECHILD); its status is lost.
+      if (job->state == JOB_STOPPED) jobs->stopped--;
+      job->state  = JOB_DONE;
+      job->status = 127;
+      jobs->running--;
+    }
+  }
+  return job->status;
+}
+
+// `wait -n`: a finished job not yet collected, else the next one to finish.
+// Returns NULL when there is nothing left to wait for.
+job_t *jobs_wait_any(jobs_t *jobs) {
+  for (;;) {
+    for (int i = 0; i < jobs->top; i++) {
+      if (jobs->slots[i].id && jobs->slots[i].state == JOB_DONE) {
+        return &jobs->slots[i];
+      }
+    }
+    // A stopped job sends no event until it is continued.
+    if (jobs->running == jobs->stopped) return NULL;
+    jobs_poll(jobs, -1);
+  }
+}
+
+// Records a wait status for `job`, whether from the reaper or from a caller's
+// own waitpid (as `fg` does with WUNTRACED).
+void jobs_update(jobs_t *jobs, job_t *job, int wstatus) {
+  if (WIFCONTINUED(wstatus)) {
+    jobs_continued(jobs, job);
+    return;
+  }
+  if (job->state == JOB_STOPPED) jobs->stopped--;
+  if (WIFSTOPPED(wstatus)) {
+    job->state = JOB_STOPPED;
+    jobs->stopped++;
+    return;
+  }
+
+  job->state      = JOB_DONE;
+  job->status     = decode_status(wstatus);
+  job->elapsed_ns = now_ns() - job->started_ns;
+  if (job->pidfd >= 0) {
+    epoll_ctl(jobs->epfd, EPOLL_CTL_DEL, job->pidfd, NULL);
+    close(job->pidfd);
+  }
+  job->pidfd = -1;
+  jobs->running--;
+}
+
+// Marks a stopped job running again, as `bg` does once it has sent SIGCONT.
+void jobs_continued(jobs_t *jobs, job_t *job) {
+  if (job->state != JOB_STOPPED) return;
+  job->state = JOB_RUNNING;
+  jobs->stopped--;
+}
+
+// `%n`, `%%`/`%+` (newest job), `%-` (the one before), `%name` (command
+// prefix), or a plain pid.
+job_t *jobs_find(jobs_t *jobs, const char *spec) {
+  if (spec[0] != '%') {
+    char *end;
+    long  pid = strtol(spec, &end, 10);
+    if (*end || pid <= 0) return NULL;
+    for (int i = 0; i < jobs->top; i++) {
+      job_t *job = &jobs->slots[i];
+      if (job->id && job->pid == pid) return job;
+    }
+    return NULL;
+  }
+
+  spec++;
+  if (!*spec || strcmp(spec, "%") == 0 || strcmp(spec, "+") == 0 ||
+      strcmp(spec, "-") == 0) {
+    int skip = strcmp(spec, "-") == 0;
+    for (int i = jobs->top - 1; i >= 0; i--) {
+      if (jobs->slots[i].id && skip-- == 0) return &jobs->slots[i];
+    }
+    return NULL;
+  }
+
+  if (*spec >= '0' && *spec <= '9') {
+    long id = strtol(spec, NULL, 10);
+    if (id < 1 || id > jobs->top || !jobs->slots[id - 1].id) return NULL;
+    return &jobs->slots[id - 1];
+  }
+
+  size_t len = strlen(spec);
+  for (int i = jobs->top - 1; i >= 0; i--) {
+    if (jobs->slots[i].id && strncmp(jobs->slots[i].command, spec, len) == 0) {
+      return &jobs->slots[i];
+    }
+  }
+  return NULL;
+}
+
+void jobs_print(const jobs_t *jobs, const job_t *job, FILE *out, bool pids) {
+  char mark = ' ';
+  for (int i = jobs->top - 1, seen = 0; i >= 0 && seen < 2; i--) {
+    if (!jobs->slots[i].id) continue;
+    if (&jobs->slots[i] == job) mark = seen ? '-' : '+';
+    seen++;
+  }
+
+  char state[32];
+  if (job->state == JOB_RUNNING) {
+    snprintf(state, sizeof state, "Running");
+  } else if (job->state == JOB_STOPPED) {
+    snprintf(state, sizeof state, "Stopped");
+  } else if (job->status > 128) {
+    snprintf(state, sizeof state, "%s", strsignal(job->status - 128));
+  } else if (job->status) {
+    snprintf(state, sizeof state, "Done(%d)", job->status);
+  } else {
+    snprintf(state, sizeof state, "Done");
+  }
+
+  if (pids) {
+    char times[32];
+    format_times(job, times, sizeof times);
+    fprintf(out, "[%d]%c %d %s %-24s%s\n", job->id, mark, (int)job->pid,
+            times, state, job->command);
+  } else {
+    fprintf(out, "[%d]%c  %-24s%s\n", job->id, mark, state, job->command);
+  }
+}
+
+// Reports finished jobs and forgets them, as an interactive shell does before
+// each prompt.
+void jobs_notify(jobs_t *jobs, FILE *out) {
+  for (int i = 0; i < jobs->top; i++) {
+    job_t *job = &jobs->slots[i];
+    if (!job->id || job->state != JOB_DONE) continue;
+    jobs_print(jobs, job, out, false);
+    jobs_remove(jobs, job);
+  }
+}
+
+// A non-interactive shell reports nothing, so without this finished jobs
+// would stay in the table until a `wait` or `jobs` that may never come.
+// Drops them, keeping the last JOBS_REMEMBERED statuses for `wait pid`.
+void jobs_retire(jobs_t *jobs) {
+  for (int i = 0; i < jobs->top; i++) {
+    job_t *job = &jobs->slots[i];
+    if (!job->id || job->state != JOB_DONE) continue;
+    size_t slot         = jobs->retired_next;
+    jobs->retired[slot] = (job_status_t){job->pid, job->status};
+    jobs->retired_next  = (slot + 1) % JOBS_REMEMBERED;
+    if (jobs->retired_count < JOBS_REMEMBERED) jobs->retired_count++;
+    jobs_remove(jobs, job);
+  }
+}
+
+// Hands out the status jobs_retire kept for `pid`, or the oldest one kept
+// when `pid` is 0. Each status is handed out once.
+bool jobs_take_status(jobs_t *jobs, pid_t pid, int *status) {
+  size_t oldest = JOBS_REMEMBERED + jobs->retired_next - jobs->retired_count;
+  for (size_t k = 0; k < jobs->retired_count; k++) {
+    size_t i = (oldest + k) % JOBS_REMEMBERED;
+    if (pid && jobs->retired[i].pid != pid) continue;
+    *status = jobs->retired[i].status;
+
+    // Close the gap by moving the older entries up one.
+    for (; k > 0; k--) {
+      size_t prev      = (i + JOBS_REMEMBERED - 1) % JOBS_REMEMBERED;
+      jobs->retired[i] = jobs->retired[prev];
+      i                = prev;
+    }
+    jobs->retired_count--;
+    return true;
+  }
+  return false;
+}
+
+static bool start_events(jobs_t *jobs) {
+  jobs->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (jobs->epfd < 0) return false;
+
+  if (jobs->use_pidfd) {
+    // Probe once; kernels before 5.3 lack the syscall.
+    int fd = (int)syscall(SYS_pidfd_open, getpid(), 0);
+    if (fd >= 0) {
+      close(fd);
+      return true;
+    }
+    jobs->use_pidfd = false;
+  }
+
+  if (!start_sigfd(jobs)) {
+    close(jobs->epfd);
+    jobs->epfd = -1;
+    return false;
+  }
+  return true;
+}
+
+static bool start_sigfd(jobs_t *jobs) {
+  sigset_t chld;
+  sigemptyset(&chld);
+  sigaddset(&chld, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &chld, NULL);
+
+  jobs->sigfd = signalfd(-1, &chld, SFD_NONBLOCK | SFD_CLOEXEC);
+  struct epoll_event ev = {.events = EPOLLIN, .data.u32 = UINT32_MAX};
+  if (jobs->sigfd >= 0 &&
+      epoll_ctl(jobs->epfd, EPOLL_CTL_ADD, jobs->sigfd, &ev) == 0) {
+    return true;
+  }
+  if (jobs->sigfd >= 0) close(jobs->sigfd);
+  jobs->sigfd = -1;
+  sigprocmask(SIG_UNBLOCK, &chld, NULL);
+  return false;
+}
+
+static void reap_event(jobs_t *jobs, const struct epoll_event *ev) {
+  int wstatus;
+
+  if (ev->data.u32 != UINT32_MAX) {
+    job_t *job = &jobs->slots[ev->data.u32];
+    if (job->pidfd < 0) return; // already reaped earlier in this batch
+    if (waitpid(job->pid, &wstatus, WNOHANG) == job->pid) {
+      jobs_update(jobs, job, wstatus);
+    }
+    return;
+  }
+
+  // SIGCHLDs coalesce, so drain them and reap everything exited.
+  struct signalfd_siginfo info[16];
+  while (read(jobs->sigfd, info, sizeof info) > 0) {
+  }
+  reap_children(jobs);
+}
+
+// Waits only on the jobs' own pids: pipeline stages and $(...) children are
+// waited for by whoever started them, and must not be reaped from under it.
+static void reap_children(jobs_t *jobs) {
+  int wstatus;
+  for (int i = 0; i < jobs->top; i++) {
+    job_t *job = &jobs->slots[i];
+    if (job->id && job->state != JOB_DONE && job->pidfd < 0 &&
+        waitpid(job->pid, &wstatus, WNOHANG) == job->pid) {
+      jobs_update(jobs, job, wstatus);
+    }
+  }
+}
+
+static int decode_status(int wstatus) {
+  if (WIFEXITED(wstatus)) return WEXITSTATUS(wstatus);
+  if (WIFSIGNALED(wstatus)) return 128 + WTERMSIG(wstatus);
+  return 1;
+}
+
+// The wall-clock time the job started and how long it has run, or ran once
+// it is done: "14:02:33   12.041s".
+static void format_times(const job_t *job, char *buf, size_t size) {
+  uint64_t ran   = now_ns() - job->started_ns;
+  time_t   start = time(NULL) - (time_t)(ran / 1000000000u);
+  if (job->state == JOB_DONE) ran = job->elapsed_ns;
+
+  struct tm tm;
+  size_t    n = strftime(buf, size, "%H:%M:%S", localtime_r(&start, &tm));
+  snprintf(buf + n, size - n, " %9.3fs", ran / 1e9);
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
@@ -0,0 +1,226 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "executor/lineread.h"
+
+#define LINEREAD_BLOCK 65536 // bytes read ahead from a file, or peeked at
+#define LINE_FALLBACK  (-2)  // strategy unusable on this fd; nothing consumed
+
+static int     read_file(lineread_t *lr, int fd, const struct stat *st,
+                         vector_t *line);
+static int     read_peeking(lineread_t *lr, int fd, bool socket,
+                            vector_t *line);
+static int     read_terminal(lineread_t *lr, int fd, vector_t *line);
+static int     read_bytes(lineread_t *lr, int fd, vector_t *line);
+static ssize_t peek(lineread_t *lr, int fd, bool socket);
+static bool    read_exact(lineread_t *lr, int fd, char *buf, size_t n);
+static bool    same_file(const lineread_t *lr, const struct stat *st);
+static bool    append(vector_t *line, const char *s, size_t n);
+
+void lineread_init(lineread_t *lr) {
+  *lr = (lineread_t){.peek = {-1, -1}};
+}
+
+void lineread_free(lineread_t *lr) {
+  free(lr->data);
+  if (lr->peek[0] >= 0) {
+    close(lr->peek[0]);
+    close(lr->peek[1]);
+  }
+  lineread_init(lr);
+}
+
+// Appends the next line of `fd` to `line`, without its newline. Returns 1 for
+// a whole line, 0 at the end of input (after appending any unterminated last
+// line) and -1 if reading failed.
+int lineread_next(lineread_t *lr, int fd, vector_t *line) {
+  if (!lr->data) {
+    lr->data     = malloc(LINEREAD_BLOCK);
+    lr->capacity = lr->data ? LINEREAD_BLOCK : 0;
+  }
+
+  struct stat st;
+  int         result = LINE_FALLBACK;
+  lr->syscalls++;
+  if (lr->data && fstat(fd, &st) == 0) {
+    if (S_ISREG(st.st_mode)) {
+      result = read_file(lr, fd, &st, line);
+    } else if (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode)) {
+      result = read_peeking(lr, fd, S_ISSOCK(st.st_mode), line);
+    } else if (S_ISCHR(st.st_mode)) {
+      result = read_terminal(lr, fd, line);
+    }
+  }
+  return result == LINE_FALLBACK ? read_bytes(lr, fd, line) : result;
+}
+
+// The block is kept across calls while the file looks as it did when it was
+// read (same inode, size and mtime) and the offset still lies inside it, so a
+// line costs an fstat, an lseek to learn the offset, which anything else
+// reading the fd may have moved, and an lseek to leave it after the line.
+static int read_file(lineread_t *lr, int fd, const struct stat *st,
+                     vector_t *line) {
+  lr->syscalls++;
+  off_t off = lseek(fd, 0, SEEK_CUR);
+  if (off < 0) return LINE_FALLBACK;
+
+  if (!same_file(lr, st) || off < lr->start ||
+      off > lr->start + (off_t)lr->length) {
+    lr->length = 0;
+    lr->start  = off;
+    lr->dev    = st->st_dev;
+    lr->ino    = st->st_ino;
+    lr->size   = st->st_size;
+    lr->mtime  = st->st_mtim;
+  }
+
+  int result = 0;
+  for (;;) {
+    if (off == lr->start + (off_t)lr->length) {
+      lr->syscalls++;
+      ssize_t n = pread(fd, lr->data, lr->capacity, off);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) {
+        lr->length = 0;
+        result     = n < 0 ? -1 : 0;
+        break;
+      }
+      lr->start  = off;
+      lr->length = n;
+    }
+
+    const char *p     = lr->data + (off - lr->start);
+    size_t      avail = lr->start + lr->length - off;
+    const char *nl    = memchr(p, '\n', avail);
+    size_t      take  = nl ? (size_t)(nl - p) : avail;
+    if (!append(line, p, take)) {
+      result = -1;
+      break;
+    }
+    off += take + (nl != NULL);
+    if (nl) {
+      result = 1;
+      break;
+    }
+  }
+
+  lr->syscalls++;
+  if (lseek(fd, off, SEEK_SET) < 0) return -1;
+  return result;
+}
+
+// A pipe is copied into the scratch pipe with tee(2) and a socket is read
+// with MSG_PEEK; either way nothing is consumed until the newline has been
+// found, and then only up to it. Data a concurrent reader takes between the
+// two calls is the one thing this cannot account for.
+static int read_peeking(lineread_t *lr, int fd, bool socket,
+                        vector_t *line) {
+  if (!socket && lr->peek[0] < 0) {
+    lr->syscalls++;
+    if (pipe2(lr->peek, O_CLOEXEC) < 0) {
+      lr->peek[0] = lr->peek[1] = -1;
+      return LINE_FALLBACK;
+    }
+  }
+  lr->length = 0; // the block no longer holds a file
+
+  for (bool first = true;; first = false) {
+    ssize_t n = peek(lr, fd, socket);
+    if (n < 0 && first && (errno == EINVAL || errno == ENOTSOCK)) {
+      return LINE_FALLBACK;
+    }
+    if (n <= 0) return n < 0 ? -1 : 0;
+
+    const char *nl   = memchr(lr->data, '\n', n);
+    size_t      take = nl ? (size_t)(nl - lr->data) + 1 : (size_t)n;
+    if (!read_exact(lr, fd, lr->data, take) ||
+        !append(line, lr->data, take - (nl != NULL))) {
+      return -1;
+    }
+    if (nl) return 1;
+  }
+}
+
+// In canonical mode a terminal never returns more than one line per read.
+static int read_terminal(lineread_t *lr, int fd, vector_t *line) {
+  struct termios tio;
+  lr->syscalls++;
+  if (tcgetattr(fd, &tio) != 0 || !(tio.c_lflag & ICANON)) {
+    return LINE_FALLBACK;
+  }
+  lr->length = 0;
+
+  for (;;) {
+    lr->syscalls++;
+    ssize_t n = read(fd, lr->data, lr->capacity);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return n < 0 ? -1 : 0;
+
+    bool nl = lr->data[n - 1] == '\n';
+    if (!append(line, lr->data, n - nl)) return -1;
+    if (nl) return 1;
+  }
+}
+
+static int read_bytes(lineread_t *lr, int fd, vector_t *line) {
+  for (;;) {
+    char c;
+    lr->syscalls++;
+    ssize_t n = read(fd, &c, 1);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return n < 0 ? -1 : 0;
+    if (c == '\n') return 1;
+    if (!append(line, &c, 1)) return -1;
+  }
+}
+
+// Copies what `fd` holds, up to a block, into `data` without consuming it.
+static ssize_t peek(lineread_t *lr, int fd, bool socket) {
+  for (;;) {
+    lr->syscalls++;
+    ssize_t n = socket ? recv(fd, lr->data, lr->capacity, MSG_PEEK)
+                       : tee(fd, lr->peek[1], lr->capacity, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0 || socket) return n;
+    return read_exact(lr, lr->peek[0], lr->data, n) ? n : -1;
+  }
+}
+
+static bool read_exact(lineread_t *lr, int fd, char *buf, size_t n) {
+  while (n > 0) {
+    lr->syscalls++;
+    ssize_t got = read(fd, buf, n);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) return false;
+    buf += got;
+    n -= got;
+  }
+  return true;
+}
+
+static bool same_file(const lineread_t *lr, const struct stat *st) {
+  return lr->dev == st->st_dev && lr->ino == st->st_ino &&
+         lr->size == st->st_size && lr->mtime.tv_sec == st->st_mtim.tv_sec &&
+         lr->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+static bool append(vector_t *line, const char *s, size_t n) {
+  size_t need = line->length + n;
+  if (need > line->capacity &&
+      !vector_reserve(line, need > line->capacity * 2 ? need
+                                                      : line->capacity * 2)) {
+    return false;
+  }
+  memcpy((char *)vector_data(line) + line->length, s, n);
+  line->length += n;
+  return true;
+}
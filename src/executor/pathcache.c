@@ -0,0 +1,166 @@
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "executor/pathcache.h"
+
+#define PATHCACHE_MIN_CAPACITY 64
+
+static uint32_t hash_name(const char *name);
+static size_t   find_slot(const pathcache_t *pc, const char *name, uint32_t h);
+static bool     grow(pathcache_t *pc);
+static bool     is_executable(const char *path);
+
+void pathcache_init(pathcache_t *pc) { *pc = (pathcache_t){0}; }
+
+void pathcache_free(pathcache_t *pc) {
+  pathcache_clear(pc);
+  free(pc->slots);
+  pc->slots    = NULL;
+  pc->capacity = 0;
+}
+
+void pathcache_clear(pathcache_t *pc) {
+  for (size_t i = 0; i < pc->capacity; i++) {
+    free(pc->slots[i].name);
+    free(pc->slots[i].path);
+    pc->slots[i] = (pathcache_entry_t){0};
+  }
+  pc->count = 0;
+}
+
+// Returns the absolute path for `name`, walking `path` (the value of $PATH)
+// only on a miss. Names containing a slash are used as-is and never cached.
+// The path belongs to the cache, so one found but left uncached for lack of
+// memory is freed and reported as NULL too.
+const char *pathcache_lookup(pathcache_t *pc, const char *name,
+                             const char *path) {
+  if (strchr(name, '/')) return name;
+
+  uint32_t h = hash_name(name);
+  if (pc->capacity) {
+    size_t i = find_slot(pc, name, h);
+    if (pc->slots[i].name) {
+      pc->hits++;
+      pc->slots[i].hits++;
+      return pc->slots[i].path;
+    }
+  }
+
+  pc->misses++;
+  char *found = pathcache_search(pc, name, path);
+  if (!found) return NULL;
+
+  char *key = strdup(name);
+  if (!key || ((pc->count + 1) * 4 > pc->capacity * 3 && !grow(pc))) {
+    free(key);
+    free(found);
+    return NULL;
+  }
+
+  size_t i     = find_slot(pc, name, h);
+  pc->slots[i] = (pathcache_entry_t){key, found, h, 1};
+  pc->count++;
+  return found;
+}
+
+// Drops `name`, e.g. after exec reported ENOENT for its remembered path.
+// Uses backward-shift deletion so probe chains stay intact without tombstones.
+void pathcache_forget(pathcache_t *pc, const char *name) {
+  if (!pc->capacity) return;
+
+  size_t mask = pc->capacity - 1;
+  size_t i    = find_slot(pc, name, hash_name(name));
+  if (!pc->slots[i].name) return;
+
+  free(pc->slots[i].name);
+  free(pc->slots[i].path);
+  pc->slots[i] = (pathcache_entry_t){0};
+  pc->count--;
+
+  for (size_t j = (i + 1) & mask; pc->slots[j].name; j = (j + 1) & mask) {
+    size_t home = pc->slots[j].hash & mask;
+    // Move j back into the hole unless its home lies cyclically in (i, j].
+    bool stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+    if (stays) continue;
+    pc->slots[i] = pc->slots[j];
+    pc->slots[j] = (pathcache_entry_t){0};
+    i            = j;
+  }
+}
+
+// Uncached $PATH walk; an empty component means the current directory.
+// Returns a malloc'd path or NULL.
+char *pathcache_search(pathcache_t *pc, const char *name, const char *path) {
+  if (!path) return NULL;
+
+  size_t name_len = strlen(name);
+  for (const char *dir = path;; dir++) {
+    const char *end     = strchrnul(dir, ':');
+    size_t      dir_len = end - dir;
+    char       *full    = malloc(dir_len + name_len + 3);
+    if (!full) return NULL;
+
+    if (dir_len == 0) {
+      memcpy(full, ".", 2);
+      dir_len = 1;
+    } else {
+      memcpy(full, dir, dir_len);
+    }
+    full[dir_len] = '/';
+    memcpy(full + dir_len + 1, name, name_len + 1);
+
+    pc->probes++;
+    if (is_executable(full)) return full;
+    free(full);
+
+    if (*end == '\0') return NULL;
+    dir = end;
+  }
+}
+
+static uint32_t hash_name(const char *name) {
+  uint32_t h = 2166136261u; // FNV-1a
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+    h = (h ^ *p) * 16777619u;
+  }
+  return h;
+}
+
+static size_t find_slot(const pathcache_t *pc, const char *name, uint32_t h) {
+  size_t mask = pc->capacity - 1;
+  size_t i    = h & mask;
+  while (pc->slots[i].name &&
+         (pc->slots[i].hash != h || strcmp(pc->slots[i].name, name) != 0)) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+static bool grow(pathcache_t *pc) {
+  size_t capacity = pc->capacity ? pc->capacity * 2 : PATHCACHE_MIN_CAPACITY;
+  pathcache_entry_t *slots = calloc(capacity, sizeof(pathcache_entry_t));
+  if (!slots) return false;
+
+  pathcache_t next = *pc;
+  next.slots       = slots;
+  next.capacity    = capacity;
+  for (size_t i = 0; i < pc->capacity; i++) {
+    if (!pc->slots[i].name) continue;
+    next.slots[find_slot(&next, pc->slots[i].name, pc->slots[i].hash)] =
+        pc->slots[i];
+  }
+
+  free(pc->slots);
+  *pc = next;
+  return true;
+}
+
+static bool is_executable(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0 && S_ISREG(st.st_mode) && access(path, X_OK) == 0;
+}
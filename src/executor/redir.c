@@ -0,0 +1,282 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "collections/vector.h"
+#include "executor/redir.h"
+
+#define REDIR_FD_BASE 10 // opened files are kept clear of user fds 0-9
+
+typedef struct {
+  int    fd;
+  size_t length;
+  char   text[];
+} heredoc_writer_t;
+
+static int   open_target(const ast_redir_t *redir);
+static int   open_heredoc(const char *body);
+static bool  write_all(int fd, const char *p, size_t n);
+static void *write_heredoc(void *arg);
+static int   move_high(int fd);
+static bool  parse_dup_target(const char *target, int *fd);
+
+void redir_plan_init(redir_plan_t *plan, arena_t *arena) {
+  vector_init(&plan->ops, sizeof(redir_op_t), arena);
+  vector_init(&plan->opened, sizeof(int), arena);
+}
+
+bool redir_plan_add(redir_plan_t *plan, int from, int to) {
+  redir_op_t op = {from, to};
+  return VECTOR_PUSH(&plan->ops, redir_op_t, op);
+}
+
+bool redir_plan_build(redir_plan_t *plan, const ast_redir_t *redirs,
+                      uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    const ast_redir_t *redir = &redirs[i];
+    int                from;
+
+    switch (redir->type) {
+      case REDIR_DUP_IN:
+      case REDIR_DUP_OUT:
+        if (!parse_dup_target(redir->target.text, &from)) {
+          fprintf(stderr, "tiny: %s: bad file descriptor\n",
+                  redir->target.text);
+          return false;
+        }
+        break;
+      default:
+        from = redir->body.text ? open_heredoc(redir->body.text)
+                                : open_target(redir);
+        if (from < 0) {
+          fprintf(stderr, "tiny: %s: %s\n",
+                  redir->body.text ? "here-document" : redir->target.text,
+                  strerror(errno));
+          return false;
+        }
+        if (!VECTOR_PUSH(&plan->opened, int, from)) {
+          close(from);
+          return false;
+        }
+        break;
+    }
+
+    if (!redir_plan_add(plan, from, redir->fd)) return false;
+  }
+  return true;
+}
+
+void redir_plan_release(redir_plan_t *plan) {
+  for (size_t i = 0; i < plan->opened.length; i++) {
+    close(VECTOR_AT(&plan->opened, int, i));
+  }
+  plan->opened.length = 0;
+}
+
+bool redir_plan_spawn_actions(const redir_plan_t *plan,
+                              posix_spawn_file_actions_t *actions) {
+  for (size_t i = 0; i < plan->ops.length; i++) {
+    redir_op_t op = VECTOR_AT(&plan->ops, redir_op_t, i);
+    int        err;
+    if (op.from == REDIR_CLOSE) {
+      err = posix_spawn_file_actions_addclose(actions, op.to);
+    } else {
+      err = posix_spawn_file_actions_adddup2(actions, op.from, op.to);
+    }
+    if (err) return false;
+  }
+  return true;
+}
+
+// For a forked child: the plan's own fds are close-on-exec, so only the
+// targets survive into the program that is exec'd.
+bool redir_plan_apply(const redir_plan_t *plan) {
+  for (size_t i = 0; i < plan->ops.length; i++) {
+    redir_op_t op = VECTOR_AT(&plan->ops, redir_op_t, i);
+    if (op.from == REDIR_CLOSE) {
+      close(op.to);
+    } else if (op.from != op.to && dup2(op.from, op.to) < 0) {
+      fprintf(stderr, "tiny: %d: %s\n", op.from, strerror(errno));
+      return false;
+    }
+  }
+  return true;
+}
+
+// For builtins running in the shell itself: each target fd is first copied
+// aside (once) into `saved`, a vector of redir_op_t {copy, fd}, so that
+// redir_restore can put the shell's descriptors back afterwards.
+bool redir_plan_apply_saving(const redir_plan_t *plan, vector_t *saved) {
+  for (size_t i = 0; i < plan->ops.length; i++) {
+    redir_op_t op = VECTOR_AT(&plan->ops, redir_op_t, i);
+
+    bool seen = false;
+    for (size_t j = 0; j < saved->length && !seen; j++) {
+      seen = VECTOR_AT(saved, redir_op_t, j).to == op.to;
+    }
+    if (!seen) {
+      redir_op_t save = {fcntl(op.to, F_DUPFD_CLOEXEC, REDIR_FD_BASE), op.to};
+      if (save.from < 0 && errno != EBADF) return false;
+      if (!VECTOR_PUSH(saved, redir_op_t, save)) {
+        if (save.from >= 0) close(save.from);
+        return false;
+      }
+    }
+
+    if (op.from == REDIR_CLOSE) {
+      close(op.to);
+    } else if (op.from != op.to && dup2(op.from, op.to) < 0) {
+      fprintf(stderr, "tiny: %d: %s\n", op.from, strerror(errno));
+      return false;
+    }
+  }
+  return true;
+}
+
+// Undoes redir_plan_apply_saving; fds that were closed before are closed again.
+void redir_restore(vector_t *saved) {
+  for (size_t i = saved->length; i-- > 0;) {
+    redir_op_t save = VECTOR_AT(saved, redir_op_t, i);
+    if (save.from >= 0) {
+      dup2(save.from, save.to);
+      close(save.from);
+    } else {
+      close(save.to);
+    }
+  }
+  saved->length = 0;
+}
+
+static int open_target(const ast_redir_t *redir) {
+  int flags;
+  switch (redir->type) {
+    case REDIR_IN: flags = O_RDONLY; break;
+    case REDIR_OUT:
+    case REDIR_CLOBBER: flags = O_WRONLY | O_CREAT | O_TRUNC; break;
+    case REDIR_OUT_APPEND: flags = O_WRONLY | O_CREAT | O_APPEND; break;
+    case REDIR_READWRITE: flags = O_RDWR | O_CREAT; break;
+    default: errno = EINVAL; return -1;
+  }
+
+  return move_high(open(redir->target.text, flags | O_CLOEXEC, 0666));
+}
+
+// A here-document never touches the disk. A body that fits in a pipe is
+// written into one up front and read from its other end. A larger one goes
+// into a memfd sealed against further change, which readers can seek and
+// mmap like the temp file other shells use. Where memfd_create is missing, a
+// thread feeds the pipe while the command reads.
+static int open_heredoc(const char *body) {
+  size_t length = strlen(body);
+  int    fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0) return -1;
+
+  int capacity = fcntl(fds[1], F_GETPIPE_SZ);
+  if (capacity > 0 && length <= (size_t)capacity) {
+    bool ok = write_all(fds[1], body, length);
+    close(fds[1]);
+    if (!ok) {
+      close(fds[0]);
+      return -1;
+    }
+    return move_high(fds[0]);
+  }
+
+  int fd = memfd_create("heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd >= 0) {
+    close(fds[0]);
+    close(fds[1]);
+    int seals = F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+    if (!write_all(fd, body, length) || fcntl(fd, F_ADD_SEALS, seals) != 0 ||
+        lseek(fd, 0, SEEK_SET) != 0) {
+      int saved = errno;
+      close(fd);
+      errno = saved;
+      return -1;
+    }
+    return move_high(fd);
+  }
+
+  // The arena holding `body` may be reset while the thread still writes.
+  heredoc_writer_t *w = malloc(sizeof(heredoc_writer_t) + length);
+  pthread_t         thread;
+  if (!w) {
+    close(fds[0]);
+    close(fds[1]);
+    errno = ENOMEM;
+    return -1;
+  }
+  w->fd     = fds[1];
+  w->length = length;
+  memcpy(w->text, body, length);
+  int err = pthread_create(&thread, NULL, write_heredoc, w);
+  if (err) {
+    free(w);
+    close(fds[0]);
+    close(fds[1]);
+    errno = err;
+    return -1;
+  }
+  pthread_detach(thread);
+  return move_high(fds[0]);
+}
+
+static bool write_all(int fd, const char *p, size_t n) {
+  while (n > 0) {
+    ssize_t written = write(fd, p, n);
+    if (written < 0 && errno == EINTR) continue;
+    if (written < 0) return false;
+    p += written;
+    n -= written;
+  }
+  return true;
+}
+
+// A reader that stops early closes the pipe; with SIGPIPE blocked in this
+// thread that surfaces as EPIPE here instead of killing the shell.
+static void *write_heredoc(void *arg) {
+  heredoc_writer_t *w = arg;
+  sigset_t          pipe_signal;
+  sigemptyset(&pipe_signal);
+  sigaddset(&pipe_signal, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipe_signal, NULL);
+
+  write_all(w->fd, w->text, w->length);
+  close(w->fd);
+  free(w);
+  return NULL;
+}
+
+// Keeps the plan's own fds clear of the 0-9 a script may name.
+static int move_high(int fd) {
+  if (fd < 0 || fd >= REDIR_FD_BASE) return fd;
+
+  int high = fcntl(fd, F_DUPFD_CLOEXEC, REDIR_FD_BASE);
+  close(fd);
+  return high;
+}
+
+static bool parse_dup_target(const char *target, int *fd) {
+  if (strcmp(target, "-") == 0) {
+    *fd = REDIR_CLOSE;
+    return true;
+  }
+  if (!*target) return false;
+
+  int n = 0;
+  for (const char *p = target; *p; p++) {
+    if (*p < '0' || *p > '9' || n > 1000000) return false;
+    n = n * 10 + (*p - '0');
+  }
+  *fd = n;
+  return true;
+}
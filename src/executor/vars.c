@@ -0,0 +1,311 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "executor/vars.h"
+
+#define VARS_MIN_CAPACITY 64
+#define VARS_ENVP_SPARE   8    // slots past the terminator for overlays
+#define VARS_MIN_DEAD     4096 // arena bytes worth compacting for
+
+extern char **environ;
+
+static uint32_t hash_name(const char *name, size_t length);
+static size_t   find_slot(const vars_t *v, const char *name, size_t length,
+                          uint32_t h);
+static var_t   *declare(vars_t *v, const char *name, size_t length);
+static bool     assign(vars_t *v, var_t *var, const char *value);
+static bool     grow(vars_t *v);
+static bool     reserve_envp(vars_t *v, size_t count);
+
+// Takes in the inherited environment without copying it: each variable's
+// entry points at its environ string until it is first assigned.
+void vars_init(vars_t *v) {
+  *v = (vars_t){.generation = 1};
+  arena_init(&v->arena, 0);
+
+  for (char **e = environ; *e; e++) {
+    const char *eq = strchr(*e, '=');
+    if (!eq) continue;
+    var_t *var = declare(v, *e, eq - *e);
+    if (!var) break;
+    var->entry = *e;
+    var->size  = 0;
+    var->flags = VAR_EXPORT;
+  }
+}
+
+void vars_free(vars_t *v) {
+  free(v->slots);
+  free(v->envp);
+  arena_free(&v->arena);
+  *v = (vars_t){0};
+}
+
+var_t *vars_find(const vars_t *v, const char *name) {
+  if (!v->capacity) return NULL;
+  size_t length = strlen(name);
+  size_t i      = find_slot(v, name, length, hash_name(name, length));
+  return v->slots[i].name ? &v->slots[i] : NULL;
+}
+
+const char *vars_get(const vars_t *v, const char *name) {
+  const var_t *var = vars_find(v, name);
+  return var ? var_value(var) : NULL;
+}
+
+// Fails with EPERM for a readonly variable, or ENOMEM.
+bool vars_set(vars_t *v, const char *name, const char *value) {
+  var_t *var = declare(v, name, strlen(name));
+  if (!var) return false;
+  if (var->flags & VAR_READONLY) {
+    errno = EPERM;
+    return false;
+  }
+  return assign(v, var, value);
+}
+
+// Adds `flags` to a variable, declaring it (without a value) if need be.
+bool vars_set_flags(vars_t *v, const char *name, unsigned flags) {
+  var_t *var = declare(v, name, strlen(name));
+  if (!var) return false;
+  if ((flags & VAR_EXPORT) && !(var->flags & VAR_EXPORT) && var->entry) {
+    v->generation++;
+  }
+  var->flags |= flags;
+  return true;
+}
+
+// Fails with EPERM for a readonly variable. Backward-shift deletion keeps
+// probe chains intact without tombstones.
+bool vars_unset(vars_t *v, const char *name) {
+  var_t *var = vars_find(v, name);
+  if (!var) return true;
+  if (var->flags & VAR_READONLY) {
+    errno = EPERM;
+    return false;
+  }
+
+  if (var->env >= 0) v->generation++;
+  v->dead += var->size + var->length + 1;
+  v->live -= var->size + var->length + 1;
+  v->count--;
+
+  size_t mask = v->capacity - 1;
+  size_t i    = var - v->slots;
+  v->slots[i] = (var_t){0};
+  for (size_t j = (i + 1) & mask; v->slots[j].name; j = (j + 1) & mask) {
+    size_t home  = v->slots[j].hash & mask;
+    bool   stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+    if (stays) continue;
+    v->slots[i] = v->slots[j];
+    v->slots[j] = (var_t){0};
+    i           = j;
+  }
+  return true;
+}
+
+// Copies the live names and values into a fresh arena once the dead ones
+// outweigh them. Invalidates every name and value pointer handed out, so it
+// runs only between commands.
+void vars_compact(vars_t *v) {
+  if (v->dead < VARS_MIN_DEAD || v->dead < v->live) return;
+
+  arena_t fresh;
+  arena_init(&fresh, v->live);
+  for (size_t i = 0; i < v->capacity; i++) {
+    var_t *var = &v->slots[i];
+    if (!var->name) continue;
+
+    char *name  = arena_strndup(&fresh, var->name, var->length);
+    char *entry = var->size ? arena_alloc(&fresh, var->size) : var->entry;
+    if (!name || (var->size && !entry)) {
+      arena_free(&fresh); // keep the old one; it is still intact
+      return;
+    }
+    if (var->size) memcpy(entry, var->entry, var->size);
+    var->name  = name;
+    var->entry = entry;
+    if (var->env >= 0) v->envp[var->env] = entry;
+  }
+
+  arena_free(&v->arena);
+  v->arena = fresh;
+  v->dead  = 0;
+}
+
+// The environment for commands, rebuilt only if a variable has joined or
+// left it since the last call.
+char **vars_environ(vars_t *v) {
+  if (v->envp && v->built == v->generation) return v->envp;
+
+  size_t count = 0;
+  for (size_t i = 0; i < v->capacity; i++) {
+    var_t *var = &v->slots[i];
+    var->env   = -1;
+    if (var->name && var->entry && (var->flags & VAR_EXPORT)) count++;
+  }
+  if (!reserve_envp(v, count)) return NULL;
+
+  size_t n = 0;
+  for (size_t i = 0; i < v->capacity; i++) {
+    var_t *var = &v->slots[i];
+    if (!var->name || !var->entry || !(var->flags & VAR_EXPORT)) continue;
+    var->env     = (int32_t)n;
+    v->envp[n++] = var->entry;
+  }
+  v->envp[n]   = NULL;
+  v->env_count = n;
+  v->built     = v->generation;
+  return v->envp;
+}
+
+// Layers `count` "NAME=value" strings (prefix assignments) over the
+// environment for one command: an exported variable's slot is swapped for its
+// override and other names go after the last slot, so nothing is copied.
+// vars_drop_overlay puts the slots back once the command has started.
+char **vars_overlay(vars_t *v, char **entries, size_t count, arena_t *arena) {
+  char **envp = vars_environ(v);
+  if (!envp || !reserve_envp(v, v->env_count + count)) return NULL;
+  envp = v->envp;
+
+  v->swaps = arena_alloc(arena, count * sizeof(vars_swap_t));
+  if (!v->swaps) return NULL;
+
+  size_t end = v->env_count;
+  for (size_t i = 0; i < count; i++) {
+    const char *eq     = strchrnul(entries[i], '=');
+    size_t      length = eq - entries[i];
+
+    size_t slot = end;
+    if (v->capacity) {
+      var_t *var = &v->slots[find_slot(v, entries[i], length,
+                                       hash_name(entries[i], length))];
+      if (var->name && var->env >= 0) slot = var->env;
+    }
+    // A name given twice, or not yet in the environment, reuses its slot.
+    for (size_t j = v->env_count; j < end && slot == end; j++) {
+      if (strncmp(envp[j], entries[i], length + 1) == 0) slot = j;
+    }
+    if (slot == end) envp[++end] = NULL;
+
+    v->swaps[v->swap_count++] = (vars_swap_t){slot, envp[slot]};
+    envp[slot]                = entries[i];
+  }
+  return envp;
+}
+
+void vars_drop_overlay(vars_t *v) {
+  while (v->swap_count > 0) {
+    vars_swap_t *swap    = &v->swaps[--v->swap_count];
+    v->envp[swap->index] = swap->saved;
+  }
+  if (v->envp) v->envp[v->env_count] = NULL;
+  v->swaps = NULL;
+}
+
+static uint32_t hash_name(const char *name, size_t length) {
+  uint32_t h = 2166136261u; // FNV-1a
+  for (size_t i = 0; i < length; i++) {
+    h = (h ^ (unsigned char)name[i]) * 16777619u;
+  }
+  return h;
+}
+
+static size_t find_slot(const vars_t *v, const char *name, size_t length,
+                        uint32_t h) {
+  size_t mask = v->capacity - 1;
+  size_t i    = h & mask;
+  while (v->slots[i].name &&
+         (v->slots[i].hash != h || v->slots[i].length != length ||
+          memcmp(v->slots[i].name, name, length) != 0)) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+// Finds the variable or adds it with no value; the name is copied once, here.
+static var_t *declare(vars_t *v, const char *name, size_t length) {
+  uint32_t h = hash_name(name, length);
+  if (v->capacity) {
+    var_t *var = &v->slots[find_slot(v, name, length, h)];
+    if (var->name) return var;
+  }
+
+  if ((v->count + 1) * 4 > v->capacity * 3 && !grow(v)) return NULL;
+  char *copy = arena_strndup(&v->arena, name, length);
+  if (!copy) return NULL;
+
+  var_t *var  = &v->slots[find_slot(v, name, length, h)];
+  var->name   = copy;
+  var->hash   = h;
+  var->length = (uint32_t)length;
+  var->env    = -1;
+  v->count++;
+  v->live += length + 1;
+  return var;
+}
+
+// Rewrites the value in place when it fits, which keeps the envp slot (and
+// the arena) as they were; otherwise the entry moves to a larger block.
+static bool assign(vars_t *v, var_t *var, const char *value) {
+  size_t value_length = strlen(value);
+  size_t need         = var->length + 1 + value_length + 1;
+
+  if (need > var->size) {
+    size_t size  = (need + 15) & ~(size_t)15;
+    char  *entry = arena_alloc(&v->arena, size);
+    if (!entry) {
+      errno = ENOMEM;
+      return false;
+    }
+    memcpy(entry, var->name, var->length);
+    entry[var->length] = '=';
+    memcpy(entry + var->length + 1, value, value_length + 1);
+
+    v->dead += var->size;
+    v->live += size - var->size;
+    if (!var->entry && (var->flags & VAR_EXPORT)) v->generation++;
+    var->entry = entry;
+    var->size  = (uint32_t)size;
+    if (var->env >= 0) v->envp[var->env] = entry;
+    return true;
+  }
+
+  // `value` may be this variable's own value, or part of it.
+  memmove(var->entry + var->length + 1, value, value_length + 1);
+  return true;
+}
+
+static bool grow(vars_t *v) {
+  size_t capacity = v->capacity ? v->capacity * 2 : VARS_MIN_CAPACITY;
+  var_t *slots    = calloc(capacity, sizeof(var_t));
+  if (!slots) return false;
+
+  vars_t next   = *v;
+  next.slots    = slots;
+  next.capacity = capacity;
+  for (size_t i = 0; i < v->capacity; i++) {
+    var_t *var = &v->slots[i];
+    if (!var->name) continue;
+    next.slots[find_slot(&next, var->name, var->length, var->hash)] = *var;
+  }
+
+  free(v->slots);
+  *v = next;
+  return true;
+}
+
+// Room for `count` entries, the terminator and an overlay's extra names.
+static bool reserve_envp(vars_t *v, size_t count) {
+  if (v->envp && count + 2 <= v->env_capacity) return true;
+
+  size_t capacity = count + 2 + VARS_ENVP_SPARE;
+  char **envp     = realloc(v->envp, capacity * sizeof(char *));
+  if (!envp) return false;
+  v->envp         = envp;
+  v->env_capacity = capacity;
+  return true;
+}
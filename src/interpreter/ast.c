@@ -0,0 +1,359 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "interpreter/ast.h"
+
+static bool      pool_grow(void **items, uint32_t *capacity, size_t elem_size);
+static ast_ref_t new_node(ast_t *ast, ast_type_t type);
+static void      dump_node(const ast_t *ast, ast_ref_t ref, int depth);
+static void      dump_redirs(const ast_t *ast, ast_range_t range, int indent);
+
+#define POOL_PUSH(pool, value)                                                 \
+  (((pool).length < (pool).capacity ||                                         \
+    pool_grow((void **)&(pool).items, &(pool).capacity,                        \
+              sizeof(*(pool).items))) &&                                       \
+   ((pool).items[(pool).length++] = (value), true))
+
+#define POOL_FREE(pool)                                                        \
+  do {                                                                         \
+    free((pool).items);                                                        \
+    (pool).items    = NULL;                                                    \
+    (pool).length   = 0;                                                       \
+    (pool).capacity = 0;                                                       \
+  } while (0)
+
+void ast_init(ast_t *ast, arena_t *arena) {
+  *ast       = (ast_t){0};
+  ast->arena = arena;
+}
+
+void ast_free(ast_t *ast) {
+  POOL_FREE(ast->nodes);
+  POOL_FREE(ast->args);
+  POOL_FREE(ast->parts);
+  POOL_FREE(ast->assigns);
+  POOL_FREE(ast->redirs);
+  POOL_FREE(ast->stages);
+  POOL_FREE(ast->scratch);
+  POOL_FREE(ast->items);
+  POOL_FREE(ast->open_items);
+}
+
+void ast_reset(ast_t *ast) {
+  ast->nodes.length      = 0;
+  ast->args.length       = 0;
+  ast->parts.length      = 0;
+  ast->assigns.length    = 0;
+  ast->redirs.length     = 0;
+  ast->stages.length     = 0;
+  ast->scratch.length    = 0;
+  ast->items.length      = 0;
+  ast->open_items.length = 0;
+}
+
+ast_ref_t ast_add_binary(ast_t *ast, ast_type_t type, ast_ref_t left,
+                         ast_ref_t right) {
+  ast_ref_t ref = new_node(ast, type);
+  if (ref == AST_NULL) return AST_NULL;
+  ast_node(ast, ref)->u.binary.left  = left;
+  ast_node(ast, ref)->u.binary.right = right;
+  return ref;
+}
+
+ast_ref_t ast_add_unary(ast_t *ast, ast_type_t type, ast_ref_t child) {
+  ast_ref_t ref = new_node(ast, type);
+  if (ref == AST_NULL) return AST_NULL;
+  if (type == AST_BACKGROUND) {
+    ast_node(ast, ref)->u.background.child = child;
+  } else if (type == AST_NOT) {
+    ast_node(ast, ref)->u.negation.child = child;
+  } else {
+    ast_node(ast, ref)->u.subshell.child = child;
+  }
+  return ref;
+}
+
+ast_ref_t ast_begin_simple(ast_t *ast) {
+  ast_ref_t ref = new_node(ast, AST_SIMPLE);
+  if (ref == AST_NULL) return AST_NULL;
+  ast_node_t *node       = ast_node(ast, ref);
+  node->u.simple.assigns = (ast_range_t){ast->assigns.length, 0};
+  node->u.simple.args    = (ast_range_t){ast->args.length, 0};
+  node->u.simple.redirs  = (ast_range_t){ast->redirs.length, 0};
+  return ref;
+}
+
+bool ast_simple_add_arg(ast_t *ast, ast_ref_t simple, ast_word_t arg) {
+  if (!POOL_PUSH(ast->args, arg)) return false;
+  ast_node(ast, simple)->u.simple.args.count++;
+  return true;
+}
+
+bool ast_simple_add_assign(ast_t *ast, ast_ref_t simple,
+                           ast_assignment_t assign) {
+  if (!POOL_PUSH(ast->assigns, assign)) return false;
+  ast_node(ast, simple)->u.simple.assigns.count++;
+  return true;
+}
+
+bool ast_simple_add_redir(ast_t *ast, ast_ref_t simple, ast_redir_t redir) {
+  if (!POOL_PUSH(ast->redirs, redir)) return false;
+  ast_node(ast, simple)->u.simple.redirs.count++;
+  return true;
+}
+
+// Stages of nested pipelines (inside subshells) interleave while parsing, so
+// they are stacked in `scratch` and copied out contiguously once complete.
+uint32_t ast_begin_pipeline(ast_t *ast) { return ast->scratch.length; }
+
+bool ast_pipeline_add_stage(ast_t *ast, ast_ref_t stage) {
+  return POOL_PUSH(ast->scratch, stage);
+}
+
+ast_ref_t ast_end_pipeline(ast_t *ast, uint32_t mark) {
+  ast_ref_t ref = new_node(ast, AST_PIPELINE);
+  if (ref == AST_NULL) return AST_NULL;
+
+  ast_range_t stages = {ast->stages.length, ast->scratch.length - mark};
+  for (uint32_t i = mark; i < ast->scratch.length; i++) {
+    if (!POOL_PUSH(ast->stages, ast->scratch.items[i])) return AST_NULL;
+  }
+  ast->scratch.length = mark;
+
+  ast_node(ast, ref)->u.pipeline.stages = stages;
+  return ref;
+}
+
+// A word's parts are collected while its nested words are still being
+// parsed, so they are appended in one go once the word is complete.
+bool ast_add_parts(ast_t *ast, const ast_part_t *parts, uint32_t count,
+                   ast_range_t *range) {
+  *range = (ast_range_t){ast->parts.length, count};
+  for (uint32_t i = 0; i < count; i++) {
+    if (!POOL_PUSH(ast->parts, parts[i])) return false;
+  }
+  return true;
+}
+
+ast_ref_t ast_add_if(ast_t *ast, ast_ref_t cond, ast_ref_t then_part,
+                     ast_ref_t else_part) {
+  ast_ref_t ref = new_node(ast, AST_IF);
+  if (ref == AST_NULL) return AST_NULL;
+  ast_node_t *node            = ast_node(ast, ref);
+  node->u.if_clause.redirs    = (ast_range_t){ast->redirs.length, 0};
+  node->u.if_clause.cond      = cond;
+  node->u.if_clause.then_part = then_part;
+  node->u.if_clause.else_part = else_part;
+  return ref;
+}
+
+ast_ref_t ast_add_loop(ast_t *ast, ast_type_t type, ast_ref_t cond,
+                       ast_ref_t body) {
+  ast_ref_t ref = new_node(ast, type);
+  if (ref == AST_NULL) return AST_NULL;
+  ast_node_t *node    = ast_node(ast, ref);
+  node->u.loop.redirs = (ast_range_t){ast->redirs.length, 0};
+  node->u.loop.cond   = cond;
+  node->u.loop.body   = body;
+  return ref;
+}
+
+ast_ref_t ast_add_for(ast_t *ast, ast_range_t words, ast_ref_t body) {
+  ast_ref_t ref = new_node(ast, AST_FOR);
+  if (ref == AST_NULL) return AST_NULL;
+  ast_node_t *node          = ast_node(ast, ref);
+  node->u.for_clause.redirs = (ast_range_t){ast->redirs.length, 0};
+  node->u.for_clause.words  = words;
+  node->u.for_clause.body   = body;
+  return ref;
+}
+
+ast_range_t ast_begin_words(const ast_t *ast) {
+  return (ast_range_t){ast->args.length, 0};
+}
+
+bool ast_add_word(ast_t *ast, ast_range_t *words, ast_word_t word) {
+  if (!POOL_PUSH(ast->args, word)) return false;
+  words->count++;
+  return true;
+}
+
+// A case item is complete once its body is, by which time the items of any
+// case inside that body have been added; so, as with pipeline stages, items
+// wait in `open_items` and are copied out together at the end.
+uint32_t ast_begin_case(ast_t *ast) { return ast->open_items.length; }
+
+bool ast_case_add_item(ast_t *ast, ast_case_item_t item) {
+  return POOL_PUSH(ast->open_items, item);
+}
+
+ast_ref_t ast_end_case(ast_t *ast, uint32_t mark, uint32_t subject) {
+  ast_ref_t ref = new_node(ast, AST_CASE);
+  if (ref == AST_NULL) return AST_NULL;
+
+  ast_range_t items = {ast->items.length, ast->open_items.length - mark};
+  for (uint32_t i = mark; i < ast->open_items.length; i++) {
+    if (!POOL_PUSH(ast->items, ast->open_items.items[i])) return AST_NULL;
+  }
+  ast->open_items.length = mark;
+
+  ast_node_t *node               = ast_node(ast, ref);
+  node->u.case_clause.redirs  = (ast_range_t){ast->redirs.length, 0};
+  node->u.case_clause.items   = items;
+  node->u.case_clause.subject = subject;
+  return ref;
+}
+
+// Redirections follow the compound command's closing word, so they are the
+// last thing added for it.
+bool ast_compound_add_redir(ast_t *ast, ast_ref_t compound,
+                            ast_redir_t redir) {
+  ast_range_t *redirs = &ast_node(ast, compound)->u.compound.redirs;
+  if (redirs->count == 0) redirs->start = ast->redirs.length;
+  if (!POOL_PUSH(ast->redirs, redir)) return false;
+  redirs->count++;
+  return true;
+}
+
+void ast_dump(const ast_t *ast, ast_ref_t root) { dump_node(ast, root, 0); }
+
+static bool pool_grow(void **items, uint32_t *capacity, size_t elem_size) {
+  uint32_t next  = *capacity ? *capacity * 2 : 16;
+  void    *grown = realloc(*items, (size_t)next * elem_size);
+  if (!grown) return false;
+  *items    = grown;
+  *capacity = next;
+  return true;
+}
+
+static ast_ref_t new_node(ast_t *ast, ast_type_t type) {
+  ast_node_t node = {.type = type};
+  if (!POOL_PUSH(ast->nodes, node)) return AST_NULL;
+  return ast->nodes.length - 1;
+}
+
+// The operator as written, `>>` for REDIR_OUT_APPEND and so on.
+const char *ast_redir_op(ast_redir_type_t type) {
+  switch (type) {
+    case REDIR_IN: return "<";
+    case REDIR_OUT: return ">";
+    case REDIR_OUT_APPEND: return ">>";
+    case REDIR_HERE_DOC: return "<<";
+    case REDIR_HERE_STRIP: return "<<-";
+    case REDIR_DUP_IN: return "<&";
+    case REDIR_DUP_OUT: return ">&";
+    case REDIR_READWRITE: return "<>";
+    case REDIR_CLOBBER: return ">|";
+  }
+  return "?";
+}
+
+static void dump_node(const ast_t *ast, ast_ref_t ref, int depth) {
+  int indent = depth * 2;
+  if (ref == AST_NULL) {
+    printf("%*s(null)\n", indent, "");
+    return;
+  }
+
+  const ast_node_t *node = ast_node(ast, ref);
+  switch (node->type) {
+    case AST_SIMPLE: {
+      printf("%*sSIMPLE\n", indent, "");
+      ast_assignment_t *assigns = ast_assigns(ast, node->u.simple.assigns);
+      for (uint32_t i = 0; i < node->u.simple.assigns.count; i++) {
+        printf("%*sassign %s=%s\n", indent + 2, "", assigns[i].name,
+               assigns[i].value.text);
+      }
+      ast_word_t *args = ast_args(ast, node->u.simple.args);
+      for (uint32_t i = 0; i < node->u.simple.args.count; i++) {
+        printf("%*sarg %s\n", indent + 2, "", args[i].text);
+      }
+      dump_redirs(ast, node->u.simple.redirs, indent + 2);
+      break;
+    }
+    case AST_PIPELINE: {
+      printf("%*sPIPELINE\n", indent, "");
+      ast_ref_t *stages = ast_stages(ast, node->u.pipeline.stages);
+      for (uint32_t i = 0; i < node->u.pipeline.stages.count; i++) {
+        dump_node(ast, stages[i], depth + 1);
+      }
+      break;
+    }
+    case AST_SEQUENCE:
+    case AST_AND:
+    case AST_OR:
+      printf("%*s%s\n", indent, "",
+             node->type == AST_SEQUENCE ? "SEQUENCE"
+             : node->type == AST_AND    ? "AND"
+                                        : "OR");
+      dump_node(ast, node->u.binary.left, depth + 1);
+      dump_node(ast, node->u.binary.right, depth + 1);
+      break;
+    case AST_BACKGROUND:
+      printf("%*sBACKGROUND\n", indent, "");
+      dump_node(ast, node->u.background.child, depth + 1);
+      break;
+    case AST_SUBSHELL:
+      printf("%*sSUBSHELL\n", indent, "");
+      dump_node(ast, node->u.subshell.child, depth + 1);
+      break;
+    case AST_NOT:
+      printf("%*sNOT\n", indent, "");
+      dump_node(ast, node->u.negation.child, depth + 1);
+      break;
+    case AST_IF:
+      printf("%*sIF\n", indent, "");
+      dump_node(ast, node->u.if_clause.cond, depth + 1);
+      printf("%*sTHEN\n", indent, "");
+      dump_node(ast, node->u.if_clause.then_part, depth + 1);
+      if (node->u.if_clause.else_part != AST_NULL) {
+        printf("%*sELSE\n", indent, "");
+        dump_node(ast, node->u.if_clause.else_part, depth + 1);
+      }
+      break;
+    case AST_WHILE:
+    case AST_UNTIL:
+      printf("%*s%s\n", indent, "",
+             node->type == AST_WHILE ? "WHILE" : "UNTIL");
+      dump_node(ast, node->u.loop.cond, depth + 1);
+      printf("%*sDO\n", indent, "");
+      dump_node(ast, node->u.loop.body, depth + 1);
+      break;
+    case AST_FOR: {
+      ast_word_t *words = ast_args(ast, node->u.for_clause.words);
+      printf("%*sFOR %s\n", indent, "", words[0].text);
+      for (uint32_t i = 1; i < node->u.for_clause.words.count; i++) {
+        printf("%*sword %s\n", indent + 2, "", words[i].text);
+      }
+      printf("%*sDO\n", indent, "");
+      dump_node(ast, node->u.for_clause.body, depth + 1);
+      break;
+    }
+    case AST_CASE: {
+      printf("%*sCASE %s\n", indent, "",
+             ast->args.items[node->u.case_clause.subject].text);
+      ast_case_item_t *items = ast_items(ast, node->u.case_clause.items);
+      for (uint32_t i = 0; i < node->u.case_clause.items.count; i++) {
+        ast_word_t *patterns = ast_args(ast, items[i].patterns);
+        for (uint32_t j = 0; j < items[i].patterns.count; j++) {
+          printf("%*spattern %s\n", indent + 2, "", patterns[j].text);
+        }
+        if (items[i].body != AST_NULL) dump_node(ast, items[i].body, depth + 2);
+      }
+      break;
+    }
+  }
+  if (ast_is_compound(node->type)) {
+    dump_redirs(ast, node->u.compound.redirs, indent + 2);
+  }
+}
+
+static void dump_redirs(const ast_t *ast, ast_range_t range, int indent) {
+  ast_redir_t *redirs = ast_redirs(ast, range);
+  for (uint32_t i = 0; i < range.count; i++) {
+    printf("%*sredir %d%s %s\n", indent, "", redirs[i].fd,
+           ast_redir_op(redirs[i].type), redirs[i].target.text);
+  }
+}
@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "interpreter/charclass.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CC_X86 1
+#include <immintrin.h>
+#endif
+
+// clang-format off
+const unsigned char cc_table[256] = {
+    0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x22, 0x00, 0x00, 0x21, 0x00, 0x00, // 00
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 10
+    0x21, 0x00, 0x80, 0x00, 0x80, 0x00, 0x30, 0x80, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 20
+    0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x20, 0x30, 0x00, 0x30, 0x00, // 30
+    0x00, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, // 40
+    0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x80, 0x00, 0x00, 0x04, // 50
+    0x80, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, // 60
+    0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x30, 0x00, 0x00, 0x00, // 70
+    // 0x80..0xff: no class
+};
+// clang-format on
+
+static const char *skip_blanks_scalar(const char *p, const char *end) {
+  while (p < end && (cc_class(*p) & CC_BLANK)) p++;
+  return p;
+}
+
+static const char *span_name_scalar(const char *p, const char *end) {
+  while (p < end && (cc_class(*p) & (CC_ALPHA | CC_DIGIT))) p++;
+  return p;
+}
+
+static const char *span_digits_scalar(const char *p, const char *end) {
+  while (p < end && (cc_class(*p) & CC_DIGIT)) p++;
+  return p;
+}
+
+static const char *span_word_scalar(const char *p, const char *end) {
+  while (p < end && !(cc_class(*p) & (CC_BREAK | CC_QUOTE))) p++;
+  return p;
+}
+
+cc_ops_t cc_ops = {
+    skip_blanks_scalar, span_name_scalar, span_digits_scalar,
+    span_word_scalar,   "scalar",
+};
+
+#ifdef CC_X86
+
+// Each kernel classifies a block into a byte mask of "still inside the run"
+// and stops at the first clear bit; the tail shorter than a block is left to
+// the scalar loop so no load ever crosses `end`.
+
+#define SSE_SET(c) _mm_set1_epi8((char)(c))
+#define AVX_SET(c) _mm256_set1_epi8((char)(c))
+
+// v in [lo, hi] as unsigned bytes, using the signed compare SSE2 provides.
+#define SSE_RANGE(v, lo, hi)                                                   \
+  _mm_cmpgt_epi8(SSE_SET(-128 + (hi) - (lo) + 1),                              \
+                 _mm_add_epi8((v), SSE_SET(0x80 - (lo))))
+#define AVX_RANGE(v, lo, hi)                                                   \
+  _mm256_cmpgt_epi8(AVX_SET(-128 + (hi) - (lo) + 1),                           \
+                    _mm256_add_epi8((v), AVX_SET(0x80 - (lo))))
+
+__attribute__((target("sse2"))) static inline __m128i sse_blank(__m128i v) {
+  return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, SSE_SET(' ')),
+                                   _mm_cmpeq_epi8(v, SSE_SET('\t'))),
+                      _mm_cmpeq_epi8(v, SSE_SET('\r')));
+}
+
+__attribute__((target("sse2"))) static inline __m128i sse_digit(__m128i v) {
+  return SSE_RANGE(v, '0', '9');
+}
+
+__attribute__((target("sse2"))) static inline __m128i sse_name(__m128i v) {
+  __m128i lower = _mm_or_si128(v, SSE_SET(0x20));
+  return _mm_or_si128(_mm_or_si128(SSE_RANGE(lower, 'a', 'z'), sse_digit(v)),
+                      _mm_cmpeq_epi8(v, SSE_SET('_')));
+}
+
+__attribute__((target("sse2"))) static inline __m128i sse_break(__m128i v) {
+  __m128i m = _mm_or_si128(sse_blank(v), _mm_cmpeq_epi8(v, SSE_SET('\n')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET('\0')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET('|')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET('&')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET(';')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET('<')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET('>')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET('(')));
+  return _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET(')')));
+}
+
+__attribute__((target("sse2"))) static inline __m128i sse_quote(__m128i v) {
+  __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, SSE_SET('\'')),
+                           _mm_cmpeq_epi8(v, SSE_SET('"')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET('\\')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET('`')));
+  return _mm_or_si128(m, _mm_cmpeq_epi8(v, SSE_SET('$')));
+}
+
+__attribute__((target("sse2"))) static inline __m128i sse_stop(__m128i v) {
+  return _mm_or_si128(sse_break(v), sse_quote(v));
+}
+
+__attribute__((target("avx2"))) static inline __m256i avx_blank(__m256i v) {
+  return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, AVX_SET(' ')),
+                                         _mm256_cmpeq_epi8(v, AVX_SET('\t'))),
+                         _mm256_cmpeq_epi8(v, AVX_SET('\r')));
+}
+
+__attribute__((target("avx2"))) static inline __m256i avx_digit(__m256i v) {
+  return AVX_RANGE(v, '0', '9');
+}
+
+__attribute__((target("avx2"))) static inline __m256i avx_name(__m256i v) {
+  __m256i lower = _mm256_or_si256(v, AVX_SET(0x20));
+  return _mm256_or_si256(
+      _mm256_or_si256(AVX_RANGE(lower, 'a', 'z'), avx_digit(v)),
+      _mm256_cmpeq_epi8(v, AVX_SET('_')));
+}
+
+__attribute__((target("avx2"))) static inline __m256i avx_break(__m256i v) {
+  __m256i m = _mm256_or_si256(avx_blank(v), _mm256_cmpeq_epi8(v, AVX_SET('\n')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET('\0')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET('|')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET('&')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET(';')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET('<')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET('>')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET('(')));
+  return _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET(')')));
+}
+
+__attribute__((target("avx2"))) static inline __m256i avx_quote(__m256i v) {
+  __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, AVX_SET('\'')),
+                              _mm256_cmpeq_epi8(v, AVX_SET('"')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET('\\')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET('`')));
+  return _mm256_or_si256(m, _mm256_cmpeq_epi8(v, AVX_SET('$')));
+}
+
+__attribute__((target("avx2"))) static inline __m256i avx_stop(__m256i v) {
+  return _mm256_or_si256(avx_break(v), avx_quote(v));
+}
+
+// IN_RUN(v) yields 0xff for bytes that continue the run; STOP(v) yields 0xff
+// for bytes that end it. Exactly one of the two is given per kernel.
+#define SSE_KERNEL(fn, CLASSIFY, INVERT, scalar)                               \
+  __attribute__((target("sse2"))) static const char *fn(const char *p,        \
+                                                        const char *end) {    \
+    while (end - p >= 16) {                                                    \
+      __m128i  v    = _mm_loadu_si128((const __m128i *)p);                     \
+      unsigned bits = (unsigned)_mm_movemask_epi8(CLASSIFY(v));                \
+      if (INVERT) bits = ~bits & 0xffffu;                                      \
+      if (bits) return p + __builtin_ctz(bits);                                \
+      p += 16;                                                                 \
+    }                                                                          \
+    return scalar(p, end);                                                     \
+  }
+
+#define AVX_KERNEL(fn, CLASSIFY, INVERT, scalar)                               \
+  __attribute__((target("avx2"))) static const char *fn(const char *p,        \
+                                                        const char *end) {    \
+    while (end - p >= 32) {                                                    \
+      __m256i  v    = _mm256_loadu_si256((const __m256i *)p);                  \
+      unsigned bits = (unsigned)_mm256_movemask_epi8(CLASSIFY(v));             \
+      if (INVERT) bits = ~bits;                                                \
+      if (bits) return p + __builtin_ctz(bits);                                \
+      p += 32;                                                                 \
+    }                                                                          \
+    return scalar(p, end);                                                     \
+  }
+
+SSE_KERNEL(skip_blanks_sse2, sse_blank, 1, skip_blanks_scalar)
+SSE_KERNEL(span_name_sse2, sse_name, 1, span_name_scalar)
+SSE_KERNEL(span_digits_sse2, sse_digit, 1, span_digits_scalar)
+SSE_KERNEL(span_word_sse2, sse_stop, 0, span_word_scalar)
+
+AVX_KERNEL(skip_blanks_avx2, avx_blank, 1, skip_blanks_scalar)
+AVX_KERNEL(span_name_avx2, avx_name, 1, span_name_scalar)
+AVX_KERNEL(span_digits_avx2, avx_digit, 1, span_digits_scalar)
+AVX_KERNEL(span_word_avx2, avx_stop, 0, span_word_scalar)
+
+#endif // CC_X86
+
+// TINY_SIMD=scalar|sse2|avx2 forces a backend, mostly for comparing outputs.
+void cc_init(void) {
+  static int done = 0;
+  if (done) return;
+  done = 1;
+
+#ifdef CC_X86
+  const char *force = getenv("TINY_SIMD");
+  __builtin_cpu_init();
+
+  if (force && strcmp(force, "scalar") == 0) return;
+
+  if ((!force || strcmp(force, "avx2") == 0) &&
+      __builtin_cpu_supports("avx2")) {
+    cc_ops = (cc_ops_t){skip_blanks_avx2, span_name_avx2, span_digits_avx2,
+                        span_word_avx2, "avx2"};
+    return;
+  }
+
+  if (__builtin_cpu_supports("sse2")) {
+    cc_ops = (cc_ops_t){skip_blanks_sse2, span_name_sse2, span_digits_sse2,
+                        span_word_sse2, "sse2"};
+  }
+#endif
+}
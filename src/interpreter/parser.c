@@ -5,46 +5,126 @@
 #include <string.h>
 
 #include "allocators/arena.h"
-#include "collections/vector.h"
 #include "interpreter/ast.h"
+#include "interpreter/charclass.h"
 #include "interpreter/parser.h"
 #include "interpreter/scanner.h"
+#include "interpreter/word.h"
 
 static void             advance(parser_t *parser);
-static ast_node_t      *parse_list(parser_t *parser);
-static ast_node_t      *parse_and_or(parser_t *parser);
-static ast_node_t      *parse_pipeline(parser_t *parser);
-static ast_node_t      *parse_command(parser_t *parser);
-static ast_node_t      *parse_simple(parser_t *parser);
+static bool             match(parser_t *parser, token_type_t want);
+static token_type_t     reserved(parser_t *parser);
+static bool             match_reserved(parser_t *parser, token_type_t want);
+static bool             expect_reserved(parser_t *parser, token_type_t want,
+                                        const char *message);
+static bool             list_ends(parser_t *parser, bool top_level);
+static void             skip_newlines(parser_t *parser);
+static ast_ref_t        parse_list(parser_t *parser, bool top_level);
+static ast_ref_t        append_item(parser_t *parser, ast_ref_t list,
+                                     ast_ref_t item);
+static ast_ref_t        parse_and_or(parser_t *parser);
+static ast_ref_t        parse_pipeline(parser_t *parser);
+static ast_ref_t        parse_command(parser_t *parser);
+static ast_ref_t        parse_simple(parser_t *parser);
+static ast_ref_t        parse_if(parser_t *parser);
+static ast_ref_t        parse_loop(parser_t *parser);
+static ast_ref_t        parse_for(parser_t *parser);
+static ast_ref_t        parse_case(parser_t *parser);
+static ast_ref_t        parse_do_group(parser_t *parser);
+static bool             parse_redirs(parser_t *parser, ast_ref_t node);
+static bool             parse_redir(parser_t *parser, ast_redir_t *redir);
+static bool             parse_word(parser_t *parser, const token_t *tok,
+                                   size_t skip, ast_word_t *word);
+static void             expect_heredoc(parser_t *parser);
+static void             attach_heredocs(parser_t *parser);
 static bool             is_redir_tok(token_type_t t);
+static int              parse_io_number(parser_t *parser, const token_t *tok);
 static ast_redir_type_t map_token_to_redir_type(token_type_t op);
 
-void parser_init(parser_t *parser, scanner_t *scanner, arena_t *arena) {
+void parser_init(parser_t *parser, scanner_t *scanner, ast_t *ast) {
   parser->scanner   = scanner;
+  parser->head      = 0;
+  parser->buffered  = 0;
   parser->cur       = NULL;
   parser->prev      = NULL;
-  parser->arena     = arena;
+  parser->ast       = ast;
+  parser->arena     = ast->arena;
   parser->had_error = false;
 
+  parser->here_first = 0;
+  parser->here_count = 0;
+
   advance(parser);
 }
 
-ast_node_t *parser_parse(parser_t *parser) {
-  ast_node_t *root = parse_list(parser);
-  if (parser->had_error) return NULL;
-  if (parser->cur != NULL) {
+// Parses the whole input as one command list.
+ast_ref_t parser_parse(parser_t *parser) {
+  ast_ref_t root = AST_NULL;
+  ast_ref_t command;
+
+  while ((command = parser_next(parser)) != AST_NULL) {
+    root = root == AST_NULL
+               ? command
+               : ast_add_binary(parser->ast, AST_SEQUENCE, root, command);
+    if (root == AST_NULL) {
+      parser_error(parser, "Out of memory (parser_parse)");
+      return AST_NULL;
+    }
+  }
+  return parser->had_error ? AST_NULL : root;
+}
+
+// Parses one complete command: a list terminated by a newline or the end of
+// input. Blank lines are skipped. Returns AST_NULL at the end of input or on
+// error (check `had_error`), so a caller can execute each command before the
+// next one is parsed, as a script must.
+//
+// The terminating newline is left as `cur`: consuming it would scan the next
+// token, which on a pipe can block until the writer sends more.
+ast_ref_t parser_next(parser_t *parser) {
+  // Earlier commands are fully copied into the AST; their text can go.
+  if (parser->cur) scanner_release(parser->scanner, parser->cur->span.start);
+
+  skip_newlines(parser);
+  if (parser->had_error || parser->cur == NULL) return AST_NULL;
+
+  ast_ref_t command = parse_list(parser, true);
+  if (parser->had_error) return AST_NULL;
+  if (parser->cur != NULL && parser->cur->type != TOK_NEWLINE) {
     parser_error(parser, "Unexpected input after end of command");
-    return NULL;
+    return AST_NULL;
   }
-  return root;
+  return command;
+}
+
+// Whether the input holds no command after the one parser_next returned.
+// Finding out scans past the newline, so callers only ask when the input is
+// all there already, as with a file or a -c string.
+bool parser_at_end(parser_t *parser) {
+  skip_newlines(parser);
+  return !parser->had_error && parser->cur == NULL;
+}
+
+// Returns the token `n` places after `cur` (0 is `cur` itself), scanning into
+// the ring as needed. Past the end of input the token's type is TOK_EOF.
+token_t *parser_peek(parser_t *parser, unsigned n) {
+  while (parser->buffered <= n) {
+    unsigned slot = (parser->head + parser->buffered) & (PARSER_RING_SIZE - 1);
+    next_token(parser->scanner, &parser->ring[slot]);
+    parser->buffered++;
+  }
+  return &parser->ring[(parser->head + n) & (PARSER_RING_SIZE - 1)];
 }
 
 void parser_error(parser_t *parser, const char *message) {
   token_t *blame = parser->cur ? parser->cur : parser->prev;
   fprintf(stderr, "tiny: %s\n", message);
   if (blame) {
-    fprintf(stderr, "Syntax error at line %u, column %u (near '%s')\n",
-            blame->row, blame->column, blame->lexeme);
+    unsigned int row, col;
+    scanner_locate(parser->scanner, blame->span.start, &row, &col);
+    fprintf(stderr, "Syntax error at line %u, column %u (near '%.*s')\n",
+            row, col, (int)token_length(blame),
+            token_lexeme(parser->scanner, blame));
   }
   parser->had_error = true;
   parser_synchronize(parser);
@@ -76,7 +156,14 @@ void parser_synchronize(parser_t *parser) {
 
 static void advance(parser_t *parser) {
   parser->prev = parser->cur;
-  parser->cur  = next_token(parser->scanner);
+  if (parser->buffered) {
+    parser->head = (parser->head + 1) & (PARSER_RING_SIZE - 1);
+    parser->buffered--;
+  }
+
+  token_t *tok = parser_peek(parser, 0);
+  parser->cur  = tok->type == TOK_EOF ? NULL : tok;
+  if (parser->here_count) attach_heredocs(parser);
 }
 
 static bool match(parser_t *parser, token_type_t want) {
@@ -97,70 +184,112 @@ static token_t *consume(parser_t *parser, token_type_t want,
   return NULL;
 }
 
-static ast_node_t *parse_list(parser_t *parser) {
-  ast_node_t *left = parse_and_or(parser);
+// The type of `cur`, taking a word spelled as a reserved word for one. Only
+// asked where a reserved word may stand.
+static token_type_t reserved(parser_t *parser) {
+  if (!parser->cur) return TOK_EOF;
+  return scanner_reserved(parser->scanner, parser->cur);
+}
+
+static bool match_reserved(parser_t *parser, token_type_t want) {
+  if (reserved(parser) != want) return false;
+  advance(parser);
+  return true;
+}
 
-  while (match(parser, TOK_SEMI) || match(parser, TOK_NEWLINE) ||
-         match(parser, TOK_AMP)) {
-    token_type_t sep = parser->prev->type;
-    if (sep == TOK_AMP) {
-      ast_node_t *bg = arena_alloc(parser->arena, sizeof(ast_node_t));
-      if (!bg) {
+static bool expect_reserved(parser_t *parser, token_type_t want,
+                            const char *message) {
+  if (match_reserved(parser, want)) return true;
+  parser_error(parser, message);
+  return false;
+}
+
+// A top-level list stops at a newline; inside parentheses or a compound
+// command newlines separate commands like `;`. Either may end with a
+// separator.
+static ast_ref_t parse_list(parser_t *parser, bool top_level) {
+  if (!top_level) skip_newlines(parser);
+  ast_ref_t list = AST_NULL;
+  ast_ref_t item = parse_and_or(parser);
+
+  // `&` backgrounds only the and-or list in front of it, so each item is
+  // wrapped before it joins the sequence.
+  while (match(parser, TOK_SEMI) || match(parser, TOK_AMP) ||
+         (!top_level && match(parser, TOK_NEWLINE))) {
+    if (parser->prev->type == TOK_AMP) {
+      item = ast_add_unary(parser->ast, AST_BACKGROUND, item);
+      if (item == AST_NULL) {
         parser_error(parser, "Out of memory (parse_list)");
-        return NULL;
+        return AST_NULL;
       }
-      bg->type               = AST_BACKGROUND;
-      bg->u.background.child = left;
-      left                   = bg;
     }
 
-    ast_node_t *right = parse_and_or(parser);
+    if (!top_level) skip_newlines(parser);
+    if (list_ends(parser, top_level)) break;
 
-    ast_node_t *seq = arena_alloc(parser->arena, sizeof(ast_node_t));
-    if (!seq) {
-      parser_error(parser, "Out of memory (parse_list)");
-      return NULL;
-    }
-    seq->type           = AST_SEQUENCE;
-    seq->u.binary.left  = left;
-    seq->u.binary.right = right;
-    left                = seq;
+    list = append_item(parser, list, item);
+    if (parser->had_error) return AST_NULL;
+    item = parse_and_or(parser);
   }
 
-  return left;
+  return append_item(parser, list, item);
+}
+
+static ast_ref_t append_item(parser_t *parser, ast_ref_t list,
+                             ast_ref_t item) {
+  if (list == AST_NULL) return item;
+  list = ast_add_binary(parser->ast, AST_SEQUENCE, list, item);
+  if (list == AST_NULL) parser_error(parser, "Out of memory (parse_list)");
+  return list;
+}
+
+// Any list also stops at what closes a part of a compound command; where
+// nothing is open, parser_next reports it.
+static bool list_ends(parser_t *parser, bool top_level) {
+  switch (reserved(parser)) {
+    case TOK_EOF:
+    case TOK_R_PAREN:
+    case TOK_DSEMI:
+    case TOK_THEN:
+    case TOK_ELSE:
+    case TOK_ELIF:
+    case TOK_FI:
+    case TOK_DO:
+    case TOK_DONE:
+    case TOK_ESAC: return true;
+    case TOK_NEWLINE: return top_level;
+    default: return false;
+  }
+}
+
+static void skip_newlines(parser_t *parser) {
+  while (match(parser, TOK_NEWLINE)) {
+  }
 }
 
-static ast_node_t *parse_and_or(parser_t *parser) {
-  ast_node_t *left = parse_pipeline(parser);
+static ast_ref_t parse_and_or(parser_t *parser) {
+  ast_ref_t left = parse_pipeline(parser);
 
   for (;;) {
     if (match(parser, TOK_AND_IF)) {
-      ast_node_t *right = parse_pipeline(parser);
+      skip_newlines(parser);
+      ast_ref_t right = parse_pipeline(parser);
 
-      ast_node_t *node = arena_alloc(parser->arena, sizeof(ast_node_t));
-      if (!node) {
+      left = ast_add_binary(parser->ast, AST_AND, left, right);
+      if (left == AST_NULL) {
         parser_error(parser, "Out of memory (parse_and_or)");
-        return NULL;
+        return AST_NULL;
       }
-      node->type           = AST_AND;
-      node->u.binary.left  = left;
-      node->u.binary.right = right;
-
-      left = node;
       continue;
     } else if (match(parser, TOK_OR_IF)) {
-      ast_node_t *right = parse_pipeline(parser);
+      skip_newlines(parser);
+      ast_ref_t right = parse_pipeline(parser);
 
-      ast_node_t *node = arena_alloc(parser->arena, sizeof(ast_node_t));
-      if (!node) {
-        parser_error(parser, "Out of memory (parser_and_or)");
-        return NULL;
+      left = ast_add_binary(parser->ast, AST_OR, left, right);
+      if (left == AST_NULL) {
+        parser_error(parser, "Out of memory (parse_and_or)");
+        return AST_NULL;
       }
-      node->type           = AST_OR;
-      node->u.binary.left  = left;
-      node->u.binary.right = right;
-
-      left = node;
       continue;
     } else {
       break;
@@ -170,128 +299,427 @@ static ast_node_t *parse_and_or(parser_t *parser) {
   return left;
 }
 
-static ast_node_t *parse_pipeline(parser_t *parser) {
-  ast_node_t *first = parse_command(parser);
+static ast_ref_t parse_pipeline(parser_t *parser) {
+  // `!` inverts the status of the whole pipeline after it.
+  if (match_reserved(parser, TOK_BANG)) {
+    ast_ref_t pipeline = parse_pipeline(parser);
+    ast_ref_t negation = ast_add_unary(parser->ast, AST_NOT, pipeline);
+    if (negation == AST_NULL) {
+      parser_error(parser, "Out of memory (parse_pipeline)");
+    }
+    return negation;
+  }
+
+  ast_ref_t first = parse_command(parser);
 
   if (!match(parser, TOK_PIPE)) return first;
 
-  vector_t stages;
-  vector_init(&stages, sizeof(ast_node_t *), parser->arena);
-  vector_push(&stages, first);
+  uint32_t mark = ast_begin_pipeline(parser->ast);
+  if (!ast_pipeline_add_stage(parser->ast, first)) {
+    parser_error(parser, "Out of memory (parse_pipeline)");
+    return AST_NULL;
+  }
 
   do {
-    ast_node_t *next_stage = parse_command(parser);
-    vector_push(&stages, next_stage);
+    skip_newlines(parser);
+    ast_ref_t next_stage = parse_command(parser);
+    if (!ast_pipeline_add_stage(parser->ast, next_stage)) {
+      parser_error(parser, "Out of memory (parse_pipeline)");
+      return AST_NULL;
+    }
   } while (match(parser, TOK_PIPE));
 
-  ast_node_t *pipe_node = arena_alloc(parser->arena, sizeof(ast_node_t));
-  if (!pipe_node) {
+  ast_ref_t pipe_node = ast_end_pipeline(parser->ast, mark);
+  if (pipe_node == AST_NULL) {
     parser_error(parser, "Out of memory (parse_pipeline)");
-    return NULL;
+    return AST_NULL;
   }
-  pipe_node->type              = AST_PIPELINE;
-  pipe_node->u.pipeline.stages = stages;
 
   return pipe_node;
 }
 
-static ast_node_t *parse_command(parser_t *parser) {
-  if (match(parser, TOK_L_PAREN)) {
-    ast_node_t *child = parse_list(parser);
-    consume(parser, TOK_R_PAREN, "Expect ')' after subshell");
-    ast_node_t *subshell = arena_alloc(parser->arena, sizeof(ast_node_t));
-    if (!subshell) {
-      parser_error(parser, "Out of memory (parse_command)");
-      return NULL;
+static ast_ref_t parse_command(parser_t *parser) {
+  ast_ref_t node;
+  switch (reserved(parser)) {
+    case TOK_L_PAREN: {
+      advance(parser);
+      ast_ref_t child = parse_list(parser, false);
+      consume(parser, TOK_R_PAREN, "Expect ')' after subshell");
+      ast_ref_t subshell = ast_add_unary(parser->ast, AST_SUBSHELL, child);
+      if (subshell == AST_NULL) {
+        parser_error(parser, "Out of memory (parse_command)");
+        return AST_NULL;
+      }
+      return subshell;
     }
-    subshell->type             = AST_SUBSHELL;
-    subshell->u.subshell.child = child;
-    return subshell;
-  } else {
-    return parse_simple(parser);
+    case TOK_IF: node = parse_if(parser); break;
+    case TOK_WHILE:
+    case TOK_UNTIL: node = parse_loop(parser); break;
+    case TOK_FOR: node = parse_for(parser); break;
+    case TOK_CASE: node = parse_case(parser); break;
+    default: return parse_simple(parser);
   }
+  if (node == AST_NULL || !parse_redirs(parser, node)) return AST_NULL;
+  return node;
 }
 
-static ast_node_t *parse_simple(parser_t *parser) {
-  vector_t assigns;
-  vector_t args;
-  vector_t redirs;
-
-  vector_init(&assigns, sizeof(ast_assignment_t), parser->arena);
-  vector_init(&args, sizeof(char *), parser->arena);
-  vector_init(&redirs, sizeof(ast_redir_t), parser->arena);
-
-  ast_node_t *node = arena_alloc(parser->arena, sizeof(ast_node_t));
-  if (!node) {
+static ast_ref_t parse_simple(parser_t *parser) {
+  ast_t    *ast  = parser->ast;
+  ast_ref_t node = ast_begin_simple(ast);
+  if (node == AST_NULL) {
     parser_error(parser, "Out of memory (parse_simple)");
-    return NULL;
+    return AST_NULL;
   }
-  node->type             = AST_SIMPLE;
-  node->u.simple.assigns = assigns;
-  node->u.simple.args    = args;
-  node->u.simple.redirs  = redirs;
 
   while (match(parser, TOK_ASSIGNMENT_WORD)) {
-    token_t *tok = parser->prev;
+    token_t    *tok    = parser->prev;
+    const char *lexeme = token_lexeme(parser->scanner, tok);
+    size_t      len    = token_length(tok);
 
-    char *eq = strchr(tok->lexeme, '=');
+    const char *eq = memchr(lexeme, '=', len);
     if (eq == NULL) continue;
-    *eq         = '\0';
-    char *name  = tok->lexeme;
-    char *value = eq + 1;
 
     ast_assignment_t assign;
-    assign.name  = name;
-    assign.value = value;
-    vector_push(&node->u.simple.assigns, &assign);
+    assign.name = arena_strndup(parser->arena, lexeme, eq - lexeme);
+    if (!assign.name) {
+      parser_error(parser, "Out of memory (parse_simple)");
+      return AST_NULL;
+    }
+    if (!parse_word(parser, tok, eq + 1 - lexeme, &assign.value)) {
+      return AST_NULL;
+    }
+    if (!ast_simple_add_assign(ast, node, assign)) {
+      parser_error(parser, "Out of memory (parse_simple)");
+      return AST_NULL;
+    }
   }
 
-  while (match(parser, TOK_WORD))
-    vector_push(&node->u.simple.args, parser->prev->lexeme);
+  // A reserved word out of place, such as a `fi` with no `if`, cannot be a
+  // command name; after an assignment it is not reserved.
+  token_type_t first = reserved(parser);
+  if (ast_node(ast, node)->u.simple.assigns.count == 0 && first >= TOK_IF &&
+      first != TOK_IN) {
+    parser_error(parser, "Unexpected reserved word");
+    return node;
+  }
+
+  // After the command name `NAME=value` is an ordinary argument (`export`).
+  while (match(parser, TOK_WORD) || match(parser, TOK_ASSIGNMENT_WORD)) {
+    ast_word_t word;
+    if (!parse_word(parser, parser->prev, 0, &word)) return AST_NULL;
+    if (!ast_simple_add_arg(ast, node, word)) {
+      parser_error(parser, "Out of memory (parse_simple)");
+      return AST_NULL;
+    }
+  }
 
-  if (node->u.simple.assigns.length == 0 && node->u.simple.args.length == 0) {
+  ast_node_t *simple = ast_node(ast, node);
+  if (simple->u.simple.assigns.count == 0 &&
+      simple->u.simple.args.count == 0) {
     parser_error(parser, "Expected command name or assignment");
     return node;
   }
 
-  while (parser->cur && is_redir_tok(parser->cur->type)) {
-    token_type_t op = parser->cur->type;
-    advance(parser);
+  return parse_redirs(parser, node) ? node : AST_NULL;
+}
 
-    int          fd;
-    token_type_t redir_op;
-    if (op == TOK_IO_NUMBER) {
-      fd       = atoi(parser->prev->lexeme);
-      redir_op = parser->cur->type;
-      advance(parser);
-    } else {
-      switch (op) {
-        case TOK_LESS:
-        case TOK_D_LESS:
-        case TOK_LESS_AND:
-        case TOK_LESS_GREAT:
-        case TOK_D_LESS_DASH: fd = 0; break;
-        default: fd = 1; break;
+// if list then list [elif list then list]... [else list] fi. Each elif
+// starts an AST_IF of its own in the else part, and the innermost one
+// takes the `fi`.
+static ast_ref_t parse_if(parser_t *parser) {
+  advance(parser); // `if` or `elif`
+  ast_ref_t cond = parse_list(parser, false);
+  if (parser->had_error ||
+      !expect_reserved(parser, TOK_THEN, "Expected 'then'")) {
+    return AST_NULL;
+  }
+  ast_ref_t then_part = parse_list(parser, false);
+  if (parser->had_error) return AST_NULL;
+
+  ast_ref_t else_part = AST_NULL;
+  if (reserved(parser) == TOK_ELIF) {
+    else_part = parse_if(parser);
+    if (else_part == AST_NULL) return AST_NULL;
+  } else {
+    if (match_reserved(parser, TOK_ELSE)) {
+      else_part = parse_list(parser, false);
+      if (parser->had_error) return AST_NULL;
+    }
+    if (!expect_reserved(parser, TOK_FI, "Expected 'fi'")) return AST_NULL;
+  }
+
+  ast_ref_t node = ast_add_if(parser->ast, cond, then_part, else_part);
+  if (node == AST_NULL) parser_error(parser, "Out of memory (parse_if)");
+  return node;
+}
+
+// while list do list done, and the same with until.
+static ast_ref_t parse_loop(parser_t *parser) {
+  ast_type_t type = reserved(parser) == TOK_WHILE ? AST_WHILE : AST_UNTIL;
+  advance(parser);
+  ast_ref_t cond = parse_list(parser, false);
+  if (parser->had_error) return AST_NULL;
+  ast_ref_t body = parse_do_group(parser);
+  if (body == AST_NULL) return AST_NULL;
+
+  ast_ref_t node = ast_add_loop(parser->ast, type, cond, body);
+  if (node == AST_NULL) parser_error(parser, "Out of memory (parse_loop)");
+  return node;
+}
+
+// for name [in word...]; do list done. A newline may stand in for the `;`
+// and come before `in`; with no `in` there are no words to go through.
+static ast_ref_t parse_for(parser_t *parser) {
+  ast_t *ast = parser->ast;
+  advance(parser);
+
+  ast_range_t words = ast_begin_words(ast);
+  token_t    *name  = consume(parser, TOK_WORD, "Expected a name after 'for'");
+  if (!name) return AST_NULL;
+  const char *lexeme = token_lexeme(parser->scanner, name);
+  const char *end    = lexeme + token_length(name);
+  if (!name->plain || !(cc_class(*lexeme) & CC_ALPHA) ||
+      cc_ops.span_name(lexeme, end) != end) {
+    parser_error(parser, "Bad variable name after 'for'");
+    return AST_NULL;
+  }
+
+  ast_word_t word;
+  if (!parse_word(parser, name, 0, &word)) return AST_NULL;
+  if (!ast_add_word(ast, &words, word)) {
+    parser_error(parser, "Out of memory (parse_for)");
+    return AST_NULL;
+  }
+
+  skip_newlines(parser);
+  if (match_reserved(parser, TOK_IN)) {
+    while (match(parser, TOK_WORD) || match(parser, TOK_ASSIGNMENT_WORD)) {
+      if (!parse_word(parser, parser->prev, 0, &word)) return AST_NULL;
+      if (!ast_add_word(ast, &words, word)) {
+        parser_error(parser, "Out of memory (parse_for)");
+        return AST_NULL;
       }
-      redir_op = op;
     }
+    if (!match(parser, TOK_SEMI) && !match(parser, TOK_NEWLINE)) {
+      parser_error(parser, "Expected ';' or newline after the words of 'for'");
+      return AST_NULL;
+    }
+  } else {
+    match(parser, TOK_SEMI);
+  }
+  skip_newlines(parser);
 
-    token_t *target_tok =
-        consume(parser, TOK_WORD, "Expected file name after redirection");
+  ast_ref_t body = parse_do_group(parser);
+  if (body == AST_NULL) return AST_NULL;
+  ast_ref_t node = ast_add_for(ast, words, body);
+  if (node == AST_NULL) parser_error(parser, "Out of memory (parse_for)");
+  return node;
+}
+
+// case word in [(]pattern[|pattern]...) list ;; ... esac. The last item may
+// leave out its `;;`, and any item's list may be empty.
+static ast_ref_t parse_case(parser_t *parser) {
+  ast_t *ast = parser->ast;
+  advance(parser);
 
-    if (!target_tok) break;
+  ast_range_t subject = ast_begin_words(ast);
+  ast_word_t  word;
+  if (!match(parser, TOK_WORD) && !match(parser, TOK_ASSIGNMENT_WORD)) {
+    parser_error(parser, "Expected a word after 'case'");
+    return AST_NULL;
+  }
+  if (!parse_word(parser, parser->prev, 0, &word)) return AST_NULL;
+  if (!ast_add_word(ast, &subject, word)) {
+    parser_error(parser, "Out of memory (parse_case)");
+    return AST_NULL;
+  }
+  skip_newlines(parser);
+  if (!expect_reserved(parser, TOK_IN, "Expected 'in' after 'case' word")) {
+    return AST_NULL;
+  }
+  skip_newlines(parser);
+
+  uint32_t mark = ast_begin_case(ast);
+  while (reserved(parser) != TOK_ESAC) {
+    match(parser, TOK_L_PAREN);
+    ast_case_item_t item = {ast_begin_words(ast), AST_NULL};
+    do {
+      if (!match(parser, TOK_WORD) && !match(parser, TOK_ASSIGNMENT_WORD)) {
+        parser_error(parser, "Expected a pattern");
+        return AST_NULL;
+      }
+      if (!parse_word(parser, parser->prev, 0, &word)) return AST_NULL;
+      if (!ast_add_word(ast, &item.patterns, word)) {
+        parser_error(parser, "Out of memory (parse_case)");
+        return AST_NULL;
+      }
+    } while (match(parser, TOK_PIPE));
+    if (!consume(parser, TOK_R_PAREN, "Expected ')' after pattern")) {
+      return AST_NULL;
+    }
 
-    ast_redir_t redir = {
-        .type   = map_token_to_redir_type(redir_op),
-        .fd     = fd,
-        .target = target_tok->lexeme,
-    };
-    vector_push(&node->u.simple.redirs, &redir);
+    skip_newlines(parser);
+    token_type_t next = reserved(parser);
+    if (next != TOK_DSEMI && next != TOK_ESAC) {
+      item.body = parse_list(parser, false);
+      if (parser->had_error) return AST_NULL;
+    }
+    if (!ast_case_add_item(ast, item)) {
+      parser_error(parser, "Out of memory (parse_case)");
+      return AST_NULL;
+    }
+    if (!match(parser, TOK_DSEMI)) break;
+    skip_newlines(parser);
   }
+  if (!expect_reserved(parser, TOK_ESAC, "Expected 'esac'")) return AST_NULL;
 
+  ast_ref_t node = ast_end_case(ast, mark, subject.start);
+  if (node == AST_NULL) parser_error(parser, "Out of memory (parse_case)");
   return node;
 }
 
+// do list done: the body of a loop.
+static ast_ref_t parse_do_group(parser_t *parser) {
+  if (!expect_reserved(parser, TOK_DO, "Expected 'do'")) return AST_NULL;
+  ast_ref_t body = parse_list(parser, false);
+  if (parser->had_error ||
+      !expect_reserved(parser, TOK_DONE, "Expected 'done'")) {
+    return AST_NULL;
+  }
+  return body;
+}
+
+// Redirections after a simple command's words, or after the word that
+// closes a compound command. False after reporting an error.
+static bool parse_redirs(parser_t *parser, ast_ref_t node) {
+  bool simple = ast_node(parser->ast, node)->type == AST_SIMPLE;
+  while (parser->cur && is_redir_tok(parser->cur->type)) {
+    ast_redir_t redir;
+    if (!parse_redir(parser, &redir)) return false;
+    bool added = simple ? ast_simple_add_redir(parser->ast, node, redir)
+                        : ast_compound_add_redir(parser->ast, node, redir);
+    if (!added) {
+      parser_error(parser, "Out of memory (parse_redirs)");
+      return false;
+    }
+    if (redir.type == REDIR_HERE_DOC || redir.type == REDIR_HERE_STRIP) {
+      expect_heredoc(parser);
+    }
+  }
+  return true;
+}
+
+static bool parse_redir(parser_t *parser, ast_redir_t *redir) {
+  token_type_t op = parser->cur->type;
+  advance(parser);
+
+  int          fd;
+  token_type_t redir_op;
+  if (op == TOK_IO_NUMBER) {
+    fd       = parse_io_number(parser, parser->prev);
+    redir_op = parser->cur->type;
+    advance(parser);
+  } else {
+    switch (op) {
+      case TOK_LESS:
+      case TOK_D_LESS:
+      case TOK_LESS_AND:
+      case TOK_LESS_GREAT:
+      case TOK_D_LESS_DASH: fd = 0; break;
+      default: fd = 1; break;
+    }
+    redir_op = op;
+  }
+
+  token_t *target_tok =
+      consume(parser, TOK_WORD, "Expected file name after redirection");
+  if (!target_tok) return false;
+
+  *redir = (ast_redir_t){
+      .type = map_token_to_redir_type(redir_op),
+      .fd   = fd,
+  };
+  return parse_word(parser, target_tok, 0, &redir->target);
+}
+
+// Copies a word (less its first `skip` bytes) into the AST. A plain word is
+// stored as its text alone; anything quoted or expanded, or starting with a
+// tilde, is broken into parts for the executor.
+static bool parse_word(parser_t *parser, const token_t *tok, size_t skip,
+                       ast_word_t *word) {
+  const char *lexeme = token_lexeme(parser->scanner, tok) + skip;
+  size_t      length = token_length(tok) - skip;
+
+  *word = (ast_word_t){
+      .text  = arena_strndup(parser->arena, lexeme, length),
+      .parts = {parser->ast->parts.length, 0},
+  };
+  if (!word->text) {
+    parser_error(parser, "Out of memory (parse_word)");
+    return false;
+  }
+  if (tok->plain && word->text[0] != '~') return true;
+
+  const char *error;
+  if (!word_parse(parser->ast, word->text, length, 0, &word->parts, &error)) {
+    parser_error(parser, error);
+    return false;
+  }
+  return true;
+}
+
+// The redirection just added takes the next body the scanner reads, which
+// may already have happened if its line's newline was scanned as lookahead.
+static void expect_heredoc(parser_t *parser) {
+  if (parser->here_count == SCANNER_HEREDOCS) {
+    parser_error(parser, "Too many here-documents on one line");
+    return;
+  }
+  unsigned slot = (parser->here_first + parser->here_count++) &
+                  (SCANNER_HEREDOCS - 1);
+  parser->heredocs[slot] = parser->ast->redirs.length - 1;
+  attach_heredocs(parser);
+}
+
+static void attach_heredocs(parser_t *parser) {
+  scanner_heredoc_t doc;
+  while (parser->here_count && scanner_take_heredoc(parser->scanner, &doc)) {
+    ast_redir_t *redir =
+        &parser->ast->redirs.items[parser->heredocs[parser->here_first]];
+    parser->here_first = (parser->here_first + 1) & (SCANNER_HEREDOCS - 1);
+    parser->here_count--;
+
+    char *body = heredoc_strdup(parser->scanner, &doc, parser->arena);
+    if (!body) {
+      parser->here_count = 0;
+      parser_error(parser, "Out of memory (here-document)");
+      return;
+    }
+
+    // Quoting any part of the delimiter leaves the body as written;
+    // otherwise it is expanded like a double-quoted string.
+    redir->body = (ast_word_t){body, {parser->ast->parts.length, 0}};
+    if (redir->target.parts.count == 0 && strpbrk(body, "$`\\")) {
+      const char *error;
+      if (!word_parse(parser->ast, body, strlen(body), WORD_HEREDOC,
+                      &redir->body.parts, &error)) {
+        parser->here_count = 0;
+        parser_error(parser, error);
+        return;
+      }
+    }
+  }
+}
+
+static int parse_io_number(parser_t *parser, const token_t *tok) {
+  const char *digits = token_lexeme(parser->scanner, tok);
+  int         fd     = 0;
+  for (size_t i = 0; i < token_length(tok); i++) {
+    fd = fd * 10 + (digits[i] - '0');
+  }
+  return fd;
+}
+
 static bool is_redir_tok(token_type_t t) {
   switch (t) {
     case TOK_LESS:
@@ -1,68 +1,214 @@
-#include <ctype.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "allocators/arena.h"
+#include "interpreter/charclass.h"
 #include "interpreter/scanner.h"
-
-static char     peek(scanner_t *s);
-static char     advance(scanner_t *s);
-static void     skip_whitespace(scanner_t *s);
-static int      is_at_end(scanner_t *s);
-static token_t *make_token(scanner_t *s, token_type_t t, size_t row, size_t col);
-static token_t *identifier_or_assignment(scanner_t *s, size_t row, size_t col);
-static token_t *number_or_word(scanner_t *s, size_t row, size_t col);
-static token_t *operator_token(scanner_t *s, size_t row, size_t col);
-
-void scanner_init(scanner_t *s, char *source, arena_t *arena) {
+#include "interpreter/word.h"
+
+static char peek(scanner_t *s);
+static char advance(scanner_t *s);
+static int  is_at_end(scanner_t *s);
+static bool scan(scanner_t *s, token_t *tok);
+static bool make_token(scanner_t *s, token_t *tok, token_type_t t);
+static bool word(scanner_t *s, token_t *tok);
+static bool operator_token(scanner_t *s, token_t *tok);
+static void track_heredocs(scanner_t *s, const token_t *tok);
+static void read_heredoc(scanner_t *s, scanner_heredoc_t *doc);
+static bool is_delimiter(const scanner_t *s, const scanner_heredoc_t *doc,
+                         const char *line, size_t length);
+
+void scanner_init(scanner_t *s, const char *source, size_t length) {
+  cc_init();
   s->buf     = source;
+  s->end     = source + length;
   s->start   = source;
   s->current = source;
-  s->row     = 1;
-  s->col     = 1;
-  s->arena   = arena;
+  s->base    = 0;
+  s->keep    = 0;
+  s->lines   = 0;
+  s->refill  = NULL;
+  s->ctx     = NULL;
+
+  s->here_first = 0;
+  s->here_count = 0;
+  s->here_op    = TOK_EOF;
 }
 
-token_t *next_token(scanner_t *s) {
-  skip_whitespace(s);
-  if (is_at_end(s)) return NULL;
+// Starts with no input; `refill` supplies it as scanning proceeds.
+void scanner_init_stream(scanner_t *s, scanner_refill_fn refill, void *ctx) {
+  scanner_init(s, NULL, 0);
+  s->refill = refill;
+  s->ctx    = ctx;
+}
 
-  s->start   = s->current;
-  size_t row = s->row;
-  size_t col = s->col;
+// Fills `tok` in place; the scanner itself never allocates. Returns false
+// (with `tok->type == TOK_EOF`) once the input is exhausted.
+//
+// A token that runs into `end` may continue in input not yet visible, so the
+// buffer is refilled and the token scanned again from where it began. This
+// happens once per refill, never per byte. A newline is always complete: it
+// ends a command, and asking for more there would stall a script read from
+// a pipe until its writer sends the next line.
+bool next_token(scanner_t *s, token_t *tok) {
+  size_t from = s->base + (s->current - s->buf);
+  bool   more;
 
-  char c = advance(s);
+  for (;;) {
+    more = scan(s, tok);
+    if (s->current < s->end || !s->refill) break;
+    if (tok->type == TOK_NEWLINE) break;
 
-  if (c == '\n') {
-    return make_token(s, TOK_NEWLINE, row, col);
+    if (!s->refill(s)) s->refill = NULL;
+    s->current = s->buf + (from - s->base);
   }
 
-  if (isalpha(c) || c == '_') {
-    return identifier_or_assignment(s, row, col);
+  track_heredocs(s, tok);
+  return more;
+}
+
+// Hands over the oldest here-document once its body has been read. Bodies are
+// read together with the newline that ends their line, so they are ready by
+// the time the parser sees that newline, though possibly before it has seen
+// the redirection itself.
+bool scanner_take_heredoc(scanner_t *s, scanner_heredoc_t *doc) {
+  if (s->here_count == 0) return false;
+  scanner_heredoc_t *first = &s->heredocs[s->here_first];
+  if (!first->read) return false;
+
+  *doc          = *first;
+  s->here_first = (s->here_first + 1) & (SCANNER_HEREDOCS - 1);
+  s->here_count--;
+  return true;
+}
+
+// Copies a body, dropping the leading tabs of every line for `<<-` in the
+// same pass.
+char *heredoc_strdup(const scanner_t *s, const scanner_heredoc_t *doc,
+                     arena_t *arena) {
+  const char *p    = s->buf + (doc->body.start - s->base);
+  const char *end  = s->buf + (doc->body.stop - s->base);
+  char       *copy = arena_alloc(arena, end - p + 1);
+  if (!copy) return NULL;
+  if (!doc->strip) {
+    memcpy(copy, p, end - p);
+    copy[end - p] = '\0';
+    return copy;
   }
 
-  if (isdigit(c)) {
-    return number_or_word(s, row, col);
+  char *out = copy;
+  while (p < end) {
+    while (p < end && *p == '\t') p++;
+    const char *nl   = memchr(p, '\n', end - p);
+    const char *stop = nl ? nl + 1 : end;
+    memcpy(out, p, stop - p);
+    out += stop - p;
+    p    = stop;
   }
+  *out = '\0';
+  return copy;
+}
+
+static bool scan(scanner_t *s, token_t *tok) {
+  s->current = cc_ops.skip_blanks(s->current, s->end);
+
+  // A `#` that starts a word comments out the rest of the line.
+  if (s->current < s->end && *s->current == '#') {
+    const char *nl = memchr(s->current, '\n', s->end - s->current);
+    s->current     = nl ? nl : s->end;
+  }
+  s->start = s->current;
+
+  if (is_at_end(s)) {
+    make_token(s, tok, TOK_EOF);
+    return false;
+  }
+
+  char     c   = advance(s);
+  unsigned cls = cc_class(c);
 
-  if (c == '|' || c == '&' || c == '<' || c == '>') {
-    return operator_token(s, row, col);
+  if (cls & CC_NEWLINE) {
+    return make_token(s, tok, TOK_NEWLINE);
+  }
+
+  if (cls & CC_OPERATOR) {
+    return operator_token(s, tok);
   }
 
   switch (c) {
-    case ';': return make_token(s, TOK_SEMI, row, col);
-    case '(': return make_token(s, TOK_L_PAREN, row, col);
-    case ')': return make_token(s, TOK_R_PAREN, row, col);
-    default: return make_token(s, TOK_WORD, row, col);
+    case ';':
+      if (peek(s) == ';') {
+        advance(s);
+        return make_token(s, tok, TOK_DSEMI);
+      }
+      return make_token(s, tok, TOK_SEMI);
+    case '(': return make_token(s, tok, TOK_L_PAREN);
+    case ')': return make_token(s, tok, TOK_R_PAREN);
+    default: return word(s, tok);
+  }
+}
+
+// Rows and columns are not tracked while scanning; they are recovered from
+// the newlines before `offset` when a diagnostic asks for them.
+void scanner_locate(const scanner_t *s, size_t offset, unsigned int *row,
+                    unsigned int *col) {
+  if (offset < s->base) offset = s->base;
+
+  const char *p          = s->buf;
+  const char *stop       = s->buf + (offset - s->base);
+  const char *line_start = s->buf;
+  unsigned    lines      = 1 + s->lines;
+
+  while (p < stop && (p = memchr(p, '\n', stop - p)) != NULL) {
+    lines++;
+    line_start = ++p;
   }
+
+  *row = lines;
+  *col = (unsigned int)(stop - line_start) + 1;
+}
+
+// The reserved word `tok` spells, or its own type. Only an unquoted word
+// can be one, and only where the parser asks: where a command could start,
+// or for `in` after the name of a for or the word of a case.
+token_type_t scanner_reserved(const scanner_t *s, const token_t *tok) {
+  static const struct {
+    const char  *text;
+    token_type_t type;
+  } WORDS[] = {
+      {"if", TOK_IF},       {"then", TOK_THEN},   {"else", TOK_ELSE},
+      {"elif", TOK_ELIF},   {"fi", TOK_FI},       {"do", TOK_DO},
+      {"done", TOK_DONE},   {"case", TOK_CASE},   {"esac", TOK_ESAC},
+      {"while", TOK_WHILE}, {"until", TOK_UNTIL}, {"for", TOK_FOR},
+      {"in", TOK_IN},       {"!", TOK_BANG},
+  };
+
+  size_t n = token_length(tok);
+  if (tok->type != TOK_WORD || !tok->plain || n > 5) return tok->type;
+  const char *lexeme = token_lexeme(s, tok);
+  for (size_t i = 0; i < sizeof WORDS / sizeof *WORDS; i++) {
+    if (strncmp(WORDS[i].text, lexeme, n) == 0 && !WORDS[i].text[n]) {
+      return WORDS[i].type;
+    }
+  }
+  return tok->type;
+}
+
+char *token_strdup(const scanner_t *s, const token_t *tok, arena_t *arena) {
+  return arena_strndup(arena, token_lexeme(s, tok), token_length(tok));
 }
 
-void token_print(const token_t *tok) {
+void token_print(const scanner_t *s, const token_t *tok) {
+  unsigned int row, col;
+  scanner_locate(s, tok->span.start, &row, &col);
+
   printf("token {\n");
   printf("  type   = %d,\n", tok->type);
   printf("  lexeme = \"");
 
-  for (char *p = tok->lexeme; *p; ++p) {
+  const char *lexeme = token_lexeme(s, tok);
+  for (const char *p = lexeme; p < lexeme + token_length(tok); ++p) {
     switch (*p) {
       case '\n': printf("\\n"); break;
       case '\t': printf("\\t"); break;
@@ -74,130 +220,191 @@ void token_print(const token_t *tok) {
 
   printf("\",\n");
   printf("  span   = %zu..%zu,\n", tok->span.start, tok->span.stop);
-  printf("  row    = %u,\n", tok->row);
-  printf("  column = %u\n", tok->column);
+  printf("  row    = %u,\n", row);
+  printf("  column = %u\n", col);
   printf("}\n");
 }
 
-static char peek(scanner_t *s) { return *s->current; }
+static char peek(scanner_t *s) {
+  return s->current < s->end ? *s->current : '\0';
+}
 
 static int is_at_end(scanner_t *s) { return peek(s) == '\0'; }
 
-static char advance(scanner_t *s) {
-  char c = *s->current++;
-  if (c == '\n') {
-    s->row++;
-    s->col = 1;
-  } else {
-    s->col++;
-  }
-  return c;
+static char advance(scanner_t *s) { return *s->current++; }
+
+static bool make_token(scanner_t *s, token_t *tok, token_type_t type) {
+  size_t       start = s->base + (s->start - s->buf);
+  size_t       end   = s->base + (s->current - s->buf);
+  token_span_t span  = {start, end};
+
+  tok->type  = type;
+  tok->span  = span;
+  tok->plain = true;
+
+  return true;
 }
 
-static void skip_whitespace(scanner_t *s) {
+// A word runs to the next blank, newline or operator byte that is not quoted
+// or inside a substitution. span_word stops at quoting bytes as well, and
+// word_skip then steps over the whole quoted string or substitution; one left
+// open at `end` takes the word to `end`, so it is rescanned after a refill
+// (or reported by the parser at the end of input). All-digit words directly
+// before `<` or `>` are IO numbers; NAME=... words are assignments.
+static bool word(scanner_t *s, token_t *tok) {
+  bool plain = true;
+  s->current = s->start;
   for (;;) {
-    char c = peek(s);
-    switch (c) {
-      case ' ':
-      case '\r':
-      case '\t': advance(s); continue;
-      default: return;
-    }
+    s->current = cc_ops.span_word(s->current, s->end);
+    if (is_at_end(s) || !(cc_class(*s->current) & CC_QUOTE)) break;
+    const char *stop = word_skip(s->current, s->end);
+    s->current       = stop ? stop : s->end;
+    plain            = false;
   }
-}
-
-static token_t *make_token(scanner_t *s, token_type_t type, size_t row,
-                           size_t col) {
-  size_t       len   = s->current - s->start;
-  size_t       start = s->start - s->buf;
-  size_t       end   = s->current - s->buf;
-  token_span_t span  = {start, end};
 
-  char *lexeme = arena_strndup(s->arena, s->start, len);
-
-  token_t *tok = arena_alloc(s->arena, sizeof(token_t));
-  if (!tok) return NULL;
+  if (plain && cc_ops.span_digits(s->start, s->current) == s->current &&
+      (peek(s) == '<' || peek(s) == '>')) {
+    return make_token(s, tok, TOK_IO_NUMBER);
+  }
 
-  tok->type    = type;
-  tok->lexeme  = lexeme;
-  tok->literal = NULL;
-  tok->span    = span;
-  tok->row     = row;
-  tok->column  = col;
+  token_type_t type = TOK_WORD;
+  if (cc_class(*s->start) & CC_ALPHA) {
+    const char *name_end = cc_ops.span_name(s->start, s->current);
+    if (name_end < s->current && *name_end == '=') type = TOK_ASSIGNMENT_WORD;
+  }
 
-  return tok;
+  make_token(s, tok, type);
+  tok->plain = plain;
+  return true;
 }
 
-static token_t *identifier_or_assignment(scanner_t *s, size_t row, size_t col) {
-  while (isalnum(peek(s)) || peek(s) == '_') {
-    advance(s);
+// A word straight after `<<` or `<<-` is a delimiter. The bodies of a line's
+// here-documents follow its newline in the order the operators appeared; at
+// the end of input any still missing are empty.
+static void track_heredocs(scanner_t *s, const token_t *tok) {
+  if (s->here_op != TOK_EOF && tok->type == TOK_WORD &&
+      s->here_count < SCANNER_HEREDOCS) {
+    unsigned slot = (s->here_first + s->here_count++) & (SCANNER_HEREDOCS - 1);
+    s->heredocs[slot] = (scanner_heredoc_t){
+        .delim = tok->span,
+        .strip = s->here_op == TOK_D_LESS_DASH,
+    };
   }
 
-  if (peek(s) == '=') {
-    return make_token(s, TOK_ASSIGNMENT_WORD, row, col);
-  }
+  bool here  = tok->type == TOK_D_LESS || tok->type == TOK_D_LESS_DASH;
+  s->here_op = here ? tok->type : TOK_EOF;
 
-  return make_token(s, TOK_WORD, row, col);
+  if (tok->type != TOK_NEWLINE && tok->type != TOK_EOF) return;
+  for (unsigned i = 0; i < s->here_count; i++) {
+    scanner_heredoc_t *doc =
+        &s->heredocs[(s->here_first + i) & (SCANNER_HEREDOCS - 1)];
+    if (!doc->read) read_heredoc(s, doc);
+  }
 }
 
-static token_t *number_or_word(scanner_t *s, size_t row, size_t col) {
-  while (isdigit(peek(s))) {
-    advance(s);
-  }
+// Scans whole lines up to the delimiter line, refilling whenever a line is
+// not yet complete; the body stays in the input buffer, behind `current`, until
+// the parser copies it.
+static void read_heredoc(scanner_t *s, scanner_heredoc_t *doc) {
+  doc->body.start = s->base + (s->current - s->buf);
+
+  for (;;) {
+    const char *nl = memchr(s->current, '\n', s->end - s->current);
+    if (!nl && s->refill) {
+      size_t at = s->base + (s->current - s->buf);
+      if (!s->refill(s)) s->refill = NULL;
+      s->current = s->buf + (at - s->base);
+      continue;
+    }
 
-  if (peek(s) == '<' || peek(s) == '>') {
-    return make_token(s, TOK_IO_NUMBER, row, col);
+    const char *stop = nl ? nl : s->end;
+    const char *text = s->current;
+    if (doc->strip) {
+      while (text < stop && *text == '\t') text++;
+    }
+    if (is_delimiter(s, doc, text, stop - text)) {
+      doc->body.stop = s->base + (s->current - s->buf);
+      s->current     = nl ? nl + 1 : stop;
+      break;
+    }
+    if (!nl) { // the end of input ends the body too
+      doc->body.stop = s->base + (stop - s->buf);
+      s->current     = stop;
+      break;
+    }
+    s->current = nl + 1;
   }
+  doc->read = true;
+}
 
-  return make_token(s, TOK_WORD, row, col);
+// Compares a line with the delimiter as written less its quoting, so `'EOF'`,
+// `"EOF"` and `\EOF` all end at a line reading EOF.
+static bool is_delimiter(const scanner_t *s, const scanner_heredoc_t *doc,
+                         const char *line, size_t length) {
+  const char *p     = s->buf + (doc->delim.start - s->base);
+  const char *end   = s->buf + (doc->delim.stop - s->base);
+  char        quote = 0;
+
+  for (; p < end; p++) {
+    char c = *p;
+    if (c == '\\' && quote != '\'' && p + 1 < end) {
+      c = *++p;
+    } else if ((c == '\'' || c == '"') && (!quote || quote == c)) {
+      quote = quote ? 0 : c;
+      continue;
+    }
+    if (length == 0 || *line++ != c) return false;
+    length--;
+  }
+  return length == 0;
 }
 
-static token_t *operator_token(scanner_t *s, size_t row, size_t col) {
+static bool operator_token(scanner_t *s, token_t *tok) {
   char c = s->start[0];
   char n = peek(s);
 
   if (c == '&' && n == '&') {
     advance(s);
-    return make_token(s, TOK_AND_IF, row, col);
+    return make_token(s, tok, TOK_AND_IF);
   }
   if (c == '|' && n == '|') {
     advance(s);
-    return make_token(s, TOK_OR_IF, row, col);
+    return make_token(s, tok, TOK_OR_IF);
   }
   if (c == '<' && n == '<') {
     advance(s);
     if (peek(s) == '-') {
       advance(s);
-      return make_token(s, TOK_D_LESS_DASH, row, col);
+      return make_token(s, tok, TOK_D_LESS_DASH);
     }
-    return make_token(s, TOK_D_LESS, row, col);
+    return make_token(s, tok, TOK_D_LESS);
   }
   if (c == '>' && n == '>') {
     advance(s);
-    return make_token(s, TOK_D_GREAT, row, col);
+    return make_token(s, tok, TOK_D_GREAT);
   }
   if (c == '<' && n == '&') {
     advance(s);
-    return make_token(s, TOK_LESS_AND, row, col);
+    return make_token(s, tok, TOK_LESS_AND);
   }
   if (c == '>' && n == '&') {
     advance(s);
-    return make_token(s, TOK_GREAT_AND, row, col);
+    return make_token(s, tok, TOK_GREAT_AND);
   }
   if (c == '<' && n == '>') {
     advance(s);
-    return make_token(s, TOK_LESS_GREAT, row, col);
+    return make_token(s, tok, TOK_LESS_GREAT);
   }
   if (c == '>' && n == '|') {
     advance(s);
-    return make_token(s, TOK_CLOBBER, row, col);
+    return make_token(s, tok, TOK_CLOBBER);
   }
 
   switch (c) {
-    case '|': return make_token(s, TOK_PIPE, row, col);
-    case '&': return make_token(s, TOK_AMP, row, col);
-    case '<': return make_token(s, TOK_LESS, row, col);
-    case '>': return make_token(s, TOK_GREAT, row, col);
-    default: return make_token(s, TOK_WORD, row, col);
+    case '|': return make_token(s, tok, TOK_PIPE);
+    case '&': return make_token(s, tok, TOK_AMP);
+    case '<': return make_token(s, tok, TOK_LESS);
+    case '>': return make_token(s, tok, TOK_GREAT);
+    default: return make_token(s, tok, TOK_WORD);
   }
 }
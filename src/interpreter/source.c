@@ -0,0 +1,142 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "interpreter/scanner.h"
+#include "interpreter/source.h"
+
+static bool refill_mapped(scanner_t *s);
+static bool refill_stream(scanner_t *s);
+
+bool source_open(source_t *src, int fd, bool map) {
+  *src    = (source_t){0};
+  src->fd = fd;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return false;
+  }
+
+  if (map && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      madvise(map, st.st_size, MADV_SEQUENTIAL);
+      src->data   = map;
+      src->length = st.st_size;
+      src->mapped = true;
+    }
+  }
+  return true;
+}
+
+void source_close(source_t *src) {
+  if (src->mapped) munmap(src->data, src->length);
+  else free(src->data);
+  if (src->fd >= 0) close(src->fd);
+  *src    = (source_t){0};
+  src->fd = -1;
+}
+
+void source_attach(source_t *src, scanner_t *s) {
+  scanner_init_stream(s, src->mapped ? refill_mapped : refill_stream, src);
+}
+
+// A script read from the shell's own stdin shares its offset with the
+// commands it runs, and the stream has read past the command about to run.
+// source_sync points the offset back at the end of that command, so the
+// command reads what follows it; false if the input cannot seek (a pipe).
+bool source_sync(source_t *src, const scanner_t *s) {
+  size_t unread = s->end - s->current;
+  src->ahead    = lseek(src->fd, 0, SEEK_CUR);
+  if (src->ahead < 0) return false;
+  src->synced = lseek(src->fd, src->ahead - (off_t)unread, SEEK_SET);
+  return src->synced >= 0;
+}
+
+// After the command: if it left the offset alone, the read-ahead is still
+// good and the offset goes back past it. Otherwise the command consumed
+// input of its own, so the read-ahead is dropped and the script goes on from
+// wherever the command stopped.
+void source_resume(source_t *src, scanner_t *s) {
+  if (lseek(src->fd, 0, SEEK_CUR) == src->synced) {
+    lseek(src->fd, src->ahead, SEEK_SET);
+    return;
+  }
+  src->length = s->current - s->buf;
+  s->end      = s->current;
+  s->refill   = refill_stream;
+}
+
+// The mapping never moves, so a refill only widens the visible window and
+// unmaps the pages the parser has finished with (they are clean, so this
+// just drops them from our resident set).
+static bool refill_mapped(scanner_t *s) {
+  source_t *src  = s->ctx;
+  size_t    page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t    done = s->keep & ~(page - 1);
+
+  if (done >= src->released + SOURCE_WINDOW) {
+    madvise(src->data + src->released, done - src->released, MADV_DONTNEED);
+    src->released = done;
+  }
+
+  if (!s->buf) s->buf = s->end = src->data;
+
+  size_t shown = s->end - s->buf;
+  if (shown == src->length) return false;
+
+  size_t window = src->length - shown;
+  if (window > SOURCE_WINDOW) window = SOURCE_WINDOW;
+  s->end += window;
+  return true;
+}
+
+// Drops whole lines before `keep` (so columns stay right for diagnostics),
+// then appends one block from the fd.
+static bool refill_stream(scanner_t *s) {
+  source_t *src  = s->ctx;
+  size_t    keep = s->keep > s->base ? s->keep - s->base : 0;
+  if (keep > src->length) keep = src->length;
+
+  const char *cut = keep ? memrchr(src->data, '\n', keep) : NULL;
+  if (cut) {
+    size_t drop = cut + 1 - src->data;
+    for (const char *p = src->data; (p = memchr(p, '\n', cut + 1 - p)); p++) {
+      s->lines++;
+    }
+    memmove(src->data, src->data + drop, src->length - drop);
+    src->length -= drop;
+    s->base += drop;
+  }
+
+  if (src->capacity - src->length < SOURCE_BLOCK) {
+    size_t capacity = src->capacity ? src->capacity * 2 : SOURCE_BLOCK;
+    while (capacity - src->length < SOURCE_BLOCK) capacity *= 2;
+    char *data = realloc(src->data, capacity);
+    if (!data) {
+      s->buf = src->data;
+      s->end = src->data + src->length;
+      return false;
+    }
+    src->data     = data;
+    src->capacity = capacity;
+  }
+
+  ssize_t n;
+  do {
+    n = read(src->fd, src->data + src->length, src->capacity - src->length);
+  } while (n < 0 && errno == EINTR);
+  if (n > 0) src->length += n;
+
+  s->buf = src->data;
+  s->end = src->data + src->length;
+  return n > 0;
+}
@@ -0,0 +1,381 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "collections/vector.h"
+#include "interpreter/ast.h"
+#include "interpreter/charclass.h"
+#include "interpreter/word.h"
+
+// The word of ${x-word} inside "..." or a here-document: as WORD_DQUOTE, but
+// a "..." of its own is quoting again rather than text, so "${x-"a b"}" is
+// a b.
+#define WORD_NESTED 0x4
+
+// Parts are collected one nesting level at a time. Their literal text and
+// names are carved one after another out of `out`, a single block sized for
+// the worst case before parsing starts, so a word costs one allocation
+// however many parts it has.
+typedef struct {
+  ast_t      *ast;
+  char       *out;
+  bool        open; // the last part is a literal still being appended to
+  const char *error;
+} word_ctx_t;
+
+static const char *skip_until(const char *p, const char *end, char close);
+static const char *skip_dollar(const char *p, const char *end);
+static bool        parse_parts(word_ctx_t *ctx, const char *p, const char *end,
+                               unsigned flags, ast_range_t *range);
+static bool        parse_into(word_ctx_t *ctx, vector_t *parts, const char *p,
+                              const char *end, unsigned flags);
+static const char *parse_dollar(word_ctx_t *ctx, vector_t *parts,
+                                const char *p, const char *end, bool quoted);
+static bool        parse_brace(word_ctx_t *ctx, vector_t *parts, const char *p,
+                               const char *end, bool quoted);
+static const char *parse_tilde(word_ctx_t *ctx, vector_t *parts, const char *p,
+                               const char *end);
+static const char *param_end(const char *p, const char *end);
+static bool        literal(word_ctx_t *ctx, vector_t *parts, const char *s,
+                           size_t n, bool quoted);
+static bool        push_part(word_ctx_t *ctx, vector_t *parts, ast_part_t part);
+static void        close_literal(word_ctx_t *ctx);
+static char       *copy_text(word_ctx_t *ctx, const char *s, size_t n);
+static bool        fail(word_ctx_t *ctx, const char *message);
+
+// Returns the end of the quoted string or substitution starting at `p`, one
+// of ' " \ ` $, or NULL if it runs past `end`. The scanner uses it to keep
+// `'a b'` or `$(x | y)` in one word; nested quotes and substitutions are
+// stepped over whole, so `"$(echo ")")"` ends where it should.
+const char *word_skip(const char *p, const char *end) {
+  switch (*p) {
+    case '\\': return p + 1 < end ? p + 2 : NULL;
+    case '\'': {
+      const char *q = memchr(p + 1, '\'', end - p - 1);
+      return q ? q + 1 : NULL;
+    }
+    case '"': return skip_until(p + 1, end, '"');
+    case '`': return skip_until(p + 1, end, '`');
+    case '$': return skip_dollar(p, end);
+  }
+  return p + 1;
+}
+
+// Splits a word into parts appended to `ast`, removing its quoting as it
+// goes. `text` is only read; every part gets its own copy of what it needs.
+// On a syntax error `*error` says what was wrong.
+bool word_parse(ast_t *ast, const char *text, size_t length, unsigned flags,
+                ast_range_t *parts, const char **error) {
+  // Each part's text is no longer than the source it came from, plus a NUL,
+  // and a new part can only start at one of the quoting bytes.
+  size_t special = 0;
+  for (size_t i = 0; i < length; i++) {
+    special += (cc_class(text[i]) & CC_QUOTE) != 0;
+  }
+
+  word_ctx_t ctx = {.ast = ast};
+  ctx.out        = arena_alloc(ast->arena, length + special + 2);
+  if (!ctx.out) {
+    *error = "Out of memory (word)";
+    return false;
+  }
+  if (!parse_parts(&ctx, text, text + length, flags, parts)) {
+    *error = ctx.error;
+    return false;
+  }
+  return true;
+}
+
+// Inside "..." or `...`, up to the closing byte. A backslash always protects
+// the byte after it; in "..." substitutions nest.
+static const char *skip_until(const char *p, const char *end, char close) {
+  while (p < end) {
+    char c = *p;
+    if (c == close) return p + 1;
+    if (c == '\\') {
+      if (p + 1 >= end) return NULL;
+      p += 2;
+    } else if (close == '"' && (c == '$' || c == '`')) {
+      p = word_skip(p, end);
+      if (!p) return NULL;
+    } else {
+      p++;
+    }
+  }
+  return NULL;
+}
+
+// $name is left to the caller; only $(...), $((...)) and ${...} need their
+// closing bracket found, counting nested ones outside quotes. A `$` at the
+// very end may yet be followed by `(`, so it asks for more input too.
+static const char *skip_dollar(const char *p, const char *end) {
+  if (p + 1 >= end) return NULL;
+  char open = p[1];
+  if (open != '(' && open != '{') return p + 1;
+
+  char close = open == '(' ? ')' : '}';
+  int  depth = 0;
+  for (p++; p < end;) {
+    char c = *p;
+    if (c == open) {
+      depth++;
+      p++;
+    } else if (c == close) {
+      p++;
+      if (--depth == 0) return p;
+    } else if (cc_class(c) & CC_QUOTE) {
+      p = word_skip(p, end);
+      if (!p) return NULL;
+    } else {
+      p++;
+    }
+  }
+  return NULL;
+}
+
+static bool parse_parts(word_ctx_t *ctx, const char *p, const char *end,
+                        unsigned flags, ast_range_t *range) {
+  vector_t parts;
+  vector_init(&parts, sizeof(ast_part_t), ctx->ast->arena);
+
+  close_literal(ctx); // the enclosing level's, if any
+  if (!parse_into(ctx, &parts, p, end, flags)) return false;
+  close_literal(ctx);
+
+  if (!ast_add_parts(ctx->ast, vector_data(&parts), parts.length, range)) {
+    return fail(ctx, "Out of memory (word)");
+  }
+  return true;
+}
+
+static bool parse_into(word_ctx_t *ctx, vector_t *parts, const char *p,
+                       const char *end, unsigned flags) {
+  bool quoted = flags & (WORD_DQUOTE | WORD_HEREDOC | WORD_NESTED);
+  bool nested = flags & WORD_NESTED;
+  if (!quoted && p < end && *p == '~') {
+    p = parse_tilde(ctx, parts, p, end);
+    if (!p) return false;
+  }
+
+  while (p < end) {
+    const char *run = p;
+    if (quoted) {
+      while (p < end && *p != '$' && *p != '`' && *p != '\\' &&
+             !(nested && *p == '"')) {
+        p++;
+      }
+    } else {
+      while (p < end && !(cc_class(*p) & CC_QUOTE)) p++;
+    }
+    if (p > run && !literal(ctx, parts, run, p - run, quoted)) return false;
+    if (p == end) break;
+
+    const char *q;
+    switch (*p) {
+      case '\'':
+        q = memchr(p + 1, '\'', end - p - 1);
+        if (!q) return fail(ctx, "Unterminated quote");
+        if (!literal(ctx, parts, p + 1, q - p - 1, true)) return false;
+        p = q + 1;
+        break;
+      case '"':
+        q = skip_until(p + 1, end, '"');
+        if (!q) return fail(ctx, "Unterminated quote");
+        // `""` still makes a (empty) field, so it gets a part of its own.
+        if (!literal(ctx, parts, "", 0, true) ||
+            !parse_into(ctx, parts, p + 1, q - 1, WORD_DQUOTE)) {
+          return false;
+        }
+        p = q;
+        break;
+      case '\\': {
+        char c = p + 1 < end ? p[1] : '\0';
+        if (c == '\n') { // line continuation
+          p += 2;
+        } else if (!c || (quoted && !strchr(flags & WORD_HEREDOC ? "$`\\"
+                                                                 : "$`\"\\",
+                                            c))) {
+          if (!literal(ctx, parts, p, 1, quoted)) return false;
+          p++;
+        } else {
+          if (!literal(ctx, parts, p + 1, 1, true)) return false;
+          p += 2;
+        }
+        break;
+      }
+      case '`': {
+        q = skip_until(p + 1, end, '`');
+        if (!q) return fail(ctx, "Unterminated command substitution");
+        close_literal(ctx);
+        ast_part_t part = {.type = PART_COMMAND, .quoted = quoted};
+        part.text       = ctx->out;
+        // Inside "..." the backquotes are inside them too, so \" is a quote.
+        const char *escapes = quoted && !(flags & WORD_HEREDOC) ? "$`\"\\"
+                                                                : "$`\\";
+        for (const char *s = p + 1; s < q - 1; s++) {
+          if (*s == '\\' && s + 2 < q && strchr(escapes, s[1])) s++;
+          *ctx->out++ = *s;
+        }
+        *ctx->out++ = '\0';
+        if (!push_part(ctx, parts, part)) return false;
+        p = q;
+        break;
+      }
+      default: // '$'
+        p = parse_dollar(ctx, parts, p, end, quoted);
+        if (!p) return false;
+        break;
+    }
+  }
+  return true;
+}
+
+// $name, $1, $?, ${...}, $(...) or $((...)); a `$` followed by anything else
+// is just a dollar sign.
+static const char *parse_dollar(word_ctx_t *ctx, vector_t *parts,
+                                const char *p, const char *end, bool quoted) {
+  char       c    = p + 1 < end ? p[1] : '\0';
+  ast_part_t part = {.type = PART_PARAM, .quoted = quoted};
+
+  if (c == '{' || c == '(') {
+    const char *q = skip_dollar(p, end);
+    if (!q) {
+      fail(ctx, "Unterminated substitution");
+      return NULL;
+    }
+    if (c == '{') {
+      return parse_brace(ctx, parts, p + 2, q - 1, quoted) ? q : NULL;
+    }
+
+    if (p[2] == '(' && q - p >= 5 && q[-2] == ')') {
+      part.type = PART_ARITH;
+      if (!parse_parts(ctx, p + 3, q - 2, WORD_HEREDOC, &part.word)) {
+        return NULL;
+      }
+    } else {
+      part.type = PART_COMMAND;
+      part.text = copy_text(ctx, p + 2, q - p - 3);
+    }
+    return push_part(ctx, parts, part) ? q : NULL;
+  }
+
+  const char *name = p + 1;
+  const char *stop = param_end(name, end);
+  // $10 is ${1}0.
+  if (stop > name && (cc_class(*name) & CC_DIGIT)) stop = name + 1;
+  if (stop == name) return literal(ctx, parts, p, 1, quoted) ? p + 1 : NULL;
+
+  part.text = copy_text(ctx, name, stop - name);
+  return push_part(ctx, parts, part) ? stop : NULL;
+}
+
+// The inside of ${...}: an optional `#`, the parameter, then an operator and
+// the word it applies to, which is parsed as a word of its own.
+static bool parse_brace(word_ctx_t *ctx, vector_t *parts, const char *p,
+                        const char *end, bool quoted) {
+  ast_part_t part = {.type = PART_PARAM, .op = PARAM_VALUE, .quoted = quoted};
+  if (end - p > 1 && *p == '#') {
+    part.op = PARAM_LENGTH;
+    p++;
+  }
+
+  const char *name = p;
+  p                = param_end(p, end);
+  size_t length    = p - name;
+  if (length == 0 || (part.op == PARAM_LENGTH && p != end)) {
+    return fail(ctx, "Bad substitution");
+  }
+
+  if (p < end) {
+    if (*p == ':') {
+      part.colon = true;
+      p++;
+    }
+    char op = p < end ? *p++ : '\0';
+    bool twice = p < end && *p == op && (op == '%' || op == '#');
+    switch (op) {
+      case '-': part.op = PARAM_DEFAULT; break;
+      case '=': part.op = PARAM_ASSIGN; break;
+      case '?': part.op = PARAM_ERROR; break;
+      case '+': part.op = PARAM_ALTERNATE; break;
+      case '%': part.op = twice ? PARAM_LONG_SUFFIX : PARAM_SUFFIX; break;
+      case '#': part.op = twice ? PARAM_LONG_PREFIX : PARAM_PREFIX; break;
+      default: return fail(ctx, "Bad substitution");
+    }
+    if (part.colon && (op == '%' || op == '#')) {
+      return fail(ctx, "Bad substitution");
+    }
+    if (twice) p++;
+    // A pattern stays a pattern inside "${x%.*}"; only its own quotes count.
+    unsigned flags = quoted && op != '%' && op != '#' ? WORD_NESTED : 0;
+    if (!parse_parts(ctx, p, end, flags, &part.word)) return false;
+  }
+
+  part.text = copy_text(ctx, name, length);
+  return push_part(ctx, parts, part);
+}
+
+// `~` or `~user` up to the first slash, unless any of it is quoted.
+static const char *parse_tilde(word_ctx_t *ctx, vector_t *parts, const char *p,
+                               const char *end) {
+  const char *q = p + 1;
+  for (; q < end && *q != '/'; q++) {
+    if (cc_class(*q) & CC_QUOTE) return p;
+  }
+  ast_part_t part = {.type = PART_TILDE};
+  part.text       = copy_text(ctx, p + 1, q - p - 1);
+  return push_part(ctx, parts, part) ? q : NULL;
+}
+
+// A name, a positional parameter's digits, or one special parameter.
+static const char *param_end(const char *p, const char *end) {
+  if (p == end) return p;
+  if (cc_class(*p) & CC_ALPHA) return cc_ops.span_name(p, end);
+  if (cc_class(*p) & CC_DIGIT) return cc_ops.span_digits(p, end);
+  return *p && strchr("@*#?-$!", *p) ? p + 1 : p;
+}
+
+// Appends to the literal part being built if it has the same quoting, so
+// `a'b'c` is three parts but `'a'"b"` is one.
+static bool literal(word_ctx_t *ctx, vector_t *parts, const char *s, size_t n,
+                    bool quoted) {
+  bool same = ctx->open &&
+              VECTOR_AT(parts, ast_part_t, parts->length - 1).quoted == quoted;
+  if (!same) {
+    ast_part_t part = {.type = PART_LITERAL, .quoted = quoted};
+    if (!push_part(ctx, parts, part)) return false;
+    VECTOR_AT(parts, ast_part_t, parts->length - 1).text = ctx->out;
+    ctx->open                                            = true;
+  }
+  memcpy(ctx->out, s, n);
+  ctx->out += n;
+  return true;
+}
+
+static bool push_part(word_ctx_t *ctx, vector_t *parts, ast_part_t part) {
+  close_literal(ctx);
+  if (!VECTOR_PUSH(parts, ast_part_t, part)) {
+    return fail(ctx, "Out of memory (word)");
+  }
+  return true;
+}
+
+static void close_literal(word_ctx_t *ctx) {
+  if (!ctx->open) return;
+  *ctx->out++ = '\0';
+  ctx->open   = false;
+}
+
+static char *copy_text(word_ctx_t *ctx, const char *s, size_t n) {
+  close_literal(ctx);
+  char *copy = ctx->out;
+  memcpy(copy, s, n);
+  copy[n] = '\0';
+  ctx->out += n + 1;
+  return copy;
+}
+
+static bool fail(word_ctx_t *ctx, const char *message) {
+  ctx->error = message;
+  return false;
+}
@@ -1,27 +1,54 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "allocators/arena.h"
 #include "repl.h"
+#include "script.h"
 
-#define CAPACITY 4096
+#define CAPACITY 4096 // first arena chunk; later chunks grow geometrically
 
+static void usage(void) {
+  fprintf(stderr, "usage: tiny [-c command | script]\n");
+}
+
+// tiny              interactive REPL, or the script on stdin if that is not a
+//                   terminal (`tiny < script`, `cmd | tiny`)
+// tiny -c command   run `command` and exit
+// tiny script       run the file `script` and exit
+//
+// The non-interactive modes never start the line editor or print the
+// greeting; arguments after the command or script are accepted and ignored
+// until positional parameters exist.
 int main(int argc, char **argv) {
   // TODO: add CLI:
-  //       - run command `-c`
   //       - ability to debug (showing tokens and AST)
   //       - ability to show system orchestration like process IDs, etc
-  (void)argc;
-  (void)argv;
-
   arena_t arena;
   if (!arena_init(&arena, CAPACITY)) {
     fprintf(stderr, "Error: failed to initialize arena\n");
     return EXIT_FAILURE;
   }
 
-  repl_run(&arena);
+  int status;
+  if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+    if (argc < 3) {
+      usage();
+      return 2;
+    }
+    status = script_run(&arena, argv[2], strlen(argv[2]));
+  } else if (argc > 1 && argv[1][0] == '-' && argv[1][1]) {
+    usage();
+    return 2;
+  } else if (argc > 1) {
+    status = script_run_file(&arena, argv[1]);
+  } else if (!isatty(STDIN_FILENO)) {
+    status = script_run_stdin(&arena);
+  } else {
+    status = repl_run(&arena);
+  }
 
   arena_free(&arena);
-  return EXIT_SUCCESS;
+  return status;
 }
@@ -1,10 +1,16 @@
+#define _GNU_SOURCE
+
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <partyline/partyline.h>
 
 #include "allocators/arena.h"
+#include "executor/executor.h"
 #include "interpreter/ast.h"
 #include "interpreter/parser.h"
 #include "interpreter/scanner.h"
@@ -12,27 +18,123 @@
 
 #define TEXT_GREEN(text) "\033[32m" text "\033[0m"
 
+#define PROMPT      TEXT_GREEN("> ")
+#define PROMPT_MORE TEXT_GREEN(". ") // the command needs another line
+
 static const char GREETING[] = TEXT_GREEN("  _____     ____     ______\n"
                                           " /      \\  |  o |   | sup. |\n"
                                           "|        |/ ___\\|  /_______|\n"
                                           "|_________/\n"
                                           "|_|_| |_|_|\n\n");
 
-void repl_run(arena_t *arena) {
-  char *line;
+// The scanner's input, fed a line at a time from the line editor. The first
+// line of a command is read at PROMPT; whatever else the scanner asks for
+// before the command is complete (an open quote, an unfinished pipeline or
+// compound command, here-document bodies) is read at PROMPT_MORE.
+typedef struct {
+  char           *data;
+  size_t          length;
+  size_t          capacity;
+  const parser_t *parser;
+  bool            more; // the command so far needs another line
+  bool            eof;
+} repl_input_t;
+
+static void start_command(repl_input_t *in, scanner_t *scanner,
+                          parser_t *parser, ast_t *ast);
+static bool refill_line(scanner_t *s);
+
+int repl_run(arena_t *arena) {
+  ast_t        ast;
+  executor_t   ex;
+  scanner_t    scanner;
+  parser_t     parser;
+  repl_input_t in = {0};
+
+  ast_init(&ast, arena);
+  executor_init(&ex, arena);
+  ex.job_control = isatty(STDIN_FILENO);
 
   printf("%s", GREETING);
-  while ((line = partyline(TEXT_GREEN("> "))) != NULL) {
+  start_command(&in, &scanner, &parser, &ast);
+  for (;;) {
     arena_reset(arena);
+    ast_reset(&ast);
 
-    scanner_t scanner;
-    scanner_init(&scanner, line, arena);
+    // Prompts for the next command, if the line so far has none left.
+    ast_ref_t command = parser_next(&parser);
+    if (parser.had_error) {
+      // The rest of the input is dropped and parsing starts afresh.
+      if (in.eof) break;
+      exec_reap(&ex);
+      start_command(&in, &scanner, &parser, &ast);
+      continue;
+    }
+    if (command == AST_NULL) break;
 
-    parser_t parser;
-    parser_init(&parser, &scanner, arena);
+    exec_run(&ex, &ast, command);
+    if (ex.exiting) break;
+    exec_reap(&ex);
+    in.more = false;
+  }
+
+  free(in.data);
+  executor_free(&ex);
+  ast_free(&ast);
+  return ex.status;
+}
 
-    ast_node_t *root = parser_parse(&parser);
-    if (!parser.had_error) ast_dump(root);
-    free(line);
+// Forgets any input left and reads the first line of a command.
+static void start_command(repl_input_t *in, scanner_t *scanner,
+                          parser_t *parser, ast_t *ast) {
+  in->length = 0;
+  in->more   = false;
+  in->parser = parser;
+  scanner_init_stream(scanner, refill_line, in);
+  parser_init(parser, scanner, ast);
+}
+
+// After a syntax error the parser skips to the end of the line, which must
+// not prompt for more: the line is thrown away anyway.
+static bool refill_line(scanner_t *s) {
+  repl_input_t *in = s->ctx;
+  if (in->eof || in->parser->had_error) return false;
+
+  char *line = partyline(in->more ? PROMPT_MORE : PROMPT);
+  if (!line) {
+    in->eof = true;
+    return false;
+  }
+
+  // On a command's first line everything before it belongs to commands
+  // already run, down to the newline that ended the last one, so a
+  // diagnostic's line number counts from the command it is about.
+  if (!in->more) {
+    s->base += in->length;
+    in->length = 0;
   }
+  in->more = true;
+
+  size_t n  = strlen(line);
+  bool   ok = in->capacity - in->length > n;
+  if (!ok) {
+    size_t capacity = in->capacity ? in->capacity : 256;
+    while (capacity - in->length <= n) capacity *= 2;
+    char *data = realloc(in->data, capacity);
+    if (data) {
+      in->data     = data;
+      in->capacity = capacity;
+      ok           = true;
+    }
+  }
+  if (ok) {
+    memcpy(in->data + in->length, line, n);
+    in->data[in->length + n] = '\n';
+    in->length += n + 1;
+  }
+  free(line);
+
+  s->buf = in->data;
+  s->end = in->data + in->length;
+  return ok;
 }
@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "allocators/arena.h"
+#include "executor/executor.h"
+#include "interpreter/ast.h"
+#include "interpreter/parser.h"
+#include "interpreter/scanner.h"
+#include "interpreter/source.h"
+#include "script.h"
+
+#define STATUS_SYNTAX    2
+#define STATUS_NOT_FOUND 127
+#define STATUS_NO_READ   126
+
+static int run_fd(arena_t *arena, int fd, const char *name, bool shared);
+static int run_commands(arena_t *arena, scanner_t *scanner, bool lookahead,
+                        source_t *shared);
+
+int script_run(arena_t *arena, const char *source, size_t length) {
+  scanner_t scanner;
+  scanner_init(&scanner, source, length);
+  return run_commands(arena, &scanner, true, NULL);
+}
+
+int script_run_file(arena_t *arena, const char *path) {
+  return run_fd(arena, open(path, O_RDONLY | O_CLOEXEC), path, false);
+}
+
+// The script is read through a close-on-exec copy of fd 0, so the source
+// can close it when done and commands still get the shell's stdin. The copy
+// shares fd 0's offset: a command that reads stdin, as `read` or `cat` does,
+// reads the script's next lines and the shell goes on after them.
+int script_run_stdin(arena_t *arena) {
+  return run_fd(arena, fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0),
+                "standard input", true);
+}
+
+// A `shared` fd is the commands' stdin as well, so it is never mapped.
+static int run_fd(arena_t *arena, int fd, const char *name, bool shared) {
+  source_t src;
+  if (fd < 0 || !source_open(&src, fd, !shared)) {
+    fprintf(stderr, "tiny: cannot open %s: %s\n", name, strerror(errno));
+    return errno == ENOENT ? STATUS_NOT_FOUND : STATUS_NO_READ;
+  }
+
+  scanner_t scanner;
+  source_attach(&src, &scanner);
+  int status = run_commands(arena, &scanner, src.mapped, shared ? &src : NULL);
+  source_close(&src);
+  return status;
+}
+
+// Each complete command runs as soon as it has been parsed, and everything it
+// allocated is dropped before the next one is read. With `lookahead`, reading
+// past a command cannot block, so the executor is told when it is the last.
+// A `shared` source is synced with the commands' stdin around each one.
+static int run_commands(arena_t *arena, scanner_t *scanner, bool lookahead,
+                        source_t *shared) {
+  ast_t      ast;
+  executor_t ex;
+  ast_init(&ast, arena);
+  executor_init(&ex, arena);
+
+  parser_t parser;
+  parser_init(&parser, scanner, &ast);
+
+  arena_mark_t mark = arena_mark(arena);
+  ast_ref_t    command;
+  while (!ex.exiting && (command = parser_next(&parser)) != AST_NULL) {
+    ex.exit_after = lookahead && parser_at_end(&parser);
+    bool synced   = shared && source_sync(shared, scanner);
+    exec_run(&ex, &ast, command);
+    if (synced) source_resume(shared, scanner);
+    if (ex.last_bg) exec_reap(&ex);
+    ast_reset(&ast);
+    arena_rewind(arena, mark);
+  }
+  if (parser.had_error) ex.status = STATUS_SYNTAX;
+
+  int status = ex.status;
+  exec_stats(&ex);
+  executor_free(&ex);
+  ast_free(&ast);
+  return status;
+}
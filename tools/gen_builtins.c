@@ -0,0 +1,51 @@
+// Emits the perfect-hash slot table for include/executor/builtins.def.
+// Usage: gen_builtins > builtin_table.h
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "executor/builtins.h"
+
+static const char *NAMES[] = {
+#define BUILTIN(name, suffix, flags) name,
+#include "executor/builtins.def"
+#undef BUILTIN
+};
+
+#define COUNT (sizeof(NAMES) / sizeof(NAMES[0]))
+
+int main(void) {
+  size_t size = 1;
+  while (size < COUNT * 2) size <<= 1;
+
+  for (;; size <<= 1) {
+    int slots[1024];
+    for (uint32_t seed = 1; seed < 1u << 20; seed++) {
+      for (size_t i = 0; i < size; i++) slots[i] = -1;
+
+      size_t placed = 0;
+      for (; placed < COUNT; placed++) {
+        uint32_t h = builtin_name_hash(seed, NAMES[placed]) & (size - 1);
+        if (slots[h] >= 0) break;
+        slots[h] = (int)placed;
+      }
+      if (placed < COUNT) continue;
+
+      printf("// Generated by tools/gen_builtins.c from "
+             "include/executor/builtins.def.\n");
+      printf("#define BUILTIN_HASH_SEED %uu\n", seed);
+      printf("#define BUILTIN_HASH_MASK %zuu\n\n", size - 1);
+      printf("static const signed char BUILTIN_SLOTS[%zu] = {", size);
+      for (size_t i = 0; i < size; i++) {
+        printf("%s%d,", i % 16 ? " " : "\n    ", slots[i]);
+      }
+      printf("\n};\n");
+      return EXIT_SUCCESS;
+    }
+    if (size >= 1024) break;
+  }
+
+  fprintf(stderr, "gen_builtins: no perfect hash found\n");
+  return EXIT_FAILURE;
+}